@@ -0,0 +1,529 @@
+#include "board_eval.h"
+#include "markov_chain.h"
+#include "counter_rng.h"
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define MAX_BOARD_LINE 8192
+#define BOARD_DELIMITERS " \t\r\n"
+#define COMMENT_CHAR '#'
+#define SINGULAR_PIVOT 1e-12
+#define MAX_JUMP_ATTEMPTS 10000
+#define BOARD_THREAD_ERROR "Error: failed to start evaluation thread\n"
+
+/**
+ * Per thread buffers, sized for the largest board of a batch and reused for
+ * every board the thread evaluates. Arrays of cells are indexed by the cell,
+ * 1..board_size.
+ */
+typedef struct BoardWorkspace {
+    int *jump_to;    // cell -> destination of its jump, 0 if none
+    int *snake_of;   // cell -> its position in snakes, -1 if none
+    int snakes[MAX_BOARD_JUMPS]; // cells a snake starts on
+    int num_snakes;
+    double *schur;   // [num_snakes][num_snakes], system of the values of
+                     // the snake cells, LU factorized
+    int rows[MAX_BOARD_JUMPS]; // its row permutation
+    double snake_values[MAX_BOARD_JUMPS];
+    double *reward;   // cell -> reward of a move from it
+    double *expected; // cell -> expected number of moves to the end
+    double *values;   // cell -> expected total reward to the end
+} BoardWorkspace;
+
+// ------------------------ VALIDATION -------------------------
+
+bool is_valid_board(const BoardDefinition *board)
+{
+    if (board->board_size < 2 || board->board_size > MAX_BOARD_SIZE ||
+        board->dice_max < 1 || board->dice_max > MAX_BOARD_DICE ||
+        board->num_jumps < 0 || board->num_jumps > MAX_BOARD_JUMPS)
+    {
+        return false;
+    }
+    bool starts[MAX_BOARD_SIZE + 1] = {false};
+    for (int i = 0; i < board->num_jumps; i++)
+    {
+        int from = board->jumps[i][0], to = board->jumps[i][1];
+        if (from <= 1 || from >= board->board_size || to < 1 ||
+            to > board->board_size || from == to || starts[from])
+        {
+            return false;
+        }
+        starts[from] = true;
+    }
+    return true;
+}
+
+// -------------------------- INPUT ----------------------------
+
+/**
+ * Parse "<board_size> <dice_max> <from>:<to> ...".
+ * @return EXIT_SUCCESS / EXIT_FAILURE
+ */
+static int parse_board(char *line, BoardDefinition *board)
+{
+    char *save_ptr, *end;
+    char *size = strtok_r(line, BOARD_DELIMITERS, &save_ptr);
+    char *dice = strtok_r(NULL, BOARD_DELIMITERS, &save_ptr);
+    if (!size || !dice){return EXIT_FAILURE;}
+    board->board_size = (int)strtol(size, &end, 10);
+    if (*end != '\0'){return EXIT_FAILURE;}
+    board->dice_max = (int)strtol(dice, &end, 10);
+    if (*end != '\0'){return EXIT_FAILURE;}
+    board->num_jumps = 0;
+    for (char *jump = strtok_r(NULL, BOARD_DELIMITERS, &save_ptr); jump;
+         jump = strtok_r(NULL, BOARD_DELIMITERS, &save_ptr))
+    {
+        int from, to, consumed;
+        if (board->num_jumps == MAX_BOARD_JUMPS ||
+            sscanf(jump, "%d:%d%n", &from, &to, &consumed) != 2 ||
+            jump[consumed] != '\0'){return EXIT_FAILURE;}
+        board->jumps[board->num_jumps][0] = from;
+        board->jumps[board->num_jumps][1] = to;
+        board->num_jumps++;
+    }
+    return is_valid_board(board) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int read_boards(FILE *fp, BoardDefinition **boards, int *num_boards)
+{
+    char line[MAX_BOARD_LINE];
+    int capacity = 0, line_number = 0;
+    *boards = NULL;
+    *num_boards = 0;
+    while (fgets(line, sizeof(line), fp))
+    {
+        line_number++;
+        size_t skip = strspn(line, BOARD_DELIMITERS);
+        if (line[skip] == '\0' || line[skip] == COMMENT_CHAR){continue;}
+        if (*num_boards == capacity)
+        {
+            capacity = capacity ? 2 * capacity : 16;
+            BoardDefinition *grown = realloc(*boards,
+                capacity * sizeof(BoardDefinition));
+            if (!grown)
+            {
+                fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+                free(*boards);
+                *boards = NULL;
+                return EXIT_FAILURE;
+            }
+            *boards = grown;
+        }
+        if (parse_board(line, &(*boards)[*num_boards]) == EXIT_FAILURE)
+        {
+            fprintf(stderr, BOARD_FORMAT_ERROR, line_number);
+            free(*boards);
+            *boards = NULL;
+            return EXIT_FAILURE;
+        }
+        (*num_boards)++;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @return random cell in [low, high]
+ */
+static int random_cell(CounterRng *rng, int low, int high)
+{
+    return low + (int)(rng_next(rng) % (uint64_t)(high - low + 1));
+}
+
+int generate_random_board(BoardDefinition *board, int board_size,
+    int dice_max, int num_snakes, int num_ladders, uint64_t seed,
+    int board_number)
+{
+    *board = (BoardDefinition) {board_size, dice_max, 0, {{0}}};
+    if (num_snakes < 0 || num_ladders < 0 ||
+        num_snakes + num_ladders > MAX_BOARD_JUMPS ||
+        !is_valid_board(board)){return EXIT_FAILURE;}
+    CounterRng rng = counter_rng(seed, board_number);
+    bool used[MAX_BOARD_SIZE + 1] = {false}; // starts and ends of jumps
+    int attempts = 0;
+    while (board->num_jumps < num_snakes + num_ladders)
+    {
+        if (++attempts > MAX_JUMP_ATTEMPTS || board_size < 3)
+        {
+            return EXIT_FAILURE;
+        }
+        bool snake = board->num_jumps < num_snakes;
+        int from = random_cell(&rng, 2, board_size - 1);
+        int to = snake ? random_cell(&rng, 1, from - 1)
+                       : random_cell(&rng, from + 1, board_size);
+        if (used[from] || used[to]){continue;}
+        used[from] = used[to] = true;
+        board->jumps[board->num_jumps][0] = from;
+        board->jumps[board->num_jumps][1] = to;
+        board->num_jumps++;
+    }
+    return EXIT_SUCCESS;
+}
+
+// ------------------------- SOLVING ---------------------------
+
+static void free_workspace(BoardWorkspace *workspace)
+{
+    free(workspace->jump_to);
+    free(workspace->snake_of);
+    free(workspace->schur);
+    free(workspace->reward);
+    free(workspace->expected);
+    free(workspace->values);
+}
+
+static int init_workspace(BoardWorkspace *workspace, int max_board_size)
+{
+    size_t cells = max_board_size + 1;
+    workspace->jump_to = malloc(cells * sizeof(int));
+    workspace->snake_of = malloc(cells * sizeof(int));
+    workspace->schur = malloc(MAX_BOARD_JUMPS * MAX_BOARD_JUMPS
+                              * sizeof(double));
+    workspace->reward = malloc(cells * sizeof(double));
+    workspace->expected = malloc(cells * sizeof(double));
+    workspace->values = malloc(cells * sizeof(double));
+    if (!workspace->jump_to || !workspace->snake_of || !workspace->schur ||
+        !workspace->reward || !workspace->expected || !workspace->values)
+    {
+        free_workspace(workspace);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Fill the jumps of the board in the workspace.
+ */
+static void build_model(const BoardDefinition *board,
+    BoardWorkspace *workspace)
+{
+    int size = board->board_size;
+    memset(workspace->jump_to, 0, (size + 1) * sizeof(int));
+    for (int cell = 0; cell <= size; cell++){workspace->snake_of[cell] = -1;}
+    workspace->num_snakes = 0;
+    for (int i = 0; i < board->num_jumps; i++)
+    {
+        int from = board->jumps[i][0], to = board->jumps[i][1];
+        workspace->jump_to[from] = to;
+        if (to < from)
+        {
+            workspace->snake_of[from] = workspace->num_snakes;
+            workspace->snakes[workspace->num_snakes++] = from;
+        }
+    }
+}
+
+/**
+ * Expected total reward to the end from every cell, given the values of
+ * the snake cells. Every other move goes forward, so the cells are solved
+ * from the last one down in O(board_size * dice_max).
+ * @param reward cell -> reward of a move from it, NULL for none
+ * @param snake_values values of the snake cells, in order of snakes
+ * @param values cell -> the result
+ */
+static void back_substitute(const BoardDefinition *board,
+    const BoardWorkspace *workspace, const double *reward,
+    const double *snake_values, double *values)
+{
+    int size = board->board_size;
+    values[size] = 0;
+    for (int cell = size - 1; cell >= 1; cell--)
+    {
+        int snake = workspace->snake_of[cell];
+        if (snake >= 0){values[cell] = snake_values[snake]; continue;}
+        double value = reward ? reward[cell] : 0;
+        int jump = workspace->jump_to[cell];
+        if (jump)
+        {
+            values[cell] = value + values[jump];
+            continue;
+        }
+        // Outcomes that overshoot the board are not moves.
+        int moves = size - cell < board->dice_max ? size - cell
+                                                  : board->dice_max;
+        double sum = 0;
+        for (int dice = 1; dice <= moves; dice++){sum += values[cell + dice];}
+        values[cell] = value + sum / moves;
+    }
+}
+
+/**
+ * LU factorization with partial pivoting, in place.
+ * @return EXIT_FAILURE if the matrix is singular (some cells never reach
+ * the end)
+ */
+static int factorize(double *matrix, int *rows, int n)
+{
+    for (int i = 0; i < n; i++){rows[i] = i;}
+    for (int k = 0; k < n; k++)
+    {
+        int pivot = k;
+        for (int i = k + 1; i < n; i++)
+        {
+            if (fabs(matrix[(size_t)i * n + k]) >
+                fabs(matrix[(size_t)pivot * n + k])){pivot = i;}
+        }
+        if (fabs(matrix[(size_t)pivot * n + k]) < SINGULAR_PIVOT)
+        {
+            return EXIT_FAILURE;
+        }
+        if (pivot != k)
+        {
+            for (int j = 0; j < n; j++)
+            {
+                double tmp = matrix[(size_t)k * n + j];
+                matrix[(size_t)k * n + j] = matrix[(size_t)pivot * n + j];
+                matrix[(size_t)pivot * n + j] = tmp;
+            }
+            int tmp = rows[k];
+            rows[k] = rows[pivot];
+            rows[pivot] = tmp;
+        }
+        const double *pivot_row = matrix + (size_t)k * n;
+        for (int i = k + 1; i < n; i++)
+        {
+            double *row = matrix + (size_t)i * n;
+            if (row[k] == 0){continue;}
+            row[k] /= pivot_row[k];
+            for (int j = k + 1; j < n; j++){row[j] -= row[k] * pivot_row[j];}
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Solve A x = b given the factorization of A.
+ */
+static void solve(const double *lu, const int *rows, int n, const double *b,
+    double *x)
+{
+    for (int i = 0; i < n; i++)
+    {
+        double sum = b[rows[i]];
+        for (int j = 0; j < i; j++){sum -= lu[(size_t)i * n + j] * x[j];}
+        x[i] = sum;
+    }
+    for (int i = n - 1; i >= 0; i--)
+    {
+        double sum = x[i];
+        for (int j = i + 1; j < n; j++){sum -= lu[(size_t)i * n + j] * x[j];}
+        x[i] = sum / lu[(size_t)i * n + i];
+    }
+}
+
+/**
+ * Build and factorize the system of the snake cells: with v the values of
+ * the other cells as a function of theirs (back_substitute()), snake s
+ * from cell c to cell t needs v_c = r_c + v_t. v is affine in the snake
+ * values, so row s of the system is e_s - (v_t for each unit snake value).
+ * @return EXIT_FAILURE if it is singular (some cells never reach the end)
+ */
+static int factorize_snakes(const BoardDefinition *board,
+    BoardWorkspace *workspace)
+{
+    int k = workspace->num_snakes;
+    double *unit = workspace->snake_values;
+    for (int j = 0; j < k; j++){unit[j] = 0;}
+    for (int j = 0; j < k; j++)
+    {
+        unit[j] = 1;
+        back_substitute(board, workspace, NULL, unit, workspace->values);
+        unit[j] = 0;
+        for (int i = 0; i < k; i++)
+        {
+            int to = workspace->jump_to[workspace->snakes[i]];
+            workspace->schur[(size_t)i * k + j] = (i == j)
+                                                  - workspace->values[to];
+        }
+    }
+    return factorize(workspace->schur, workspace->rows, k);
+}
+
+/**
+ * Expected total reward to the end from every cell, given the
+ * factorization of factorize_snakes().
+ * @param reward cell -> reward of a move from it
+ * @param values cell -> the result
+ */
+static void solve_rewards(const BoardDefinition *board,
+    BoardWorkspace *workspace, const double *reward, double *values)
+{
+    int k = workspace->num_snakes;
+    double rhs[MAX_BOARD_JUMPS];
+    for (int j = 0; j < k; j++){workspace->snake_values[j] = 0;}
+    back_substitute(board, workspace, reward, workspace->snake_values,
+        values);
+    for (int i = 0; i < k; i++)
+    {
+        int from = workspace->snakes[i];
+        rhs[i] = reward[from] + values[workspace->jump_to[from]];
+    }
+    solve(workspace->schur, workspace->rows, k, rhs,
+        workspace->snake_values);
+    back_substitute(board, workspace, reward, workspace->snake_values,
+        values);
+}
+
+/**
+ * Evaluate one board in the workspace. With N = (I - Q)^-1 and Q the
+ * transitions between the cells 1..board_size-1, N r is the expected total
+ * reward r of a game from each cell: the expected lengths are E = N 1, the
+ * second moments N (2E - 1), and the expected snakes (ladders) taken N of
+ * the indicator of the snake (ladder) cells. Only snakes go backward, so
+ * each solve is a back substitution plus a dense solve over the snake
+ * cells: O(board_size * dice_max * snakes + snakes^3) per board, instead of
+ * a dense O(board_size^3) factorization.
+ */
+static BoardStats evaluate_board(const BoardDefinition *board, int position,
+    BoardWorkspace *workspace)
+{
+    BoardStats stats = {position, false, 0, 0, 0, 0};
+    int size = board->board_size;
+    double *reward = workspace->reward;
+    build_model(board, workspace);
+    if (factorize_snakes(board, workspace) == EXIT_FAILURE){return stats;}
+    for (int cell = 1; cell < size; cell++){reward[cell] = 1;}
+    solve_rewards(board, workspace, reward, workspace->expected);
+    for (int cell = 1; cell < size; cell++)
+    {
+        reward[cell] = 2 * workspace->expected[cell] - 1;
+    }
+    solve_rewards(board, workspace, reward, workspace->values);
+    stats.valid = true;
+    stats.expected_length = workspace->expected[1];
+    stats.variance = workspace->values[1] -
+                     stats.expected_length * stats.expected_length;
+    for (int cell = 1; cell < size; cell++)
+    {
+        reward[cell] = workspace->snake_of[cell] >= 0;
+    }
+    solve_rewards(board, workspace, reward, workspace->values);
+    stats.snake_hits = workspace->values[1];
+    for (int cell = 1; cell < size; cell++)
+    {
+        reward[cell] = workspace->jump_to[cell] > cell;
+    }
+    solve_rewards(board, workspace, reward, workspace->values);
+    stats.ladder_hits = workspace->values[1];
+    return stats;
+}
+
+// ------------------------ THREADING --------------------------
+
+typedef struct BoardBatch {
+    const BoardDefinition *boards;
+    int num_boards;
+    int max_board_size;
+    BoardStats *stats;
+    atomic_int next_board;
+    atomic_bool failed;
+} BoardBatch;
+
+static void *evaluate_worker(void *arg)
+{
+    BoardBatch *batch = arg;
+    BoardWorkspace workspace;
+    if (init_workspace(&workspace, batch->max_board_size) == EXIT_FAILURE)
+    {
+        atomic_store(&batch->failed, true);
+        return NULL;
+    }
+    int board;
+    while ((board = atomic_fetch_add(&batch->next_board, 1))
+           < batch->num_boards)
+    {
+        batch->stats[board] = evaluate_board(&batch->boards[board], board,
+            &workspace);
+    }
+    free_workspace(&workspace);
+    return NULL;
+}
+
+int evaluate_boards(const BoardDefinition *boards, int num_boards,
+    int num_threads, BoardStats *stats)
+{
+    if (!boards || !stats || num_threads < 1){return EXIT_FAILURE;}
+    BoardBatch batch = {boards, num_boards, 2, stats, 0, false};
+    for (int i = 0; i < num_boards; i++)
+    {
+        if (!is_valid_board(&boards[i])){return EXIT_FAILURE;}
+        if (boards[i].board_size > batch.max_board_size)
+        {
+            batch.max_board_size = boards[i].board_size;
+        }
+    }
+    if (num_threads > num_boards){num_threads = num_boards ? num_boards : 1;}
+    pthread_t *threads = malloc(num_threads * sizeof(pthread_t));
+    if (!threads){fprintf(stderr, ALLOCATION_ERROR_MASSAGE); return EXIT_FAILURE;}
+    int started = 1;
+    for (; started < num_threads; started++)
+    {
+        if (pthread_create(&threads[started], NULL, evaluate_worker, &batch)
+            != 0){break;}
+    }
+    evaluate_worker(&batch);
+    for (int t = 1; t < started; t++){pthread_join(threads[t], NULL);}
+    free(threads);
+    if (started < num_threads)
+    {
+        fprintf(stderr, BOARD_THREAD_ERROR);
+        return EXIT_FAILURE;
+    }
+    if (atomic_load(&batch.failed))
+    {
+        fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+// ------------------------- RANKING ---------------------------
+
+static double rank_key(const BoardStats *stats, BoardRank rank)
+{
+    switch (rank)
+    {
+        case RANK_VARIANCE: return stats->variance;
+        case RANK_SNAKES: return stats->snake_hits;
+        case RANK_LADDERS: return stats->ladder_hits;
+        default: return stats->expected_length;
+    }
+}
+
+static int compare_stats(const BoardStats *a, const BoardStats *b,
+    BoardRank rank)
+{
+    if (a->valid != b->valid){return a->valid ? -1 : 1;}
+    double key_a = rank_key(a, rank), key_b = rank_key(b, rank);
+    if (a->valid && key_a != key_b){return key_a < key_b ? -1 : 1;}
+    return a->board - b->board;
+}
+
+static int compare_length(const void *a, const void *b)
+{
+    return compare_stats(a, b, RANK_LENGTH);
+}
+
+static int compare_variance(const void *a, const void *b)
+{
+    return compare_stats(a, b, RANK_VARIANCE);
+}
+
+static int compare_snakes(const void *a, const void *b)
+{
+    return compare_stats(a, b, RANK_SNAKES);
+}
+
+static int compare_ladders(const void *a, const void *b)
+{
+    return compare_stats(a, b, RANK_LADDERS);
+}
+
+void rank_boards(BoardStats *stats, int num_boards, BoardRank rank)
+{
+    int (*comparators[])(const void *, const void *) = {
+        compare_length, compare_variance, compare_snakes, compare_ladders};
+    qsort(stats, num_boards, sizeof(BoardStats), comparators[rank]);
+}
@@ -0,0 +1,107 @@
+#ifndef _BOARD_EVAL_H
+#define _BOARD_EVAL_H
+
+#include <stdio.h>   // For FILE
+#include <stdlib.h>  // For malloc()
+#include <stdbool.h> // for bool
+#include <stdint.h>  // For uint64_t
+
+#define MAX_BOARD_SIZE 1000
+#define MAX_BOARD_DICE 20
+#define MAX_BOARD_JUMPS 128
+
+#define BOARD_FORMAT_ERROR "Error: invalid board definition on line %d\n"
+
+/**
+ * A snakes and ladders variant. Each jump (from, to) is a ladder if
+ * from < to and a snake otherwise.
+ */
+typedef struct BoardDefinition {
+    int board_size; // cells 1..board_size, the game ends on board_size
+    int dice_max;   // dice outcomes 1..dice_max
+    int num_jumps;
+    int jumps[MAX_BOARD_JUMPS][2];
+} BoardDefinition;
+
+/**
+ * Exact statistics of a game on a board, under the chain the game is
+ * modeled with: from a jump cell the only move is the jump, otherwise each
+ * dice outcome that stays on the board is equally likely.
+ */
+typedef struct BoardStats {
+    int board;              // position of the board in its batch
+    bool valid;             // false if the end cannot always be reached
+    double expected_length; // expected number of moves from cell 1
+    double variance;        // variance of the number of moves
+    double snake_hits;      // expected number of snakes taken per game
+    double ladder_hits;     // expected number of ladders taken per game
+} BoardStats;
+
+/**
+ * Criteria boards can be ranked by, always in increasing order.
+ */
+typedef enum BoardRank {
+    RANK_LENGTH,
+    RANK_VARIANCE,
+    RANK_SNAKES,
+    RANK_LADDERS
+} BoardRank;
+
+/**
+ * Read board definitions, one per line:
+ * "<board_size> <dice_max> <from>:<to> <from>:<to> ...". Empty lines and
+ * lines starting with '#' are skipped.
+ * @param fp file to read
+ * @param boards set to a new array of boards, to free by the caller
+ * @param num_boards set to the number of boards read
+ * @return EXIT_SUCCESS / EXIT_FAILURE (error printed)
+ */
+int read_boards(FILE *fp, BoardDefinition **boards, int *num_boards);
+
+/**
+ * Create a random board. Snakes and ladders start on distinct cells other
+ * than the first and the last, and never end where another one starts.
+ * @param board board to fill
+ * @param board_size number of cells
+ * @param dice_max highest dice outcome
+ * @param num_snakes number of snakes
+ * @param num_ladders number of ladders
+ * @param seed user seed
+ * @param board_number position of the board, so each board of a batch can
+ * be recreated on its own
+ * @return EXIT_SUCCESS, EXIT_FAILURE if that many jumps do not fit
+ */
+int generate_random_board(BoardDefinition *board, int board_size,
+    int dice_max, int num_snakes, int num_ladders, uint64_t seed,
+    int board_number);
+
+/**
+ * Check that a board is well formed (its sizes are in range, and each jump
+ * starts on a distinct cell other than the first and the last).
+ * @return true if it is
+ */
+bool is_valid_board(const BoardDefinition *board);
+
+/**
+ * Evaluate many boards in parallel. Each thread builds the models of its
+ * boards in a single reusable buffer, so the batch costs a few allocations
+ * in total.
+ * @param boards boards to evaluate
+ * @param num_boards
+ * @param num_threads number of worker threads, >= 1
+ * @param stats num_boards results, stats[i] is the result of boards[i]
+ * @return EXIT_SUCCESS / EXIT_FAILURE (error printed)
+ */
+int evaluate_boards(const BoardDefinition *boards, int num_boards,
+    int num_threads, BoardStats *stats);
+
+/**
+ * Sort results in increasing order of the given criterion, invalid boards
+ * last, ties by board position.
+ * @param stats results of evaluate_boards()
+ * @param num_boards
+ * @param rank criterion
+ */
+void rank_boards(BoardStats *stats, int num_boards, BoardRank rank);
+
+#endif /* _BOARD_EVAL_H */
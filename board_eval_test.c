@@ -0,0 +1,148 @@
+#include "board_eval.h"
+#include <math.h>
+#include <string.h>
+
+#define TOLERANCE 1e-9
+#define NUM_RANDOM_BOARDS 64
+#define TEST_SEED 12345
+
+#define CHECK(condition) if (!(condition)) \
+    {fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+    #condition); return EXIT_FAILURE;}
+
+static bool close_to(double value, double expected)
+{
+    return fabs(value - expected) <= TOLERANCE * (1 + fabs(expected));
+}
+
+/**
+ * Evaluate a single board given as a line of a board file.
+ */
+static int evaluate_line(const char *line, BoardStats *stats)
+{
+    FILE *fp = tmpfile();
+    if (!fp){return EXIT_FAILURE;}
+    fputs(line, fp);
+    rewind(fp);
+    BoardDefinition *boards;
+    int num_boards;
+    int status = read_boards(fp, &boards, &num_boards);
+    fclose(fp);
+    if (status == EXIT_FAILURE){return EXIT_FAILURE;}
+    status = num_boards == 1 ? evaluate_boards(boards, 1, 1, stats)
+                             : EXIT_FAILURE;
+    free(boards);
+    return status;
+}
+
+/**
+ * Boards whose moments are known in closed form.
+ */
+static int test_known_boards(void)
+{
+    BoardStats stats;
+    // One die face: exactly board_size - 1 moves.
+    CHECK(evaluate_line("10 1\n", &stats) == EXIT_SUCCESS);
+    CHECK(stats.valid && close_to(stats.expected_length, 9));
+    CHECK(close_to(stats.variance, 0));
+    // From 1, one move to 3 or two moves through 2.
+    CHECK(evaluate_line("3 2\n", &stats) == EXIT_SUCCESS);
+    CHECK(close_to(stats.expected_length, 1.5));
+    CHECK(close_to(stats.variance, 0.25));
+    // A ladder taken by every game, as its own move.
+    CHECK(evaluate_line("4 1 2:4\n", &stats) == EXIT_SUCCESS);
+    CHECK(close_to(stats.expected_length, 2));
+    CHECK(close_to(stats.ladder_hits, 1) && close_to(stats.snake_hits, 0));
+    // Each round from 1 hits the snake with probability 1/2, costing two
+    // moves: length 2 + 2K with K geometric, E[K] = 1, Var[K] = 2.
+    CHECK(evaluate_line("4 2 2:1\n", &stats) == EXIT_SUCCESS);
+    CHECK(close_to(stats.expected_length, 4));
+    CHECK(close_to(stats.variance, 8));
+    CHECK(close_to(stats.snake_hits, 1) && close_to(stats.ladder_hits, 0));
+    // A snake every game takes, forever.
+    CHECK(evaluate_line("3 1 2:1\n", &stats) == EXIT_SUCCESS);
+    CHECK(!stats.valid);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Expected lengths by value iteration, a solver independent of
+ * evaluate_boards().
+ */
+static double iterate_expected_length(const BoardDefinition *board)
+{
+    double expected[MAX_BOARD_SIZE + 1] = {0};
+    int jump_to[MAX_BOARD_SIZE + 1] = {0};
+    for (int i = 0; i < board->num_jumps; i++)
+    {
+        jump_to[board->jumps[i][0]] = board->jumps[i][1];
+    }
+    int size = board->board_size;
+    for (double change = 1; change > TOLERANCE * TOLERANCE;)
+    {
+        change = 0;
+        for (int cell = size - 1; cell >= 1; cell--)
+        {
+            double value;
+            if (jump_to[cell])
+            {
+                value = 1 + expected[jump_to[cell]];
+            }
+            else
+            {
+                int moves = size - cell < board->dice_max ? size - cell
+                                                          : board->dice_max;
+                double sum = 0;
+                for (int dice = 1; dice <= moves; dice++)
+                {
+                    sum += expected[cell + dice];
+                }
+                value = 1 + sum / moves;
+            }
+            change = fmax(change, fabs(value - expected[cell]));
+            expected[cell] = value;
+        }
+    }
+    return expected[1];
+}
+
+/**
+ * Random boards agree with value iteration, and with themselves whatever
+ * the number of threads.
+ */
+static int test_random_boards(void)
+{
+    BoardDefinition boards[NUM_RANDOM_BOARDS];
+    BoardStats one_thread[NUM_RANDOM_BOARDS];
+    BoardStats threads[NUM_RANDOM_BOARDS];
+    for (int i = 0; i < NUM_RANDOM_BOARDS; i++)
+    {
+        CHECK(generate_random_board(&boards[i], 100, 6, 8, 8, TEST_SEED, i)
+              == EXIT_SUCCESS);
+    }
+    CHECK(evaluate_boards(boards, NUM_RANDOM_BOARDS, 1, one_thread)
+          == EXIT_SUCCESS);
+    CHECK(evaluate_boards(boards, NUM_RANDOM_BOARDS, 4, threads)
+          == EXIT_SUCCESS);
+    for (int i = 0; i < NUM_RANDOM_BOARDS; i++)
+    {
+        CHECK(one_thread[i].valid && one_thread[i].board == i);
+        CHECK(close_to(one_thread[i].expected_length,
+                       iterate_expected_length(&boards[i])));
+        CHECK(memcmp(&one_thread[i], &threads[i], sizeof(BoardStats)) == 0);
+    }
+    rank_boards(threads, NUM_RANDOM_BOARDS, RANK_LENGTH);
+    for (int i = 1; i < NUM_RANDOM_BOARDS; i++)
+    {
+        CHECK(threads[i - 1].expected_length <= threads[i].expected_length);
+    }
+    return EXIT_SUCCESS;
+}
+
+int main(void)
+{
+    if (test_known_boards() == EXIT_FAILURE ||
+        test_random_boards() == EXIT_FAILURE){return EXIT_FAILURE;}
+    printf("board_eval_test: passed\n");
+    return EXIT_SUCCESS;
+}
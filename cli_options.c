@@ -0,0 +1,62 @@
+#include "cli_options.h"
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+
+#define DECIMAL_BASE 10
+
+char *take_option(int *argc, char **argv, const char *name)
+{
+    char *value = NULL;
+    size_t prefix_len = strlen(OPTION_PREFIX), name_len = strlen(name);
+    int kept = 1;
+    for (int i = 1; i < *argc; i++)
+    {
+        char *arg = argv[i];
+        if (!strncmp(arg, OPTION_PREFIX, prefix_len) &&
+            !strncmp(arg + prefix_len, name, name_len))
+        {
+            char *rest = arg + prefix_len + name_len;
+            if (*rest == '\0' || *rest == '=')
+            {
+                value = (*rest == '=') ? rest + 1 : rest;
+                continue;
+            }
+        }
+        argv[kept++] = arg;
+    }
+    *argc = kept;
+    argv[kept] = NULL;
+    return value;
+}
+
+int parse_int_option(const char *value, int default_value, int min,
+    int *result)
+{
+    if (!value){*result = default_value; return EXIT_SUCCESS;}
+    char *end;
+    errno = 0;
+    long parsed = strtol(value, &end, DECIMAL_BASE);
+    if (*value == '\0' || *end != '\0' || errno == ERANGE || parsed < min ||
+        parsed > INT_MAX){return EXIT_FAILURE;}
+    *result = (int)parsed;
+    return EXIT_SUCCESS;
+}
+
+int parse_double_option(const char *value, double default_value,
+    double *result)
+{
+    if (!value){*result = default_value; return EXIT_SUCCESS;}
+    char *end;
+    double parsed = strtod(value, &end);
+    if (*value == '\0' || *end != '\0'){return EXIT_FAILURE;}
+    *result = parsed;
+    return EXIT_SUCCESS;
+}
+
+int default_num_threads(void)
+{
+    long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return num_cpus > 0 ? (int)num_cpus : 1;
+}
@@ -0,0 +1,46 @@
+#ifndef _CLI_OPTIONS_H
+#define _CLI_OPTIONS_H
+
+#include <stdlib.h> // For strtol(), strtod()
+
+#define OPTION_PREFIX "--"
+#define OPTION_ERROR "Usage: invalid option value\n"
+
+/**
+ * Find the option "--name=value" (or the flag "--name") in argv and remove
+ * it, so only positional arguments are left. The last occurrence wins.
+ * @param argc number of arguments, updated
+ * @param argv arguments, updated
+ * @param name option name, without the leading "--"
+ * @return the option's value ("" for a flag), NULL if not given
+ */
+char *take_option(int *argc, char **argv, const char *name);
+
+/**
+ * Parse the value of an integer option.
+ * @param value value returned by take_option(), may be NULL
+ * @param default_value result when value is NULL
+ * @param min smallest accepted value
+ * @param result parsed value
+ * @return EXIT_SUCCESS, EXIT_FAILURE if value is not an integer in
+ * [min, INT_MAX]
+ */
+int parse_int_option(const char *value, int default_value, int min,
+    int *result);
+
+/**
+ * Parse the value of a real option.
+ * @param value value returned by take_option(), may be NULL
+ * @param default_value result when value is NULL
+ * @param result parsed value
+ * @return EXIT_SUCCESS, EXIT_FAILURE if value is not a number
+ */
+int parse_double_option(const char *value, double default_value,
+    double *result);
+
+/**
+ * @return number of online processors, at least 1
+ */
+int default_num_threads(void);
+
+#endif /* _CLI_OPTIONS_H */
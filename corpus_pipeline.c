@@ -0,0 +1,787 @@
+#include "corpus_pipeline.h"
+#include "word_table.h"
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#define DELIMITERS " \n\t\r"
+#define GZIP_MAGIC_0 0x1f
+#define GZIP_MAGIC_1 0x8b
+#define GZIP_WINDOW_BITS (16 + MAX_WBITS) // largest window, gzip header
+#define INITIAL_FILES_CAPACITY 8
+#define INITIAL_NODES_CAPACITY 1024
+#define NUM_STAGE_THREADS 3
+#define CACHE_LINE_SIZE 64
+
+// ------------------------ MESSAGES ---------------------------
+
+typedef enum MsgKind {
+    MSG_DATA,     // bytes (raw or plain text) or NUL separated words, where
+                  // an empty word marks the end of a line
+    MSG_FILE_END, // the current file is exhausted
+    MSG_END,      // all files are exhausted
+    MSG_ERROR     // an upstream stage failed, error already printed
+} MsgKind;
+
+typedef struct PipelineMsg {
+    MsgKind kind;
+    char *data;
+    size_t len;
+    int count; // number of words in data, for word batches
+} PipelineMsg;
+
+static PipelineMsg *create_msg(MsgKind kind, char *data, size_t len,
+    int count)
+{
+    PipelineMsg *msg = malloc(sizeof(PipelineMsg));
+    if (!msg){fprintf(stderr, ALLOCATION_ERROR_MASSAGE); return NULL;}
+    *msg = (PipelineMsg) {kind, data, len, count};
+    return msg;
+}
+
+static void free_msg(PipelineMsg *msg)
+{
+    if (!msg){return;}
+    free(msg->data);
+    free(msg);
+}
+
+// ------------------------- QUEUES ----------------------------
+
+/**
+ * Bounded single-producer single-consumer ring. head is only written by the
+ * consumer and tail only by the producer, so no locks are needed. Each side
+ * has its own cache line, holding its index and the last value it read of
+ * the other side's, so it only reads the other line when the ring looks
+ * full (or empty) rather than on every message.
+ */
+typedef struct PipelineQueue {
+    PipelineMsg *slots[PIPELINE_QUEUE_CAPACITY];
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t head;
+    size_t cached_tail; // consumer's view of tail
+    _Alignas(CACHE_LINE_SIZE) atomic_size_t tail;
+    size_t cached_head; // producer's view of head
+} PipelineQueue;
+
+typedef struct Pipeline {
+    const CorpusFiles *files;
+    PipelineQueue raw_queue;   // reader -> decompressor
+    PipelineQueue text_queue;  // decompressor -> tokenizer
+    PipelineQueue word_queue;  // tokenizer -> chain update
+    atomic_bool stop;
+} Pipeline;
+
+/**
+ * Push msg, waiting while the queue is full.
+ * @return true on success, false if the pipeline was stopped meanwhile (msg
+ * is then still owned by the caller)
+ */
+static bool queue_push(PipelineQueue *queue, PipelineMsg *msg,
+    atomic_bool *stop)
+{
+    size_t tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    while (tail - queue->cached_head == PIPELINE_QUEUE_CAPACITY)
+    {
+        queue->cached_head = atomic_load_explicit(&queue->head,
+                                                  memory_order_acquire);
+        if (tail - queue->cached_head < PIPELINE_QUEUE_CAPACITY){break;}
+        if (atomic_load_explicit(stop, memory_order_relaxed)){return false;}
+        sched_yield();
+    }
+    queue->slots[tail % PIPELINE_QUEUE_CAPACITY] = msg;
+    atomic_store_explicit(&queue->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+/**
+ * Pop the oldest message, waiting while the queue is empty.
+ * @return the message, NULL if the pipeline was stopped meanwhile
+ */
+static PipelineMsg *queue_pop(PipelineQueue *queue, atomic_bool *stop)
+{
+    size_t head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    while (queue->cached_tail == head)
+    {
+        queue->cached_tail = atomic_load_explicit(&queue->tail,
+                                                  memory_order_acquire);
+        if (queue->cached_tail != head){break;}
+        if (atomic_load_explicit(stop, memory_order_relaxed)){return NULL;}
+        sched_yield();
+    }
+    PipelineMsg *msg = queue->slots[head % PIPELINE_QUEUE_CAPACITY];
+    atomic_store_explicit(&queue->head, head + 1, memory_order_release);
+    return msg;
+}
+
+/**
+ * Free whatever is left in a queue once all its users are gone.
+ */
+static void queue_drain(PipelineQueue *queue)
+{
+    size_t head = atomic_load(&queue->head);
+    size_t tail = atomic_load(&queue->tail);
+    for (; head != tail; head++)
+    {
+        free_msg(queue->slots[head % PIPELINE_QUEUE_CAPACITY]);
+    }
+    atomic_store(&queue->head, head);
+}
+
+/**
+ * Create a message and push it, used for control messages.
+ * @return true on success
+ */
+static bool push_new_msg(PipelineQueue *queue, MsgKind kind,
+    atomic_bool *stop)
+{
+    PipelineMsg *msg = create_msg(kind, NULL, 0, 0);
+    if (!msg){return false;}
+    if (!queue_push(queue, msg, stop)){free_msg(msg); return false;}
+    return true;
+}
+
+/**
+ * Report a failure downstream, and make sure nothing else is produced.
+ */
+static void *fail_stage(PipelineQueue *out, atomic_bool *stop)
+{
+    if (!push_new_msg(out, MSG_ERROR, stop))
+    {
+        atomic_store(stop, true);
+    }
+    return NULL;
+}
+
+// ------------------------- STAGES ----------------------------
+
+/**
+ * Stage 1: read every file in fixed size chunks.
+ */
+static void *read_stage(void *arg)
+{
+    Pipeline *pipeline = arg;
+    PipelineQueue *out = &pipeline->raw_queue;
+    for (int i = 0; i < pipeline->files->size; i++)
+    {
+        FILE *fp = fopen(pipeline->files->paths[i], "rb");
+        if (!fp)
+        {
+            fprintf(stderr, PIPELINE_READ_ERROR);
+            return fail_stage(out, &pipeline->stop);
+        }
+        while (true)
+        {
+            char *buffer = malloc(PIPELINE_CHUNK_SIZE);
+            if (!buffer)
+            {
+                fclose(fp);
+                fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+                return fail_stage(out, &pipeline->stop);
+            }
+            size_t len = fread(buffer, 1, PIPELINE_CHUNK_SIZE, fp);
+            if (len == 0){free(buffer); break;}
+            PipelineMsg *msg = create_msg(MSG_DATA, buffer, len, 0);
+            if (!msg)
+            {
+                free(buffer);
+                fclose(fp);
+                return fail_stage(out, &pipeline->stop);
+            }
+            if (!queue_push(out, msg, &pipeline->stop))
+            {
+                free_msg(msg);
+                fclose(fp);
+                return NULL;
+            }
+        }
+        bool read_error = ferror(fp);
+        fclose(fp);
+        if (read_error)
+        {
+            fprintf(stderr, PIPELINE_READ_ERROR);
+            return fail_stage(out, &pipeline->stop);
+        }
+        if (!push_new_msg(out, MSG_FILE_END, &pipeline->stop)){return NULL;}
+    }
+    push_new_msg(out, MSG_END, &pipeline->stop);
+    return NULL;
+}
+
+/**
+ * Inflate one chunk of a gzip file, pushing plain text downstream.
+ * @return EXIT_SUCCESS / EXIT_FAILURE (error printed, or pipeline stopped)
+ */
+static int inflate_chunk(Pipeline *pipeline, z_stream *stream,
+    PipelineMsg *chunk, bool *stream_end)
+{
+    stream->next_in = (Bytef *)chunk->data;
+    stream->avail_in = (uInt)chunk->len;
+    while (stream->avail_in > 0)
+    {
+        if (*stream_end)
+        {
+            // Concatenated gzip members are a valid gzip file.
+            inflateReset(stream);
+            *stream_end = false;
+        }
+        char *buffer = malloc(PIPELINE_CHUNK_SIZE);
+        if (!buffer)
+        {
+            fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+            return EXIT_FAILURE;
+        }
+        stream->next_out = (Bytef *)buffer;
+        stream->avail_out = PIPELINE_CHUNK_SIZE;
+        int res = inflate(stream, Z_NO_FLUSH);
+        if (res != Z_OK && res != Z_STREAM_END)
+        {
+            free(buffer);
+            fprintf(stderr, PIPELINE_DECOMPRESS_ERROR);
+            return EXIT_FAILURE;
+        }
+        *stream_end = (res == Z_STREAM_END);
+        size_t len = PIPELINE_CHUNK_SIZE - stream->avail_out;
+        if (len == 0){free(buffer); continue;}
+        PipelineMsg *msg = create_msg(MSG_DATA, buffer, len, 0);
+        if (!msg){free(buffer); return EXIT_FAILURE;}
+        if (!queue_push(&pipeline->text_queue, msg, &pipeline->stop))
+        {
+            free_msg(msg);
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Stage 2: pass plain files through, inflate gzip files (detected by their
+ * magic bytes, not their name).
+ */
+static void *decompress_stage(void *arg)
+{
+    Pipeline *pipeline = arg;
+    PipelineQueue *out = &pipeline->text_queue;
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (inflateInit2(&stream, GZIP_WINDOW_BITS) != Z_OK)
+    {
+        fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+        return fail_stage(out, &pipeline->stop);
+    }
+    bool file_start = true, gzipped = false, stream_end = false;
+    PipelineMsg *msg;
+    while ((msg = queue_pop(&pipeline->raw_queue, &pipeline->stop)))
+    {
+        if (msg->kind == MSG_DATA && file_start)
+        {
+            gzipped = msg->len >= 2
+                      && (unsigned char)msg->data[0] == GZIP_MAGIC_0
+                      && (unsigned char)msg->data[1] == GZIP_MAGIC_1;
+            stream_end = false;
+            file_start = false;
+            if (gzipped){inflateReset(&stream);}
+        }
+        if (msg->kind == MSG_DATA && gzipped)
+        {
+            int res = inflate_chunk(pipeline, &stream, msg, &stream_end);
+            free_msg(msg);
+            if (res == EXIT_FAILURE){break;}
+            continue;
+        }
+        if (msg->kind == MSG_FILE_END)
+        {
+            if (gzipped && !stream_end)
+            {
+                free_msg(msg);
+                fprintf(stderr, PIPELINE_DECOMPRESS_ERROR);
+                break;
+            }
+            file_start = true;
+            gzipped = false;
+        }
+        MsgKind kind = msg->kind;
+        if (!queue_push(out, msg, &pipeline->stop))
+        {
+            free_msg(msg);
+            inflateEnd(&stream);
+            return NULL;
+        }
+        if (kind == MSG_END || kind == MSG_ERROR)
+        {
+            inflateEnd(&stream);
+            return NULL;
+        }
+    }
+    inflateEnd(&stream);
+    if (atomic_load(&pipeline->stop)){return NULL;}
+    return fail_stage(out, &pipeline->stop);
+}
+
+/**
+ * Words under construction by the tokenizer: NUL separated words, plus the
+ * unfinished word (if any) at the end of the last chunk seen.
+ */
+typedef struct WordBatch {
+    char *data;
+    size_t len;
+    size_t capacity;
+    int count;
+    size_t partial_start; // where the unfinished word begins in data
+    bool in_word;
+} WordBatch;
+
+static int batch_reserve(WordBatch *batch, size_t extra)
+{
+    if (batch->len + extra <= batch->capacity){return EXIT_SUCCESS;}
+    size_t capacity = batch->capacity ? batch->capacity : PIPELINE_CHUNK_SIZE;
+    while (capacity < batch->len + extra){capacity *= 2;}
+    char *data = realloc(batch->data, capacity);
+    if (!data){fprintf(stderr, ALLOCATION_ERROR_MASSAGE); return EXIT_FAILURE;}
+    batch->data = data;
+    batch->capacity = capacity;
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Push all finished words of the batch downstream, keeping the unfinished
+ * one (if any) for the next chunk.
+ * @return EXIT_SUCCESS / EXIT_FAILURE
+ */
+static int flush_batch(Pipeline *pipeline, WordBatch *batch)
+{
+    size_t done = batch->in_word ? batch->partial_start : batch->len;
+    if (batch->count == 0){return EXIT_SUCCESS;}
+    char *data = malloc(done);
+    if (!data){fprintf(stderr, ALLOCATION_ERROR_MASSAGE); return EXIT_FAILURE;}
+    memcpy(data, batch->data, done);
+    PipelineMsg *msg = create_msg(MSG_DATA, data, done, batch->count);
+    if (!msg){free(data); return EXIT_FAILURE;}
+    if (!queue_push(&pipeline->word_queue, msg, &pipeline->stop))
+    {
+        free_msg(msg);
+        return EXIT_FAILURE;
+    }
+    memmove(batch->data, batch->data + done, batch->len - done);
+    batch->len -= done;
+    batch->partial_start = 0;
+    batch->count = 0;
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Split a chunk of text into words, appending them to batch.
+ */
+static int tokenize_chunk(WordBatch *batch, const char *text, size_t len)
+{
+    // Each byte becomes at most two: itself, or the NULs ending a word and
+    // a line.
+    if (batch_reserve(batch, 2 * len) == EXIT_FAILURE)
+    {
+        return EXIT_FAILURE;
+    }
+    for (size_t i = 0; i < len; i++)
+    {
+        // A NUL would end the word early in the packed batch, so it
+        // separates words like a space does.
+        bool delimiter = text[i] == '\0' || strchr(DELIMITERS, text[i]);
+        if (!delimiter)
+        {
+            if (!batch->in_word)
+            {
+                batch->in_word = true;
+                batch->partial_start = batch->len;
+            }
+            batch->data[batch->len++] = text[i];
+            continue;
+        }
+        if (batch->in_word)
+        {
+            batch->data[batch->len++] = '\0';
+            batch->in_word = false;
+            batch->count++;
+        }
+        if (text[i] == '\n')
+        {
+            batch->data[batch->len++] = '\0'; // empty word: end of line
+            batch->count++;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Stage 3: split text into NUL separated word batches.
+ */
+static void *tokenize_stage(void *arg)
+{
+    Pipeline *pipeline = arg;
+    PipelineQueue *out = &pipeline->word_queue;
+    WordBatch batch = {NULL, 0, 0, 0, 0, false};
+    PipelineMsg *msg;
+    while ((msg = queue_pop(&pipeline->text_queue, &pipeline->stop)))
+    {
+        int res = EXIT_SUCCESS;
+        if (msg->kind == MSG_DATA)
+        {
+            res = tokenize_chunk(&batch, msg->data, msg->len);
+            free_msg(msg);
+            if (res == EXIT_SUCCESS){res = flush_batch(pipeline, &batch);}
+            if (res == EXIT_FAILURE){break;}
+            continue;
+        }
+        if (msg->kind == MSG_FILE_END && batch.in_word)
+        {
+            // The last word of a file needs no trailing delimiter.
+            res = tokenize_chunk(&batch, " ", 1);
+            if (res == EXIT_SUCCESS){res = flush_batch(pipeline, &batch);}
+        }
+        MsgKind kind = msg->kind;
+        if (res == EXIT_FAILURE || !queue_push(out, msg, &pipeline->stop))
+        {
+            free_msg(msg);
+            break;
+        }
+        if (kind == MSG_END || kind == MSG_ERROR)
+        {
+            free(batch.data);
+            return NULL;
+        }
+    }
+    free(batch.data);
+    if (atomic_load(&pipeline->stop)){return NULL;}
+    return fail_stage(out, &pipeline->stop);
+}
+
+// ---------------------- CHAIN UPDATE -------------------------
+
+/**
+ * word -> MarkovNode index, so the update stage does not pay for a linear
+ * database search per word: the id of the word picks its node.
+ */
+typedef struct NodeTable {
+    WordTable words;
+    MarkovNode **nodes; // id -> node
+    size_t capacity;
+} NodeTable;
+
+static int add_node(NodeTable *table, uint32_t id, MarkovNode *markov_node)
+{
+    if (id == table->capacity)
+    {
+        size_t capacity = table->capacity ? table->capacity * 2
+                                          : INITIAL_NODES_CAPACITY;
+        MarkovNode **nodes = realloc(table->nodes,
+                                     capacity * sizeof(MarkovNode *));
+        if (!nodes){fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+            return EXIT_FAILURE;}
+        table->nodes = nodes;
+        table->capacity = capacity;
+    }
+    table->nodes[id] = markov_node;
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Find the MarkovNode of word, adding it to the chain if it is new.
+ * @param is_new set to whether the node was added
+ * @return the node, NULL on allocation failure
+ */
+static MarkovNode *intern_word(NodeTable *table, MarkovChain *markov_chain,
+    char *word, bool *is_new)
+{
+    uint32_t id = word_table_intern(&table->words, word, is_new);
+    if (id == NOT_A_WORD){return NULL;}
+    if (!*is_new){return table->nodes[id];}
+    Node *node = append_to_database(markov_chain, word);
+    if (!node || add_node(table, id, node->data) == EXIT_FAILURE)
+    {
+        return NULL;
+    }
+    return node->data;
+}
+
+/**
+ * Seed the index with whatever the chain already holds.
+ */
+static int intern_existing(NodeTable *table, MarkovChain *markov_chain)
+{
+    for (Node *cur = markov_chain->database->first; cur; cur = cur->next)
+    {
+        MarkovNode *markov_node = cur->data;
+        uint32_t id = word_table_intern(&table->words, markov_node->data,
+                                        NULL);
+        if (id == NOT_A_WORD ||
+            add_node(table, id, markov_node) == EXIT_FAILURE)
+        {
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+static void free_node_table(NodeTable *table)
+{
+    free_word_table(&table->words);
+    free(table->nodes);
+}
+
+/**
+ * Tell the hook, if any, about a step without a word.
+ */
+static int report_event(training_hook_t hook, void *context,
+    TrainingEvent event)
+{
+    if (!hook){return EXIT_SUCCESS;}
+    TrainingStep step = {event, NULL, NULL, NULL, false, false};
+    return hook(context, &step);
+}
+
+/**
+ * Stage 4, on the calling thread: learn the transitions between words.
+ */
+static int update_stage(Pipeline *pipeline, MarkovChain *markov_chain,
+    int words_to_read, MarkovDecay *decay, training_hook_t hook,
+    void *context)
+{
+    NodeTable table;
+    memset(&table, 0, sizeof(table));
+    if (intern_existing(&table, markov_chain) == EXIT_FAILURE)
+    {
+        free_node_table(&table);
+        return EXIT_FAILURE;
+    }
+    MarkovNode *prev_node = NULL;
+    int words_read = 0;
+    int status = EXIT_FAILURE;
+    PipelineMsg *msg;
+    while ((msg = queue_pop(&pipeline->word_queue, &pipeline->stop)))
+    {
+        if (msg->kind == MSG_END){status = EXIT_SUCCESS;}
+        if (msg->kind == MSG_END || msg->kind == MSG_ERROR)
+        {
+            free_msg(msg);
+            break;
+        }
+        bool failed = false;
+        if (msg->kind == MSG_FILE_END)
+        {
+            prev_node = NULL;
+            failed = report_event(hook, context, TRAINED_FILE_END)
+                     == EXIT_FAILURE;
+        }
+        char *word = msg->data;
+        for (int i = 0; i < msg->count && !failed;
+             i++, word += strlen(word) + 1)
+        {
+            if (words_to_read != -1 && words_read >= words_to_read){break;}
+            if (*word == '\0')
+            {
+                // Each line (tweet) is one decay epoch.
+                if (decay){advance_markov_decay(decay);}
+                failed = report_event(hook, context, TRAINED_LINE_END)
+                         == EXIT_FAILURE;
+                continue;
+            }
+            bool is_new;
+            MarkovNode *markov_node = intern_word(&table, markov_chain, word,
+                                                  &is_new);
+            if (!markov_node){failed = true; break;}
+            track_markov_decay(decay, markov_node);
+            if (!prev_node){record_sequence_start(markov_chain, markov_node);}
+            bool is_last = markov_chain->is_last(markov_node->data);
+            TrainingStep step = {TRAINED_WORD, word, markov_node, prev_node,
+                                 is_new, is_last};
+            failed = (prev_node && add_node_to_frequency_list(prev_node,
+                          markov_node, markov_chain) == EXIT_FAILURE) ||
+                     (hook && hook(context, &step) == EXIT_FAILURE);
+            prev_node = is_last ? NULL : markov_node;
+            words_read++;
+        }
+        free_msg(msg);
+        if (failed ||
+            report_event(hook, context, TRAINED_BATCH) == EXIT_FAILURE)
+        {
+            break;
+        }
+        if (words_to_read != -1 && words_read >= words_to_read)
+        {
+            status = EXIT_SUCCESS;
+            break;
+        }
+    }
+    free_node_table(&table);
+    return status;
+}
+
+int fill_database_from_files(MarkovChain *markov_chain,
+    const CorpusFiles *files, int words_to_read, MarkovDecay *decay,
+    training_hook_t hook, void *context)
+{
+    if (!markov_chain || !markov_chain->database || !files)
+    {
+        return EXIT_FAILURE;
+    }
+    // Aligned, so the queue indices really get a cache line each.
+    size_t size = (sizeof(Pipeline) + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE
+                  * CACHE_LINE_SIZE;
+    Pipeline *pipeline = aligned_alloc(CACHE_LINE_SIZE, size);
+    if (!pipeline){fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+        return EXIT_FAILURE;}
+    memset(pipeline, 0, size);
+    pipeline->files = files;
+    atomic_init(&pipeline->stop, false);
+    void *(*stages[NUM_STAGE_THREADS])(void *) = {read_stage,
+                                                  decompress_stage,
+                                                  tokenize_stage};
+    pthread_t threads[NUM_STAGE_THREADS];
+    int started = 0;
+    for (; started < NUM_STAGE_THREADS; started++)
+    {
+        if (pthread_create(&threads[started], NULL, stages[started],
+            pipeline) != 0){break;}
+    }
+    int status = EXIT_FAILURE;
+    if (started == NUM_STAGE_THREADS)
+    {
+        status = update_stage(pipeline, markov_chain, words_to_read, decay,
+            hook, context);
+    }
+    else
+    {
+        fprintf(stderr, PIPELINE_THREAD_ERROR);
+    }
+    // Unblock whatever is still running (e.g. words_to_read was reached).
+    atomic_store(&pipeline->stop, true);
+    for (int i = 0; i < started; i++){pthread_join(threads[i], NULL);}
+    queue_drain(&pipeline->raw_queue);
+    queue_drain(&pipeline->text_queue);
+    queue_drain(&pipeline->word_queue);
+    free(pipeline);
+    return status;
+}
+
+// ---------------------- FILE LISTING -------------------------
+
+static int add_file(CorpusFiles *files, const char *path)
+{
+    if (files->size == files->capacity)
+    {
+        int capacity = files->capacity ? files->capacity * 2
+                                       : INITIAL_FILES_CAPACITY;
+        char **paths = realloc(files->paths, capacity * sizeof(char *));
+        if (!paths){fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+            return EXIT_FAILURE;}
+        files->paths = paths;
+        files->capacity = capacity;
+    }
+    size_t len = strlen(path) + 1;
+    files->paths[files->size] = malloc(len);
+    if (!files->paths[files->size])
+    {
+        fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+        return EXIT_FAILURE;
+    }
+    memcpy(files->paths[files->size++], path, len);
+    return EXIT_SUCCESS;
+}
+
+static int skip_hidden(const struct dirent *entry)
+{
+    return entry->d_name[0] != '.';
+}
+
+static int add_path(CorpusFiles *files, const char *path)
+{
+    struct stat info;
+    if (stat(path, &info) != 0){return EXIT_FAILURE;}
+    if (!S_ISDIR(info.st_mode))
+    {
+        return S_ISREG(info.st_mode) ? add_file(files, path) : EXIT_SUCCESS;
+    }
+    struct dirent **entries;
+    int num_entries = scandir(path, &entries, skip_hidden, alphasort);
+    if (num_entries < 0){return EXIT_FAILURE;}
+    int status = EXIT_SUCCESS;
+    for (int i = 0; i < num_entries; i++)
+    {
+        if (status == EXIT_SUCCESS)
+        {
+            size_t len = strlen(path) + strlen(entries[i]->d_name) + 2;
+            char *child = malloc(len);
+            if (!child){fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+                status = EXIT_FAILURE;}
+            else
+            {
+                snprintf(child, len, "%s/%s", path, entries[i]->d_name);
+                status = add_path(files, child);
+                free(child);
+            }
+        }
+        free(entries[i]);
+    }
+    free(entries);
+    return status;
+}
+
+int collect_corpus_files(const char *path_list, CorpusFiles *files)
+{
+    *files = (CorpusFiles) {NULL, 0, 0};
+    size_t len = strlen(path_list) + 1;
+    char *list = malloc(len);
+    if (!list){fprintf(stderr, ALLOCATION_ERROR_MASSAGE); return EXIT_FAILURE;}
+    memcpy(list, path_list, len);
+    int status = EXIT_SUCCESS;
+    for (char *path = strtok(list, CORPUS_PATH_SEPARATOR);
+         path && status == EXIT_SUCCESS;
+         path = strtok(NULL, CORPUS_PATH_SEPARATOR))
+    {
+        status = add_path(files, path);
+    }
+    free(list);
+    if (status == EXIT_SUCCESS && files->size == 0){status = EXIT_FAILURE;}
+    if (status == EXIT_FAILURE){free_corpus_files(files);}
+    return status;
+}
+
+void free_corpus_files(CorpusFiles *files)
+{
+    if (!files){return;}
+    for (int i = 0; i < files->size; i++){free(files->paths[i]);}
+    free(files->paths);
+    *files = (CorpusFiles) {NULL, 0, 0};
+}
+
+uint64_t corpus_files_fingerprint(const CorpusFiles *files)
+{
+    uint64_t hash = FNV_OFFSET_BASIS;
+    struct stat info;
+    for (int i = 0; files && i < files->size; i++)
+    {
+        hash = hash_bytes(hash, files->paths[i], strlen(files->paths[i]) + 1);
+        int64_t stamp[3] = {-1, 0, 0}; // a missing file
+        if (stat(files->paths[i], &info) == 0)
+        {
+            stamp[0] = info.st_size;
+            stamp[1] = info.st_mtim.tv_sec;
+            stamp[2] = info.st_mtim.tv_nsec;
+        }
+        hash = hash_bytes(hash, stamp, sizeof(stamp));
+    }
+    return hash;
+}
+
+long long corpus_files_size(const CorpusFiles *files)
+{
+    long long size = 0;
+    struct stat info;
+    for (int i = 0; files && i < files->size; i++)
+    {
+        if (stat(files->paths[i], &info) == 0){size += info.st_size;}
+    }
+    return size;
+}
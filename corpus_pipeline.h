@@ -0,0 +1,114 @@
+#ifndef _CORPUS_PIPELINE_H
+#define _CORPUS_PIPELINE_H
+
+#include "markov_chain.h"
+#include <stdint.h> // For uint64_t
+
+#define CORPUS_PATH_SEPARATOR ","
+#define PIPELINE_QUEUE_CAPACITY 64
+#define PIPELINE_CHUNK_SIZE (64 * 1024)
+
+#define PIPELINE_READ_ERROR "Error: failed to read corpus file\n"
+#define PIPELINE_DECOMPRESS_ERROR "Error: corrupt gzip corpus file\n"
+#define PIPELINE_THREAD_ERROR "Error: failed to start ingestion thread\n"
+
+/**
+ * List of regular corpus files, in the order they are ingested.
+ */
+typedef struct CorpusFiles {
+    char **paths;
+    int size;
+    int capacity;
+} CorpusFiles;
+
+/**
+ * What a training hook is told about.
+ */
+typedef enum TrainingEvent {
+    TRAINED_WORD,     // a word was learned
+    TRAINED_LINE_END, // a line of the corpus ended
+    TRAINED_FILE_END, // a file ended, and with it the current sentence
+    TRAINED_BATCH     // a batch of words was learned (files only)
+} TrainingEvent;
+
+/**
+ * One step of training. Only TRAINED_WORD steps fill the other fields.
+ */
+typedef struct TrainingStep {
+    TrainingEvent event;
+    const char *word;      // valid during the call only
+    MarkovNode *node;      // node of the word
+    MarkovNode *prev_node; // node of the previous word of the sentence, the
+                           // source of the transition learned, or NULL if
+                           // the word starts a sentence
+    bool is_new;           // whether node was just added to the chain
+    bool is_last;          // whether the word ends its sentence
+} TrainingStep;
+
+/**
+ * Called at every step of training, from the training thread, e.g. to keep
+ * something derived from the corpus up to date.
+ * @param context whatever the hook was given along with it
+ * @param step
+ * @return EXIT_SUCCESS, or EXIT_FAILURE (error printed) to stop training
+ */
+typedef int (*training_hook_t)(void *context, const TrainingStep *step);
+
+/**
+ * Expand a CORPUS_PATH_SEPARATOR separated list of files and directories
+ * into the regular files it names. Directories are walked recursively in
+ * alphabetical order, skipping hidden entries, so ingestion order (and with
+ * it the generated output for a given seed) is reproducible.
+ * @param path_list e.g. "a.txt,archive/,b.txt.gz"
+ * @param files empty list to fill, release with free_corpus_files()
+ * @return EXIT_SUCCESS, or EXIT_FAILURE if a path does not exist or on
+ * allocation error
+ */
+int collect_corpus_files(const char *path_list, CorpusFiles *files);
+
+/**
+ * Free the memory held by a CorpusFiles list.
+ * @param files list filled by collect_corpus_files()
+ */
+void free_corpus_files(CorpusFiles *files);
+
+/**
+ * @param files list filled by collect_corpus_files()
+ * @return total size of the files on disk, in bytes
+ */
+long long corpus_files_size(const CorpusFiles *files);
+
+/**
+ * Fingerprint of the corpus as it is on disk, to tell whether something
+ * derived from it (a token index) is still up to date.
+ * @param files list filled by collect_corpus_files()
+ * @return hash of the paths, sizes and modification times of the files, in
+ * order
+ */
+uint64_t corpus_files_fingerprint(const CorpusFiles *files);
+
+/**
+ * Train markov_chain on the given files, plaintext or gzip compressed.
+ * Reading, decompression and tokenization each run on their own thread and
+ * hand work to the next stage through bounded lock-free queues, so a slow
+ * stage applies backpressure instead of growing memory. The chain itself is
+ * only updated from the calling thread, so it needs no locking. Sentences
+ * never continue across file boundaries.
+ * If a decay is given, each line is one of its epochs, and every node of the
+ * chain tracks it (see track_markov_decay()).
+ * If a hook is given, it is told about every word, line end, file end and
+ * batch of words, after the chain learned it.
+ * @param markov_chain chain with an allocated (possibly empty) database,
+ * holding strings
+ * @param files files to read, in order
+ * @param words_to_read maximum number of words to learn, -1 for all
+ * @param decay decay of the chain's weights, or NULL to count frequencies
+ * @param hook training hook, or NULL
+ * @param context passed to hook
+ * @return EXIT_SUCCESS / EXIT_FAILURE
+ */
+int fill_database_from_files(MarkovChain *markov_chain,
+    const CorpusFiles *files, int words_to_read, MarkovDecay *decay,
+    training_hook_t hook, void *context);
+
+#endif /* _CORPUS_PIPELINE_H */
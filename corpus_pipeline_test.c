@@ -0,0 +1,298 @@
+#include "corpus_pipeline.h"
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#define MAX_PATH 128
+#define MAX_LINE_LENGTH 1000
+#define TEXT_DELIMITERS " \n\t\r"
+#define NUM_VOCABULARY 40
+#define TEXT_LINES 20000 // about 300KB, several pipeline chunks
+#define MAX_LINE_WORDS 12
+#define WORD_LIMIT 12345
+#define TEST_SEED 7
+
+#define CHECK(condition) if (!(condition)) \
+    {fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+    #condition); return EXIT_FAILURE;}
+
+static const char *const vocabulary[NUM_VOCABULARY] = {
+    "the", "a", "cat", "dog", "sat", "ran", "on", "mat", "fast", "slow",
+    "#justdoit", "@nike", "run", "win", "never", "stop", "dream", "big",
+    "today", "now", "end.", "done.", "go.", "again.", "win!", "yes",
+    "no", "maybe", "always", "one", "two", "three", "four", "five", "six",
+    "seven", "eight", "nine", "ten", "it."};
+
+static void *copy_word(const void *word){return strdup(word);}
+
+static int compare_words(const void *a, const void *b){return strcmp(a, b);}
+
+static void print_word(const void *word){printf("%s", (const char *)word);}
+
+static bool is_last_word(const void *word)
+{
+    return ((const char *)word)[strlen(word) - 1] == '.';
+}
+
+static MarkovChain *create_chain(void)
+{
+    MarkovChain *markov_chain = malloc(sizeof(MarkovChain));
+    if (!markov_chain){return NULL;}
+    markov_chain->database = calloc(1, sizeof(LinkedList));
+    if (!markov_chain->database){free(markov_chain); return NULL;}
+    markov_chain->copy_func = copy_word;
+    markov_chain->comp_func = compare_words;
+    markov_chain->free_data = free;
+    markov_chain->print_func = print_word;
+    markov_chain->is_last = is_last_word;
+    return markov_chain;
+}
+
+/**
+ * A text of short lines with all the delimiters, where sentences often go
+ * on over several lines.
+ * @return the text, to free, NULL in case of allocation error
+ */
+static char *make_text(void)
+{
+    size_t size = (size_t)TEXT_LINES * MAX_LINE_WORDS * 16;
+    char *text = malloc(size);
+    if (!text){return NULL;}
+    const char *separators[] = {" ", "  ", "\t", " \t "};
+    unsigned int state = TEST_SEED;
+    size_t len = 0;
+    for (int line = 0; line < TEXT_LINES; line++)
+    {
+        state = state * 1103515245 + 12345;
+        int num_words = (state >> 16) % MAX_LINE_WORDS; // may be empty
+        for (int i = 0; i < num_words; i++)
+        {
+            state = state * 1103515245 + 12345;
+            const char *separator = separators[(state >> 8) % 4];
+            len += sprintf(text + len, "%s%s", i ? separator : "",
+                           vocabulary[(state >> 16) % NUM_VOCABULARY]);
+        }
+        len += sprintf(text + len, "%s", line % 7 ? "\n" : "\r\n");
+    }
+    return text;
+}
+
+static int write_file(const char *path, const char *text)
+{
+    FILE *fp = fopen(path, "w");
+    if (!fp){return EXIT_FAILURE;}
+    bool written = fputs(text, fp) >= 0;
+    return fclose(fp) == 0 && written ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static int write_gzip_file(const char *path, const char *text)
+{
+    gzFile gz = gzopen(path, "wb");
+    if (!gz){return EXIT_FAILURE;}
+    unsigned int size = strlen(text);
+    bool written = gzwrite(gz, text, size) == (int)size;
+    return gzclose(gz) == Z_OK && written ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * The reader tweets_generator had before the pipeline: one file, line by
+ * line, learning up to words_to_read words (-1 for all).
+ * @return EXIT_SUCCESS / EXIT_FAILURE
+ */
+static int read_single_file(MarkovChain *markov_chain, const char *path,
+    int words_to_read)
+{
+    FILE *fp = fopen(path, "r");
+    if (!fp){return EXIT_FAILURE;}
+    char line[MAX_LINE_LENGTH];
+    MarkovNode *prev_node = NULL;
+    while (words_to_read != 0 && fgets(line, sizeof(line), fp))
+    {
+        for (char *word = strtok(line, TEXT_DELIMITERS);
+             word && words_to_read != 0; word = strtok(NULL, TEXT_DELIMITERS))
+        {
+            Node *node = add_to_database(markov_chain, word);
+            if (!node || (prev_node && add_node_to_frequency_list(prev_node,
+                node->data, markov_chain) == EXIT_FAILURE))
+            {
+                fclose(fp);
+                return EXIT_FAILURE;
+            }
+            prev_node = is_last_word(word) ? NULL : node->data;
+            if (words_to_read > 0){words_to_read--;}
+        }
+    }
+    fclose(fp);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Both chains hold the same states, in the same order, with the same
+ * transitions, in the same order.
+ */
+static int check_same_chain(MarkovChain *a_chain, MarkovChain *b_chain)
+{
+    CHECK(a_chain->database->size == b_chain->database->size);
+    Node *a = a_chain->database->first;
+    Node *b = b_chain->database->first;
+    for (; a && b; a = a->next, b = b->next)
+    {
+        MarkovNode *x = a->data, *y = b->data;
+        CHECK(strcmp(x->data, y->data) == 0);
+        CHECK(x->frequency_count == y->frequency_count);
+        MarkovNodeFrequency *p = x->frequency_list, *q = y->frequency_list;
+        for (; p && q; p = p->next, q = q->next)
+        {
+            CHECK(strcmp(p->markov_node->data, q->markov_node->data) == 0);
+            CHECK(p->frequency == q->frequency);
+        }
+        CHECK(!p && !q);
+    }
+    CHECK(!a && !b);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Train a chain on a list of paths with the pipeline.
+ * @return the chain, NULL on failure
+ */
+static MarkovChain *train(const char *path_list, int words_to_read)
+{
+    CorpusFiles files;
+    if (collect_corpus_files(path_list, &files) == EXIT_FAILURE)
+    {
+        return NULL;
+    }
+    MarkovChain *markov_chain = create_chain();
+    if (markov_chain && fill_database_from_files(markov_chain, &files,
+        words_to_read, NULL, NULL, NULL) == EXIT_FAILURE)
+    {
+        free_markov_chain(&markov_chain);
+    }
+    free_corpus_files(&files);
+    return markov_chain;
+}
+
+/**
+ * A single plain file trains the chain the old reader did, with or
+ * without a word limit, and its gzip compressed copy the same chain.
+ */
+static int test_single_file(const char *plain, const char *gzip)
+{
+    int limits[] = {-1, WORD_LIMIT};
+    for (int i = 0; i < 2; i++)
+    {
+        MarkovChain *expected = create_chain();
+        CHECK(expected);
+        CHECK(read_single_file(expected, plain, limits[i]) == EXIT_SUCCESS);
+        MarkovChain *from_plain = train(plain, limits[i]);
+        MarkovChain *from_gzip = train(gzip, limits[i]);
+        CHECK(from_plain && from_gzip);
+        CHECK(check_same_chain(expected, from_plain) == EXIT_SUCCESS);
+        CHECK(check_same_chain(expected, from_gzip) == EXIT_SUCCESS);
+        free_markov_chain(&expected);
+        free_markov_chain(&from_plain);
+        free_markov_chain(&from_gzip);
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Files of a list are read in its order, each as by the old reader, so no
+ * sentence goes on from one file to the next.
+ */
+static int test_file_order(const char *first, const char *second)
+{
+    char path_list[2 * MAX_PATH + 1];
+    const char *orders[2][2] = {{first, second}, {second, first}};
+    for (int i = 0; i < 2; i++)
+    {
+        snprintf(path_list, sizeof(path_list), "%s%s%s", orders[i][0],
+                 CORPUS_PATH_SEPARATOR, orders[i][1]);
+        MarkovChain *expected = create_chain();
+        CHECK(expected);
+        CHECK(read_single_file(expected, orders[i][0], -1) == EXIT_SUCCESS);
+        CHECK(read_single_file(expected, orders[i][1], -1) == EXIT_SUCCESS);
+        MarkovChain *markov_chain = train(path_list, -1);
+        CHECK(markov_chain);
+        CHECK(check_same_chain(expected, markov_chain) == EXIT_SUCCESS);
+        free_markov_chain(&expected);
+        free_markov_chain(&markov_chain);
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * A directory expands to its regular files, recursively, in alphabetical
+ * order, without hidden entries, mixing plain and gzip files.
+ */
+static int test_directory(const char *dir, const char *text)
+{
+    char paths[5][2 * MAX_PATH];
+    const char *names[5] = {"b.txt", "a.txt.gz", ".hidden.txt", "c",
+                            "c/d.txt"};
+    for (int i = 0; i < 5; i++)
+    {
+        snprintf(paths[i], sizeof(paths[i]), "%s/%s", dir, names[i]);
+    }
+    CHECK(write_file(paths[0], "the cat ran. b\n") == EXIT_SUCCESS);
+    CHECK(write_gzip_file(paths[1], "a dog sat.\n") == EXIT_SUCCESS);
+    CHECK(write_file(paths[2], text) == EXIT_SUCCESS);
+    CHECK(mkdir(paths[3], 0700) == 0);
+    CHECK(write_file(paths[4], "d the end.\n") == EXIT_SUCCESS);
+
+    CorpusFiles files;
+    CHECK(collect_corpus_files(dir, &files) == EXIT_SUCCESS);
+    CHECK(files.size == 3);
+    CHECK(strcmp(files.paths[0], paths[1]) == 0);
+    CHECK(strcmp(files.paths[1], paths[0]) == 0);
+    CHECK(strcmp(files.paths[2], paths[4]) == 0);
+    MarkovChain *markov_chain = create_chain();
+    CHECK(markov_chain);
+    CHECK(fill_database_from_files(markov_chain, &files, -1, NULL, NULL,
+        NULL) == EXIT_SUCCESS);
+    free_corpus_files(&files);
+    // a dog sat. the cat ran. b d the end.
+    CHECK(markov_chain->database->size == 9);
+    CHECK(strcmp(markov_chain->database->first->data->data, "a") == 0);
+    MarkovNode *b = get_node_from_database(markov_chain,
+        (void *)"b")->data;
+    CHECK(!b->frequency_list); // its sentence ends with its file
+    free_markov_chain(&markov_chain);
+
+    char missing[2 * MAX_PATH];
+    snprintf(missing, sizeof(missing), "%s/missing.txt", dir);
+    CHECK(collect_corpus_files(missing, &files) == EXIT_FAILURE);
+    for (int i = 4; i >= 0; i--){remove(paths[i]);}
+    return EXIT_SUCCESS;
+}
+
+int main(void)
+{
+    char dir[] = "/tmp/corpus_pipeline_test_XXXXXX";
+    if (!mkdtemp(dir)){return EXIT_FAILURE;}
+    char plain[MAX_PATH], gzip[MAX_PATH], other[MAX_PATH];
+    char corpus_dir[MAX_PATH];
+    snprintf(plain, sizeof(plain), "%s/plain.txt", dir);
+    snprintf(gzip, sizeof(gzip), "%s/plain.txt.gz", dir);
+    snprintf(other, sizeof(other), "%s/other.txt", dir);
+    snprintf(corpus_dir, sizeof(corpus_dir), "%s/corpus", dir);
+    char *text = make_text();
+    int status = text && write_file(plain, text) == EXIT_SUCCESS &&
+                 write_gzip_file(gzip, text) == EXIT_SUCCESS &&
+                 write_file(other, "no period here\nthe end.\nand more")
+                 == EXIT_SUCCESS && mkdir(corpus_dir, 0700) == 0
+                 ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (status == EXIT_SUCCESS){status = test_single_file(plain, gzip);}
+    if (status == EXIT_SUCCESS){status = test_file_order(plain, other);}
+    if (status == EXIT_SUCCESS){status = test_directory(corpus_dir, text);}
+    free(text);
+    remove(plain);
+    remove(gzip);
+    remove(other);
+    rmdir(corpus_dir);
+    rmdir(dir);
+    if (status == EXIT_SUCCESS){printf("corpus_pipeline_test: passed\n");}
+    return status;
+}
@@ -0,0 +1,569 @@
+#include "corpus_tokens.h"
+#include "word_table.h"
+#include <string.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define TOKENS_ALIGNMENT 8
+#define INITIAL_TOKENS_CAPACITY 4096
+
+/**
+ * First bytes of a token index file.
+ */
+typedef struct TokensHeader {
+    char magic[sizeof(TOKENS_MAGIC) - 1];
+    uint64_t num_words;
+    uint64_t words_size;    // bytes of the words, padded
+    uint64_t num_tokens;
+    uint64_t num_sentences;
+    uint64_t corpus_fingerprint;
+} TokensHeader;
+
+struct TokenWriter {
+    is_last_t is_last;
+    WordTable words;
+    uint32_t *tokens;
+    uint64_t num_tokens;
+    size_t tokens_capacity;
+    uint64_t *sentence_offsets;
+    uint64_t num_sentences;
+    size_t sentences_capacity;
+    bool in_sentence;          // whether the current sentence has words
+};
+
+static size_t padded(size_t size)
+{
+    return (size + TOKENS_ALIGNMENT - 1) / TOKENS_ALIGNMENT * TOKENS_ALIGNMENT;
+}
+
+/**
+ * Make room for needed items in a growing array.
+ * @return EXIT_SUCCESS / EXIT_FAILURE in case of allocation error
+ */
+static int reserve(void **array, size_t *capacity, size_t needed,
+    size_t item_size)
+{
+    if (needed <= *capacity){return EXIT_SUCCESS;}
+    size_t new_capacity = *capacity ? *capacity : INITIAL_TOKENS_CAPACITY;
+    while (new_capacity < needed){new_capacity *= 2;}
+    void *new_array = realloc(*array, new_capacity * item_size);
+    if (!new_array)
+    {
+        fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+        return EXIT_FAILURE;
+    }
+    *array = new_array;
+    *capacity = new_capacity;
+    return EXIT_SUCCESS;
+}
+
+// ------------------------- WRITING ---------------------------
+
+TokenWriter *create_token_writer(is_last_t is_last)
+{
+    if (!is_last){return NULL;}
+    TokenWriter *writer = calloc(1, sizeof(TokenWriter));
+    if (!writer){fprintf(stderr, ALLOCATION_ERROR_MASSAGE); return NULL;}
+    writer->is_last = is_last;
+    if (reserve((void **)&writer->sentence_offsets,
+        &writer->sentences_capacity, 1, sizeof(uint64_t)) == EXIT_FAILURE)
+    {
+        free(writer);
+        return NULL;
+    }
+    writer->sentence_offsets[0] = 0;
+    return writer;
+}
+
+void free_token_writer(TokenWriter **writer_ptr)
+{
+    if (!writer_ptr || !*writer_ptr){return;}
+    TokenWriter *writer = *writer_ptr;
+    free_word_table(&writer->words);
+    free(writer->tokens);
+    free(writer->sentence_offsets);
+    free(writer);
+    *writer_ptr = NULL;
+}
+
+static int add_token(TokenWriter *writer, uint32_t token)
+{
+    if (reserve((void **)&writer->tokens, &writer->tokens_capacity,
+        writer->num_tokens + 1, sizeof(uint32_t)) == EXIT_FAILURE)
+    {
+        return EXIT_FAILURE;
+    }
+    writer->tokens[writer->num_tokens++] = token;
+    return EXIT_SUCCESS;
+}
+
+int token_writer_add_word(TokenWriter *writer, const char *word)
+{
+    uint32_t id = word_table_intern(&writer->words, word, NULL);
+    if (id == NOT_A_WORD || add_token(writer, id) == EXIT_FAILURE)
+    {
+        return EXIT_FAILURE;
+    }
+    writer->in_sentence = true;
+    return writer->is_last(word) ? token_writer_end_sentence(writer)
+                                 : EXIT_SUCCESS;
+}
+
+int token_writer_add_line_end(TokenWriter *writer)
+{
+    return add_token(writer, LINE_END_TOKEN);
+}
+
+int token_writer_end_sentence(TokenWriter *writer)
+{
+    // Line ends between sentences go with the next one.
+    if (!writer->in_sentence){return EXIT_SUCCESS;}
+    if (reserve((void **)&writer->sentence_offsets,
+        &writer->sentences_capacity, writer->num_sentences + 2,
+        sizeof(uint64_t)) == EXIT_FAILURE)
+    {
+        return EXIT_FAILURE;
+    }
+    writer->sentence_offsets[++writer->num_sentences] = writer->num_tokens;
+    writer->in_sentence = false;
+    return EXIT_SUCCESS;
+}
+
+int token_writer_hook(void *writer, const TrainingStep *step)
+{
+    if (step->event == TRAINED_WORD)
+    {
+        return token_writer_add_word(writer, step->word);
+    }
+    if (step->event == TRAINED_LINE_END)
+    {
+        return token_writer_add_line_end(writer);
+    }
+    if (step->event == TRAINED_FILE_END)
+    {
+        return token_writer_end_sentence(writer);
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Write size bytes followed by zeros up to the next alignment.
+ * @return true on success
+ */
+static bool write_padded(FILE *fp, const void *data, size_t size)
+{
+    static const char zeros[TOKENS_ALIGNMENT] = {0};
+    return (size == 0 || fwrite(data, size, 1, fp) == 1) &&
+           (padded(size) == size ||
+            fwrite(zeros, padded(size) - size, 1, fp) == 1);
+}
+
+int save_corpus_tokens(TokenWriter *writer, const char *path,
+    uint64_t fingerprint)
+{
+    if (token_writer_end_sentence(writer) == EXIT_FAILURE)
+    {
+        return EXIT_FAILURE;
+    }
+    TokensHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TOKENS_MAGIC, sizeof(header.magic));
+    header.num_words = writer->words.num_words;
+    header.words_size = padded(writer->words.words_size);
+    // Line ends after the last sentence go with it, so that training on
+    // every sentence ends at the same decay epoch as training on the text.
+    if (writer->num_sentences)
+    {
+        writer->sentence_offsets[writer->num_sentences] = writer->num_tokens;
+    }
+    header.num_tokens = writer->sentence_offsets[writer->num_sentences];
+    header.num_sentences = writer->num_sentences;
+    header.corpus_fingerprint = fingerprint;
+    FILE *fp = fopen(path, "wb");
+    if (!fp){fprintf(stderr, TOKENS_WRITE_ERROR); return EXIT_FAILURE;}
+    bool written = write_padded(fp, &header, sizeof(header)) &&
+        write_padded(fp, writer->words.words, writer->words.words_size) &&
+        write_padded(fp, writer->tokens,
+            header.num_tokens * sizeof(uint32_t)) &&
+        write_padded(fp, writer->sentence_offsets,
+            (header.num_sentences + 1) * sizeof(uint64_t));
+    if (fclose(fp) != 0 || !written)
+    {
+        fprintf(stderr, TOKENS_WRITE_ERROR);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+// ------------------------- LOADING ---------------------------
+
+bool corpus_tokens_match(const char *path, uint64_t fingerprint)
+{
+    TokensHeader header;
+    FILE *fp = fopen(path, "rb");
+    if (!fp){return false;}
+    bool read = fread(&header, sizeof(header), 1, fp) == 1;
+    fclose(fp);
+    return read && memcmp(header.magic, TOKENS_MAGIC,
+                          sizeof(header.magic)) == 0
+           && header.corpus_fingerprint == fingerprint;
+}
+
+/**
+ * Point tokens into its mapped file, checking the file is consistent.
+ * @return EXIT_SUCCESS / EXIT_FAILURE
+ */
+static int map_corpus_tokens(CorpusTokens *tokens)
+{
+    TokensHeader header;
+    if (tokens->map_size < sizeof(header)){return EXIT_FAILURE;}
+    memcpy(&header, tokens->map, sizeof(header));
+    if (memcmp(header.magic, TOKENS_MAGIC, sizeof(header.magic)) != 0 ||
+        header.num_words >= LINE_END_TOKEN ||
+        header.words_size % TOKENS_ALIGNMENT != 0 ||
+        header.words_size > tokens->map_size ||
+        header.num_tokens > tokens->map_size / sizeof(uint32_t) ||
+        header.num_sentences > tokens->map_size / sizeof(uint64_t) ||
+        sizeof(header) + header.words_size
+        + padded(header.num_tokens * sizeof(uint32_t))
+        + (header.num_sentences + 1) * sizeof(uint64_t) != tokens->map_size)
+    {
+        return EXIT_FAILURE;
+    }
+    const char *words = (const char *)tokens->map + sizeof(header);
+    tokens->num_words = header.num_words;
+    tokens->num_tokens = header.num_tokens;
+    tokens->num_sentences = header.num_sentences;
+    tokens->tokens = (const uint32_t *)(words + header.words_size);
+    tokens->sentence_offsets = (const uint64_t *)
+        (words + header.words_size
+         + padded(header.num_tokens * sizeof(uint32_t)));
+    tokens->words = malloc((header.num_words ? header.num_words : 1)
+                           * sizeof(char *));
+    if (!tokens->words){return EXIT_FAILURE;}
+    size_t offset = 0;
+    for (uint32_t id = 0; id < tokens->num_words; id++)
+    {
+        const char *end = offset < header.words_size
+            ? memchr(words + offset, '\0', header.words_size - offset) : NULL;
+        if (!end){return EXIT_FAILURE;}
+        tokens->words[id] = words + offset;
+        offset = end - words + 1;
+    }
+    for (uint64_t t = 0; t < tokens->num_tokens; t++)
+    {
+        if (tokens->tokens[t] >= tokens->num_words &&
+            tokens->tokens[t] != LINE_END_TOKEN){return EXIT_FAILURE;}
+    }
+    if (tokens->sentence_offsets[0] != 0 ||
+        tokens->sentence_offsets[tokens->num_sentences] != tokens->num_tokens)
+    {
+        return EXIT_FAILURE;
+    }
+    for (uint64_t s = 0; s < tokens->num_sentences; s++)
+    {
+        if (tokens->sentence_offsets[s] > tokens->sentence_offsets[s + 1])
+        {
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+CorpusTokens *load_corpus_tokens(const char *path)
+{
+    CorpusTokens *tokens = calloc(1, sizeof(CorpusTokens));
+    if (!tokens){fprintf(stderr, ALLOCATION_ERROR_MASSAGE); return NULL;}
+    int fd = open(path, O_RDONLY);
+    struct stat info;
+    if (fd != -1 && fstat(fd, &info) == 0 && info.st_size > 0)
+    {
+        tokens->map_size = info.st_size;
+        tokens->map = mmap(NULL, tokens->map_size, PROT_READ, MAP_PRIVATE,
+                           fd, 0);
+        if (tokens->map == MAP_FAILED){tokens->map = NULL;}
+    }
+    if (fd != -1){close(fd);}
+    if (!tokens->map || map_corpus_tokens(tokens) == EXIT_FAILURE)
+    {
+        fprintf(stderr, TOKENS_READ_ERROR);
+        free_corpus_tokens(&tokens);
+        return NULL;
+    }
+    return tokens;
+}
+
+void free_corpus_tokens(CorpusTokens **tokens_ptr)
+{
+    if (!tokens_ptr || !*tokens_ptr){return;}
+    CorpusTokens *tokens = *tokens_ptr;
+    if (tokens->map){munmap(tokens->map, tokens->map_size);}
+    free(tokens->words);
+    free(tokens);
+    *tokens_ptr = NULL;
+}
+
+// ------------------------- TRAINING --------------------------
+
+TokenSelection all_sentences(const CorpusTokens *tokens)
+{
+    TokenSelection selection = {0, tokens->num_sentences, 0, 0, false};
+    return selection;
+}
+
+/**
+ * @return whether a sentence of the selection's range is selected
+ */
+static bool is_selected(const TokenSelection *selection, uint64_t sentence)
+{
+    if (!selection->num_folds){return true;}
+    uint64_t size = selection->last - selection->first;
+    uint64_t fold_start = selection->first
+                          + size * selection->fold / selection->num_folds;
+    uint64_t fold_end = selection->first
+                        + size * (selection->fold + 1) / selection->num_folds;
+    bool in_fold = sentence >= fold_start && sentence < fold_end;
+    return in_fold == selection->in_fold;
+}
+
+int fill_database_from_tokens(MarkovChain *markov_chain,
+    const CorpusTokens *tokens, const TokenSelection *selection,
+    int words_to_read, MarkovDecay *decay, training_hook_t hook,
+    void *context)
+{
+    if (!markov_chain || !markov_chain->database || !tokens)
+    {
+        return EXIT_FAILURE;
+    }
+    // id -> MarkovNode, appended to the chain when first met
+    MarkovNode **nodes = calloc(tokens->num_words ? tokens->num_words : 1,
+                                sizeof(MarkovNode *));
+    if (!nodes){fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+        return EXIT_FAILURE;}
+    int words_read = 0;
+    for (uint64_t s = selection->first; s < selection->last; s++)
+    {
+        if (!is_selected(selection, s)){continue;}
+        MarkovNode *prev_node = NULL;
+        for (uint64_t t = tokens->sentence_offsets[s];
+             t < tokens->sentence_offsets[s + 1]; t++)
+        {
+            if (words_to_read != -1 && words_read >= words_to_read)
+            {
+                free(nodes);
+                return EXIT_SUCCESS;
+            }
+            uint32_t id = tokens->tokens[t];
+            if (id == LINE_END_TOKEN)
+            {
+                if (decay){advance_markov_decay(decay);}
+                TrainingStep step = {TRAINED_LINE_END, NULL, NULL, NULL,
+                                     false, false};
+                if (hook && hook(context, &step) == EXIT_FAILURE)
+                {
+                    free(nodes);
+                    return EXIT_FAILURE;
+                }
+                continue;
+            }
+            bool is_new = !nodes[id];
+            if (is_new)
+            {
+                Node *node = append_to_database(markov_chain,
+                                                (void *)tokens->words[id]);
+                if (!node){free(nodes); return EXIT_FAILURE;}
+                nodes[id] = node->data;
+                track_markov_decay(decay, nodes[id]);
+            }
+            if (!prev_node)
+            {
+                record_sequence_start(markov_chain, nodes[id]);
+            }
+            bool is_last = markov_chain->is_last(nodes[id]->data);
+            TrainingStep step = {TRAINED_WORD, tokens->words[id], nodes[id],
+                                 prev_node, is_new, is_last};
+            if ((prev_node && add_node_to_frequency_list(prev_node, nodes[id],
+                    markov_chain) == EXIT_FAILURE) ||
+                (hook && hook(context, &step) == EXIT_FAILURE))
+            {
+                free(nodes);
+                return EXIT_FAILURE;
+            }
+            prev_node = is_last ? NULL : nodes[id];
+            words_read++;
+        }
+    }
+    free(nodes);
+    return EXIT_SUCCESS;
+}
+
+// ------------------------- SCORING ---------------------------
+
+int score_tokens(const MarkovIndex *index, const CorpusTokens *tokens,
+    const TokenSelection *selection, double smoothing, CorpusScore *total)
+{
+    // word id -> state id, looked up once rather than per token
+    int *states = malloc((tokens->num_words ? tokens->num_words : 1)
+                         * sizeof(int));
+    if (!states){fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+        return EXIT_FAILURE;}
+    for (uint32_t id = 0; id < tokens->num_words; id++)
+    {
+        states[id] = markov_index_find(index, tokens->words[id]);
+    }
+    for (uint64_t s = selection->first; s < selection->last; s++)
+    {
+        if (!is_selected(selection, s)){continue;}
+        bool sentence_start = true;
+        int prev = NOT_IN_INDEX;
+        for (uint64_t t = tokens->sentence_offsets[s];
+             t < tokens->sentence_offsets[s + 1]; t++)
+        {
+            if (tokens->tokens[t] == LINE_END_TOKEN){continue;}
+            int state = states[tokens->tokens[t]];
+            if (!sentence_start)
+            {
+                total->log_prob += transition_log_prob(index, prev, state,
+                    smoothing);
+                total->num_transitions++;
+            }
+            sentence_start = false;
+            prev = state;
+        }
+    }
+    free(states);
+    return EXIT_SUCCESS;
+}
+
+// ------------------------ CROSS VALIDATION -------------------
+
+typedef struct FoldJob {
+    const MarkovChain *prototype;
+    const CorpusTokens *tokens;
+    const TokenSelection *range;
+    int num_folds;
+    double smoothing;
+    double half_life;
+    hash_func_t hash_func;
+    int first_fold; // the job runs folds first_fold, first_fold + step...
+    int step;
+    CorpusScore *fold_scores;
+    int status;
+} FoldJob;
+
+/**
+ * Train a chain on every fold but one, and score it on that one.
+ */
+static int run_fold(const FoldJob *job, int fold)
+{
+    MarkovChain *markov_chain = malloc(sizeof(MarkovChain));
+    if (!markov_chain){fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+        return EXIT_FAILURE;}
+    *markov_chain = *job->prototype;
+    markov_chain->database = calloc(1, sizeof(LinkedList));
+    if (!markov_chain->database)
+    {
+        fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+        free(markov_chain);
+        return EXIT_FAILURE;
+    }
+    // Each fold decays on its own, as a chain trained on its text would.
+    MarkovDecay *decay = create_markov_decay(job->half_life);
+    if (job->half_life > 0 && !decay)
+    {
+        free_markov_chain(&markov_chain);
+        return EXIT_FAILURE;
+    }
+    TokenSelection selection = *job->range;
+    selection.num_folds = job->num_folds;
+    selection.fold = fold;
+    selection.in_fold = false;
+    MarkovIndex *index = NULL;
+    int status = fill_database_from_tokens(markov_chain, job->tokens,
+        &selection, -1, decay, NULL, NULL);
+    if (status == EXIT_SUCCESS)
+    {
+        index = create_markov_index(markov_chain, job->hash_func);
+        status = index ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    if (status == EXIT_SUCCESS)
+    {
+        selection.in_fold = true;
+        status = score_tokens(index, job->tokens, &selection, job->smoothing,
+            &job->fold_scores[fold]);
+    }
+    free_markov_index(&index);
+    free_markov_chain(&markov_chain);
+    free_markov_decay(&decay);
+    return status;
+}
+
+static void *fold_job(void *arg)
+{
+    FoldJob *job = arg;
+    job->status = EXIT_SUCCESS;
+    for (int fold = job->first_fold;
+         job->status == EXIT_SUCCESS && fold < job->num_folds;
+         fold += job->step)
+    {
+        job->status = run_fold(job, fold);
+    }
+    return NULL;
+}
+
+int cross_validate(const MarkovChain *prototype, const CorpusTokens *tokens,
+    const TokenSelection *range, int num_folds, double smoothing,
+    double half_life, hash_func_t hash_func, int num_threads,
+    CorpusScore *fold_scores)
+{
+    if (num_folds < 2 || range->last - range->first < (uint64_t)num_folds)
+    {
+        fprintf(stderr, TOKENS_FOLDS_ERROR);
+        return EXIT_FAILURE;
+    }
+    if (num_threads > num_folds){num_threads = num_folds;}
+    FoldJob *jobs = malloc(num_threads * sizeof(FoldJob));
+    pthread_t *threads = malloc(num_threads * sizeof(pthread_t));
+    if (!jobs || !threads)
+    {
+        fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+        free(jobs);
+        free(threads);
+        return EXIT_FAILURE;
+    }
+    for (int fold = 0; fold < num_folds; fold++)
+    {
+        fold_scores[fold] = (CorpusScore) {0, 0};
+    }
+    for (int t = 0; t < num_threads; t++)
+    {
+        jobs[t] = (FoldJob) {prototype, tokens, range, num_folds, smoothing,
+                             half_life, hash_func, t, num_threads,
+                             fold_scores, EXIT_FAILURE};
+    }
+    // The calling thread runs the first job itself.
+    int started = 1;
+    for (; started < num_threads; started++)
+    {
+        if (pthread_create(&threads[started], NULL, fold_job,
+            &jobs[started]) != 0){break;}
+    }
+    fold_job(&jobs[0]);
+    for (int t = 1; t < started; t++){pthread_join(threads[t], NULL);}
+    int status = EXIT_SUCCESS;
+    if (started < num_threads)
+    {
+        fprintf(stderr, TOKENS_THREAD_ERROR);
+        status = EXIT_FAILURE;
+    }
+    for (int t = 0; t < started; t++)
+    {
+        if (jobs[t].status == EXIT_FAILURE){status = EXIT_FAILURE;}
+    }
+    free(jobs);
+    free(threads);
+    return status;
+}
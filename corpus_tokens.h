@@ -0,0 +1,195 @@
+#ifndef _CORPUS_TOKENS_H
+#define _CORPUS_TOKENS_H
+
+#include "markov_score.h"
+#include "corpus_pipeline.h" // For training_hook_t
+#include <stdint.h> // For uint32_t, uint64_t
+
+#define TOKENS_MAGIC "MKVTOKS2" // 8 bytes, first of a token index file
+#define LINE_END_TOKEN UINT32_MAX // token of a line end, not a word
+
+#define TOKENS_READ_ERROR "Error: failed to read token index\n"
+#define TOKENS_WRITE_ERROR "Error: failed to write token index\n"
+#define TOKENS_THREAD_ERROR "Error: failed to start cross validation \
+thread\n"
+#define TOKENS_FOLDS_ERROR "Error: fewer sentences than folds\n"
+
+/**
+ * Corpus tokenized once for all: every distinct word gets an id (in order
+ * of first appearance, which is the order a chain trained on the corpus
+ * stores its states in), and the corpus becomes an array of word ids cut
+ * into sentences, the units training and scoring select. A sentence ends
+ * after a last word (see is_last_t) or at the end of a file. Line ends are
+ * kept as LINE_END_TOKEN, since each line is a time decay epoch; those
+ * between sentences go with the next one, those after the last sentence
+ * with it.
+ *
+ * On disk: a header, the words (NUL terminated, back to back), the tokens
+ * and the sentence offsets, each part 8 byte aligned. The header keeps the
+ * fingerprint of the corpus the index was made from (see
+ * corpus_files_fingerprint()), so a stale index can be detected. Loading
+ * maps the file in memory, so it costs nothing but building the word
+ * table.
+ */
+typedef struct CorpusTokens {
+    uint32_t num_words;
+    const char **words;        // id -> word, in the mapped file
+    uint64_t num_tokens;
+    const uint32_t *tokens;    // word ids and line ends
+    uint64_t num_sentences;
+    const uint64_t *sentence_offsets; // sentence s is tokens
+                                      // [offsets[s], offsets[s+1])
+    void *map;                 // the mapped file
+    size_t map_size;
+} CorpusTokens;
+
+/**
+ * Growing token index, recorded while a corpus is read.
+ */
+typedef struct TokenWriter TokenWriter;
+
+/**
+ * Sentences of a CorpusTokens to use: those of [first, last), or only the
+ * ones in or out of one of num_folds contiguous folds of that range.
+ */
+typedef struct TokenSelection {
+    uint64_t first;
+    uint64_t last;
+    int num_folds; // 0: all sentences of the range
+    int fold;      // 0..num_folds-1
+    bool in_fold;  // true: the fold's sentences, false: all the others
+} TokenSelection;
+
+/**
+ * Create an empty token index.
+ * @param is_last tells which words end sentences
+ * @return the writer, NULL in case of allocation error
+ */
+TokenWriter *create_token_writer(is_last_t is_last);
+
+/**
+ * Free a token writer.
+ * @param writer_ptr writer to free, set to NULL
+ */
+void free_token_writer(TokenWriter **writer_ptr);
+
+/**
+ * Append a word to the index.
+ * @return EXIT_SUCCESS / EXIT_FAILURE in case of allocation error
+ */
+int token_writer_add_word(TokenWriter *writer, const char *word);
+
+/**
+ * Append a line end to the index.
+ * @return EXIT_SUCCESS / EXIT_FAILURE in case of allocation error
+ */
+int token_writer_add_line_end(TokenWriter *writer);
+
+/**
+ * End the current sentence, e.g. at the end of a file.
+ * @return EXIT_SUCCESS / EXIT_FAILURE in case of allocation error
+ */
+int token_writer_end_sentence(TokenWriter *writer);
+
+/**
+ * Training hook appending the words, line ends and file ends learned.
+ * @param writer the TokenWriter to append to
+ * @param step
+ * @return EXIT_SUCCESS / EXIT_FAILURE in case of allocation error
+ */
+int token_writer_hook(void *writer, const TrainingStep *step);
+
+/**
+ * Write the index to a file.
+ * @param writer
+ * @param path
+ * @param fingerprint fingerprint of the corpus the index was made from
+ * @return EXIT_SUCCESS / EXIT_FAILURE (error printed)
+ */
+int save_corpus_tokens(TokenWriter *writer, const char *path,
+    uint64_t fingerprint);
+
+/**
+ * Tell whether a file is a token index of the corpus with the given
+ * fingerprint, reading only its header.
+ * @param path
+ * @param fingerprint
+ * @return false if the file is missing, is not a token index (e.g. of an
+ * older format) or was made from another corpus
+ */
+bool corpus_tokens_match(const char *path, uint64_t fingerprint);
+
+/**
+ * Map a file written by save_corpus_tokens().
+ * @param path
+ * @return the index, NULL if it cannot be read (error printed)
+ */
+CorpusTokens *load_corpus_tokens(const char *path);
+
+/**
+ * Unmap and free a loaded index.
+ * @param tokens_ptr index to free, set to NULL
+ */
+void free_corpus_tokens(CorpusTokens **tokens_ptr);
+
+/**
+ * @return a selection of all the sentences of tokens
+ */
+TokenSelection all_sentences(const CorpusTokens *tokens);
+
+/**
+ * Train markov_chain on selected sentences of a token index, exactly as
+ * fill_database_from_files() would train it on their text (decay epochs
+ * included), without reading or tokenizing anything.
+ * @param markov_chain chain with an allocated empty database, holding
+ * strings
+ * @param tokens
+ * @param selection sentences to learn, in order
+ * @param words_to_read maximum number of words to learn, -1 for all
+ * @param decay decay of the chain's weights, or NULL to count frequencies
+ * @param hook told about every word and line end learned, like by
+ * fill_database_from_files(), or NULL
+ * @param context passed to hook
+ * @return EXIT_SUCCESS / EXIT_FAILURE in case of allocation error
+ */
+int fill_database_from_tokens(MarkovChain *markov_chain,
+    const CorpusTokens *tokens, const TokenSelection *selection,
+    int words_to_read, MarkovDecay *decay, training_hook_t hook,
+    void *context);
+
+/**
+ * Score selected sentences of a token index against an index built over a
+ * chain of strings, like score_lines() scores lines.
+ * @param index index of a trained chain of strings
+ * @param tokens
+ * @param selection sentences to score
+ * @param smoothing pseudo count added to every transition, > 0
+ * @param total the scores of the sentences are added to it
+ * @return EXIT_SUCCESS / EXIT_FAILURE in case of allocation error
+ */
+int score_tokens(const MarkovIndex *index, const CorpusTokens *tokens,
+    const TokenSelection *selection, double smoothing, CorpusScore *total);
+
+/**
+ * k-fold cross validation over a range of sentences: for every fold, a
+ * chain like prototype is trained on the other folds and scored on it.
+ * Folds run in parallel, one chain per thread at a time, each with its own
+ * decay.
+ * @param prototype functions of the chains to train (its database unused)
+ * @param tokens
+ * @param range sentences to cut in folds
+ * @param num_folds number of folds, >= 2
+ * @param smoothing pseudo count added to every transition, > 0
+ * @param half_life half-life of the chains' weights, in lines, or
+ * NO_HALF_LIFE
+ * @param hash_func hash of the chain's data type
+ * @param num_threads number of worker threads, >= 1
+ * @param fold_scores num_folds results, in order
+ * @return EXIT_SUCCESS / EXIT_FAILURE (error printed)
+ */
+int cross_validate(const MarkovChain *prototype, const CorpusTokens *tokens,
+    const TokenSelection *range, int num_folds, double smoothing,
+    double half_life, hash_func_t hash_func, int num_threads,
+    CorpusScore *fold_scores);
+
+#endif /* _CORPUS_TOKENS_H */
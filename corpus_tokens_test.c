@@ -0,0 +1,216 @@
+#include "corpus_tokens.h"
+#include "corpus_pipeline.h"
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#define TOLERANCE 1e-12
+#define MAX_PATH 64
+#define MAX_WORDS 64
+#define TEXT_DELIMITERS " \n\t\r"
+#define DECAY_HALF_LIFE 2
+
+#define CHECK(condition) if (!(condition)) \
+    {fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+    #condition); return EXIT_FAILURE;}
+
+// Two files: sentences over several lines, an empty line, and a sentence
+// cut by the end of its file.
+static const char *const texts[] = {
+    "the cat sat on the mat.\nthe dog ran\nfast. a cat ran.\n\n"
+    "the end. no period at the end",
+    "more text here. the cat sat.\nthe dog sat on the cat.\n"};
+#define NUM_FILES (sizeof(texts) / sizeof(texts[0]))
+
+static void *copy_word(const void *word){return strdup(word);}
+
+static int compare_words(const void *a, const void *b){return strcmp(a, b);}
+
+static void print_word(const void *word){printf("%s", (const char *)word);}
+
+static bool is_last_word(const void *word)
+{
+    return ((const char *)word)[strlen(word) - 1] == '.';
+}
+
+static MarkovChain *create_chain(void)
+{
+    MarkovChain *markov_chain = malloc(sizeof(MarkovChain));
+    if (!markov_chain){return NULL;}
+    markov_chain->database = calloc(1, sizeof(LinkedList));
+    if (!markov_chain->database){free(markov_chain); return NULL;}
+    markov_chain->copy_func = copy_word;
+    markov_chain->comp_func = compare_words;
+    markov_chain->free_data = free;
+    markov_chain->print_func = print_word;
+    markov_chain->is_last = is_last_word;
+    return markov_chain;
+}
+
+static bool close_to(double value, double expected)
+{
+    return fabs(value - expected) <= TOLERANCE * (1 + fabs(expected));
+}
+
+/**
+ * Write the corpus files, and list them in path_list.
+ */
+static int write_corpus(char paths[][MAX_PATH], char *path_list)
+{
+    path_list[0] = '\0';
+    for (size_t f = 0; f < NUM_FILES; f++)
+    {
+        snprintf(paths[f], MAX_PATH, "/tmp/corpus_tokens_test_XXXXXX");
+        int fd = mkstemp(paths[f]);
+        if (fd == -1){return EXIT_FAILURE;}
+        size_t size = strlen(texts[f]);
+        bool written = write(fd, texts[f], size) == (ssize_t)size;
+        close(fd);
+        if (!written){return EXIT_FAILURE;}
+        if (f){strcat(path_list, CORPUS_PATH_SEPARATOR);}
+        strcat(path_list, paths[f]);
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * The words of the index are those of the text, in order.
+ */
+static int check_round_trip(const CorpusTokens *tokens)
+{
+    uint64_t t = 0;
+    for (size_t f = 0; f < NUM_FILES; f++)
+    {
+        char text[256];
+        snprintf(text, sizeof(text), "%s", texts[f]);
+        char *save_ptr;
+        for (char *word = strtok_r(text, TEXT_DELIMITERS, &save_ptr); word;
+             word = strtok_r(NULL, TEXT_DELIMITERS, &save_ptr), t++)
+        {
+            while (t < tokens->num_tokens &&
+                   tokens->tokens[t] == LINE_END_TOKEN){t++;}
+            CHECK(t < tokens->num_tokens);
+            CHECK(strcmp(tokens->words[tokens->tokens[t]], word) == 0);
+        }
+    }
+    for (; t < tokens->num_tokens; t++)
+    {
+        CHECK(tokens->tokens[t] == LINE_END_TOKEN);
+    }
+    // 7 sentences end with a last word, 1 with the end of the first file.
+    CHECK(tokens->num_sentences == 8);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Both chains hold the same states, in the same order, with the same
+ * transitions and weights, and went through as many decay epochs.
+ */
+static int check_same_chain(MarkovChain *text_chain,
+    MarkovChain *token_chain, const MarkovDecay *text_decay,
+    const MarkovDecay *token_decay)
+{
+    CHECK(text_chain->database->size == token_chain->database->size);
+    CHECK(!text_decay == !token_decay);
+    CHECK(!text_decay || text_decay->epoch == token_decay->epoch);
+    Node *a = text_chain->database->first;
+    Node *b = token_chain->database->first;
+    for (; a && b; a = a->next, b = b->next)
+    {
+        MarkovNode *x = a->data, *y = b->data;
+        CHECK(strcmp(x->data, y->data) == 0);
+        CHECK(x->frequency_count == y->frequency_count);
+        CHECK(close_to(get_start_weight(x), get_start_weight(y)));
+        double x_scale = get_transition_scale(x);
+        double y_scale = get_transition_scale(y);
+        MarkovNodeFrequency *p = x->frequency_list, *q = y->frequency_list;
+        for (; p && q; p = p->next, q = q->next)
+        {
+            CHECK(strcmp(p->markov_node->data, q->markov_node->data) == 0);
+            CHECK(p->frequency == q->frequency);
+            CHECK(close_to(p->weight * x_scale, q->weight * y_scale));
+        }
+        CHECK(!p && !q);
+    }
+    CHECK(!a && !b);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Index the corpus while training on its text, then train on the index.
+ */
+static int test_tokens(const CorpusFiles *files, const char *tokens_path,
+    double half_life)
+{
+    MarkovChain *text_chain = create_chain();
+    MarkovChain *token_chain = create_chain();
+    MarkovDecay *text_decay = create_markov_decay(half_life);
+    MarkovDecay *token_decay = create_markov_decay(half_life);
+    TokenWriter *writer = create_token_writer(is_last_word);
+    CHECK(text_chain && token_chain && writer);
+    CHECK(half_life == NO_HALF_LIFE || (text_decay && token_decay));
+    CHECK(fill_database_from_files(text_chain, files, -1, text_decay,
+        token_writer_hook, writer) == EXIT_SUCCESS);
+    uint64_t fingerprint = corpus_files_fingerprint(files);
+    CHECK(save_corpus_tokens(writer, tokens_path, fingerprint)
+          == EXIT_SUCCESS);
+    CHECK(corpus_tokens_match(tokens_path, fingerprint));
+    CHECK(!corpus_tokens_match(tokens_path, fingerprint + 1));
+
+    CorpusTokens *tokens = load_corpus_tokens(tokens_path);
+    CHECK(tokens);
+    CHECK(tokens->num_words == (uint32_t)text_chain->database->size);
+    CHECK(check_round_trip(tokens) == EXIT_SUCCESS);
+    TokenSelection all = all_sentences(tokens);
+    CHECK(fill_database_from_tokens(token_chain, tokens, &all, -1,
+        token_decay, NULL, NULL) == EXIT_SUCCESS);
+    CHECK(check_same_chain(text_chain, token_chain, text_decay, token_decay)
+          == EXIT_SUCCESS);
+
+    free_corpus_tokens(&tokens);
+    free_token_writer(&writer);
+    free_markov_chain(&text_chain);
+    free_markov_chain(&token_chain);
+    free_markov_decay(&text_decay);
+    free_markov_decay(&token_decay);
+    return EXIT_SUCCESS;
+}
+
+int main(void)
+{
+    char paths[NUM_FILES][MAX_PATH];
+    char path_list[NUM_FILES * MAX_PATH];
+    char tokens_path[MAX_PATH] = "/tmp/corpus_tokens_test_XXXXXX";
+    int fd = mkstemp(tokens_path);
+    if (fd == -1){return EXIT_FAILURE;}
+    close(fd);
+    CorpusFiles files;
+    int status = write_corpus(paths, path_list);
+    if (status == EXIT_SUCCESS)
+    {
+        status = collect_corpus_files(path_list, &files);
+    }
+    if (status == EXIT_SUCCESS)
+    {
+        status = test_tokens(&files, tokens_path, NO_HALF_LIFE);
+        if (status == EXIT_SUCCESS)
+        {
+            status = test_tokens(&files, tokens_path, DECAY_HALF_LIFE);
+        }
+        // A changed corpus no longer matches its index.
+        uint64_t fingerprint = corpus_files_fingerprint(&files);
+        FILE *fp = fopen(paths[0], "a");
+        if (fp){fputs(" more.\n", fp); fclose(fp);}
+        if (status == EXIT_SUCCESS &&
+            (!fp || corpus_files_fingerprint(&files) == fingerprint))
+        {
+            fprintf(stderr, "corpus_tokens_test: fingerprint unchanged\n");
+            status = EXIT_FAILURE;
+        }
+        free_corpus_files(&files);
+    }
+    for (size_t f = 0; f < NUM_FILES; f++){remove(paths[f]);}
+    remove(tokens_path);
+    if (status == EXIT_SUCCESS){printf("corpus_tokens_test: passed\n");}
+    return status;
+}
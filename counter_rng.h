@@ -0,0 +1,50 @@
+#ifndef _COUNTER_RNG_H
+#define _COUNTER_RNG_H
+
+#include <stdint.h> // For uint64_t
+
+#define RNG_GAMMA 0x9E3779B97F4A7C15ULL
+#define RNG_UNIT_SCALE (1.0 / 9007199254740992.0) // 2^-53
+
+/**
+ * Counter based random number generator (SplitMix64): the n-th number of a
+ * stream is a pure function of (key, n), so streams can be split among
+ * threads, or recreated, without any shared state.
+ */
+typedef struct CounterRng {
+    uint64_t key;
+    uint64_t counter;
+} CounterRng;
+
+static inline uint64_t rng_mix(uint64_t x)
+{
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+/**
+ * @param seed user seed
+ * @param stream e.g. the index of the item the numbers are drawn for
+ * @return the stream's generator, positioned at its first number
+ */
+static inline CounterRng counter_rng(uint64_t seed, uint64_t stream)
+{
+    CounterRng rng = {rng_mix(rng_mix(seed) + stream * RNG_GAMMA), 0};
+    return rng;
+}
+
+static inline uint64_t rng_next(CounterRng *rng)
+{
+    return rng_mix(rng->key + ++rng->counter * RNG_GAMMA);
+}
+
+/**
+ * @return uniform double in [0, 1)
+ */
+static inline double rng_unit(CounterRng *rng)
+{
+    return (double)(rng_next(rng) >> 11) * RNG_UNIT_SCALE;
+}
+
+#endif /* _COUNTER_RNG_H */
@@ -0,0 +1,753 @@
+#include "hmm.h"
+#include "markov_chain.h"
+#include "counter_rng.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#define INITIAL_SEQUENCES_CAPACITY 1024
+#define INITIAL_SYMBOLS_CAPACITY 16384
+
+/**
+ * SIMD vectors (GCC vector extensions): a row of stride doubles is
+ * stride / HMM_VECTOR_WIDTH vectors.
+ */
+typedef double hmm_vec __attribute__((vector_size(HMM_ALIGNMENT)));
+typedef int64_t hmm_mask __attribute__((vector_size(HMM_ALIGNMENT)));
+
+/**
+ * Per thread scratch memory, sized for the longest sequence it handles.
+ */
+typedef struct HmmWorkspace {
+    double *rows;    // 3 rows of stride doubles
+    hmm_mask *best;  // Viterbi: best previous state of each lane
+    int *back;       // Viterbi: [length][stride] best previous states
+    double *alpha;   // forward: [length][stride] scaled probabilities
+    double *scales;  // forward: [length] scale of each step
+} HmmWorkspace;
+
+/**
+ * Expected counts of a Baum-Welch iteration, laid out like the model.
+ */
+typedef struct HmmCounts {
+    double *initial;
+    double *transition;
+    double *emission;
+} HmmCounts;
+
+typedef struct HmmJob {
+    const HiddenMarkovModel *model;
+    const HmmSequences *sequences;
+    int first;             // sequences [first, last)
+    int last;
+    HmmCounts counts;      // Baum-Welch
+    double log_likelihood; // Baum-Welch
+    int *states;           // decoding
+    double *log_probs;     // decoding
+    int status;
+} HmmJob;
+
+// ------------------------- VECTORS ---------------------------
+
+// mask ? a : b, lane by lane (a macro, vectors are not passed to functions)
+#define BLEND(mask, a, b) \
+    ((hmm_vec)(((hmm_mask)(a) & (mask)) | ((hmm_mask)(b) & ~(mask))))
+
+static inline double sum_vectors(const hmm_vec *x, int num_vectors)
+{
+    hmm_vec acc = {0};
+    for (int v = 0; v < num_vectors; v++){acc += x[v];}
+    double sum = 0;
+    for (int lane = 0; lane < HMM_VECTOR_WIDTH; lane++){sum += acc[lane];}
+    return sum;
+}
+
+static inline double dot_vectors(const hmm_vec *x, const hmm_vec *y,
+    int num_vectors)
+{
+    hmm_vec acc = {0};
+    for (int v = 0; v < num_vectors; v++){acc += x[v] * y[v];}
+    double sum = 0;
+    for (int lane = 0; lane < HMM_VECTOR_WIDTH; lane++){sum += acc[lane];}
+    return sum;
+}
+
+static inline const hmm_vec *vector_row(const double *rows, long row,
+    int stride)
+{
+    return (const hmm_vec *)(rows + row * stride);
+}
+
+/**
+ * Allocate aligned, zeroed rows of stride doubles.
+ */
+static double *alloc_rows(long num_rows, int stride)
+{
+    size_t size = (num_rows ? num_rows : 1) * stride * sizeof(double);
+    double *rows = aligned_alloc(HMM_ALIGNMENT, size);
+    if (rows){memset(rows, 0, size);}
+    return rows;
+}
+
+// -------------------------- MODEL ----------------------------
+
+static void update_logs(HiddenMarkovModel *model)
+{
+    long stride = model->stride;
+    for (long j = 0; j < stride; j++)
+    {
+        model->log_initial[j] = log(model->initial[j]);
+    }
+    for (long k = 0; k < model->num_states * stride; k++)
+    {
+        model->log_transition[k] = log(model->transition[k]);
+    }
+    for (long k = 0; k < model->num_symbols * stride; k++)
+    {
+        model->log_emission[k] = log(model->emission[k]);
+    }
+}
+
+/**
+ * Normalize the first num_states entries of a row.
+ */
+static void normalize_row(double *row, int num_states, double pseudo_count)
+{
+    double sum = 0;
+    for (int j = 0; j < num_states; j++){sum += row[j] + pseudo_count;}
+    for (int j = 0; j < num_states; j++)
+    {
+        row[j] = (row[j] + pseudo_count) / sum;
+    }
+}
+
+/**
+ * Normalize every column (state) of the emission matrix over the symbols.
+ * @return EXIT_SUCCESS / EXIT_FAILURE in case of allocation error (error
+ * printed, emission unchanged)
+ */
+static int normalize_emission(double *emission, int num_symbols,
+    int num_states, int stride, double pseudo_count)
+{
+    double *sums = calloc(num_states, sizeof(double));
+    if (!sums){fprintf(stderr, ALLOCATION_ERROR_MASSAGE); return EXIT_FAILURE;}
+    for (long o = 0; o < num_symbols; o++)
+    {
+        for (int j = 0; j < num_states; j++)
+        {
+            sums[j] += emission[o * stride + j] + pseudo_count;
+        }
+    }
+    for (long o = 0; o < num_symbols; o++)
+    {
+        for (int j = 0; j < num_states; j++)
+        {
+            emission[o * stride + j] = (emission[o * stride + j]
+                                        + pseudo_count) / sums[j];
+        }
+    }
+    free(sums);
+    return EXIT_SUCCESS;
+}
+
+HiddenMarkovModel *create_hmm(int num_states, int num_symbols, uint64_t seed)
+{
+    if (num_states < 1 || num_symbols < 1){return NULL;}
+    HiddenMarkovModel *model = calloc(1, sizeof(HiddenMarkovModel));
+    if (!model){fprintf(stderr, ALLOCATION_ERROR_MASSAGE); return NULL;}
+    model->num_states = num_states;
+    model->num_symbols = num_symbols;
+    model->stride = (num_states + HMM_VECTOR_WIDTH - 1) / HMM_VECTOR_WIDTH
+                    * HMM_VECTOR_WIDTH;
+    model->initial = alloc_rows(1, model->stride);
+    model->transition = alloc_rows(num_states, model->stride);
+    model->emission = alloc_rows(num_symbols, model->stride);
+    model->log_initial = alloc_rows(1, model->stride);
+    model->log_transition = alloc_rows(num_states, model->stride);
+    model->log_emission = alloc_rows(num_symbols, model->stride);
+    if (!model->initial || !model->transition || !model->emission ||
+        !model->log_initial || !model->log_transition || !model->log_emission)
+    {
+        fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+        free_hmm(&model);
+        return NULL;
+    }
+    // Near uniform, so training can break the symmetry between states.
+    CounterRng rng = counter_rng(seed, 0);
+    for (int j = 0; j < num_states; j++)
+    {
+        model->initial[j] = 1 + rng_unit(&rng);
+    }
+    normalize_row(model->initial, num_states, 0);
+    for (long i = 0; i < num_states; i++)
+    {
+        double *row = model->transition + i * model->stride;
+        for (int j = 0; j < num_states; j++){row[j] = 1 + rng_unit(&rng);}
+        normalize_row(row, num_states, 0);
+    }
+    for (long o = 0; o < num_symbols; o++)
+    {
+        for (int j = 0; j < num_states; j++)
+        {
+            model->emission[o * model->stride + j] = 1 + rng_unit(&rng);
+        }
+    }
+    if (normalize_emission(model->emission, num_symbols, num_states,
+        model->stride, 0) == EXIT_FAILURE)
+    {
+        free_hmm(&model);
+        return NULL;
+    }
+    update_logs(model);
+    return model;
+}
+
+void free_hmm(HiddenMarkovModel **model_ptr)
+{
+    if (!model_ptr || !*model_ptr){return;}
+    HiddenMarkovModel *model = *model_ptr;
+    free(model->initial);
+    free(model->transition);
+    free(model->emission);
+    free(model->log_initial);
+    free(model->log_transition);
+    free(model->log_emission);
+    free(model);
+    *model_ptr = NULL;
+}
+
+// ------------------------ SEQUENCES --------------------------
+
+int add_hmm_sequence(HmmSequences *sequences, const int *symbols, int length)
+{
+    if (!sequences || (!symbols && length) || length < 0){return EXIT_FAILURE;}
+    if (sequences->num_sequences == sequences->capacity)
+    {
+        int capacity = sequences->capacity ? 2 * sequences->capacity
+                                           : INITIAL_SEQUENCES_CAPACITY;
+        long *offsets = realloc(sequences->offsets,
+            (capacity + 1) * sizeof(long));
+        if (!offsets){return EXIT_FAILURE;}
+        if (!sequences->offsets){offsets[0] = 0;}
+        sequences->offsets = offsets;
+        sequences->capacity = capacity;
+    }
+    long start = sequences->offsets[sequences->num_sequences];
+    if (start + length > sequences->symbols_capacity)
+    {
+        long capacity = sequences->symbols_capacity
+                        ? sequences->symbols_capacity
+                        : INITIAL_SYMBOLS_CAPACITY;
+        while (capacity < start + length){capacity *= 2;}
+        int *new_symbols = realloc(sequences->symbols,
+            capacity * sizeof(int));
+        if (!new_symbols){return EXIT_FAILURE;}
+        sequences->symbols = new_symbols;
+        sequences->symbols_capacity = capacity;
+    }
+    if (length)
+    {
+        memcpy(sequences->symbols + start, symbols, length * sizeof(int));
+    }
+    sequences->offsets[++sequences->num_sequences] = start + length;
+    if (length > sequences->max_length){sequences->max_length = length;}
+    return EXIT_SUCCESS;
+}
+
+void free_hmm_sequences(HmmSequences *sequences)
+{
+    if (!sequences){return;}
+    free(sequences->offsets);
+    free(sequences->symbols);
+    memset(sequences, 0, sizeof(HmmSequences));
+}
+
+// ------------------------ WORKSPACES -------------------------
+
+static void free_workspace(HmmWorkspace *workspace)
+{
+    free(workspace->rows);
+    free(workspace->best);
+    free(workspace->back);
+    free(workspace->alpha);
+    free(workspace->scales);
+}
+
+static int init_workspace(HmmWorkspace *workspace,
+    const HiddenMarkovModel *model, int max_length)
+{
+    if (max_length < 1){max_length = 1;}
+    workspace->rows = alloc_rows(3, model->stride);
+    workspace->best = (hmm_mask *)alloc_rows(1, model->stride);
+    workspace->back = malloc((long)max_length * model->stride * sizeof(int));
+    workspace->alpha = alloc_rows(max_length, model->stride);
+    workspace->scales = malloc(max_length * sizeof(double));
+    if (!workspace->rows || !workspace->best || !workspace->back ||
+        !workspace->alpha || !workspace->scales)
+    {
+        free_workspace(workspace);
+        fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+// ------------------------- VITERBI ---------------------------
+
+/**
+ * Viterbi in log space. The max over the previous state is taken for
+ * HMM_VECTOR_WIDTH next states at once; previous states that cannot be
+ * reached are skipped.
+ * @return log probability of the best path
+ */
+static double viterbi(const HiddenMarkovModel *model, const int *symbols,
+    int length, HmmWorkspace *workspace, int *states)
+{
+    int stride = model->stride;
+    int num_vectors = stride / HMM_VECTOR_WIDTH;
+    double *delta = workspace->rows;
+    double *next = workspace->rows + stride;
+    hmm_vec *next_vec = (hmm_vec *)next;
+    hmm_mask *best = workspace->best;
+    const hmm_vec *log_initial = vector_row(model->log_initial, 0, stride);
+    const hmm_vec *log_emission = vector_row(model->log_emission,
+        symbols[0], stride);
+    for (int v = 0; v < num_vectors; v++)
+    {
+        ((hmm_vec *)delta)[v] = log_initial[v] + log_emission[v];
+    }
+    for (int t = 1; t < length; t++)
+    {
+        for (int v = 0; v < num_vectors; v++)
+        {
+            next_vec[v] = (hmm_vec){0} - INFINITY;
+            best[v] = (hmm_mask){0};
+        }
+        for (int i = 0; i < model->num_states; i++)
+        {
+            double from = delta[i];
+            if (from == -INFINITY){continue;}
+            const hmm_vec *row = vector_row(model->log_transition, i, stride);
+            hmm_mask state = (hmm_mask){0} + i;
+            for (int v = 0; v < num_vectors; v++)
+            {
+                hmm_vec candidate = from + row[v];
+                hmm_mask better = (hmm_mask)(candidate > next_vec[v]);
+                next_vec[v] = BLEND(better, candidate, next_vec[v]);
+                best[v] = (state & better) | (best[v] & ~better);
+            }
+        }
+        log_emission = vector_row(model->log_emission, symbols[t], stride);
+        int *back = workspace->back + (long)t * stride;
+        for (int v = 0; v < num_vectors; v++)
+        {
+            next_vec[v] += log_emission[v];
+            for (int lane = 0; lane < HMM_VECTOR_WIDTH; lane++)
+            {
+                back[v * HMM_VECTOR_WIDTH + lane] = (int)best[v][lane];
+            }
+        }
+        double *swap = delta;
+        delta = next;
+        next = swap;
+        next_vec = (hmm_vec *)next;
+    }
+    int state = 0;
+    for (int j = 1; j < model->num_states; j++)
+    {
+        if (delta[j] > delta[state]){state = j;}
+    }
+    double log_prob = delta[state];
+    states[length - 1] = state;
+    for (int t = length - 1; t > 0; t--)
+    {
+        state = workspace->back[(long)t * stride + state];
+        states[t - 1] = state;
+    }
+    return log_prob;
+}
+
+int hmm_viterbi(const HiddenMarkovModel *model, const int *symbols,
+    int length, int *states, double *log_prob)
+{
+    if (!model || !symbols || !states || !log_prob || length < 1)
+    {
+        return EXIT_FAILURE;
+    }
+    HmmWorkspace workspace;
+    if (init_workspace(&workspace, model, length) == EXIT_FAILURE)
+    {
+        return EXIT_FAILURE;
+    }
+    *log_prob = viterbi(model, symbols, length, &workspace, states);
+    free_workspace(&workspace);
+    return EXIT_SUCCESS;
+}
+
+// --------------------- FORWARD-BACKWARD ----------------------
+
+/**
+ * Scaled forward pass: alpha[t] is P(state at t | symbols up to t), and
+ * scales[t] is P(symbol t | symbols before it).
+ * @return log probability of the sequence
+ */
+static double forward(const HiddenMarkovModel *model, const int *symbols,
+    int length, HmmWorkspace *workspace)
+{
+    int stride = model->stride;
+    int num_vectors = stride / HMM_VECTOR_WIDTH;
+    double log_likelihood = 0;
+    for (int t = 0; t < length; t++)
+    {
+        hmm_vec *alpha = (hmm_vec *)(workspace->alpha + (long)t * stride);
+        const hmm_vec *emission = vector_row(model->emission, symbols[t],
+            stride);
+        if (t == 0)
+        {
+            const hmm_vec *initial = vector_row(model->initial, 0, stride);
+            for (int v = 0; v < num_vectors; v++){alpha[v] = initial[v];}
+        }
+        else
+        {
+            const double *prev = workspace->alpha + (long)(t - 1) * stride;
+            for (int v = 0; v < num_vectors; v++){alpha[v] = (hmm_vec){0};}
+            for (int i = 0; i < model->num_states; i++)
+            {
+                if (prev[i] == 0){continue;}
+                const hmm_vec *row = vector_row(model->transition, i, stride);
+                for (int v = 0; v < num_vectors; v++)
+                {
+                    alpha[v] += prev[i] * row[v];
+                }
+            }
+        }
+        for (int v = 0; v < num_vectors; v++){alpha[v] *= emission[v];}
+        double scale = sum_vectors(alpha, num_vectors);
+        workspace->scales[t] = scale;
+        if (scale <= 0){return -INFINITY;}
+        for (int v = 0; v < num_vectors; v++){alpha[v] /= scale;}
+        log_likelihood += log(scale);
+    }
+    return log_likelihood;
+}
+
+/**
+ * Scaled backward pass over the result of forward(), producing the
+ * posteriors (if not NULL) and adding the expected counts (if not NULL).
+ */
+static void backward(const HiddenMarkovModel *model, const int *symbols,
+    int length, HmmWorkspace *workspace, double *posteriors,
+    HmmCounts *counts)
+{
+    int stride = model->stride;
+    int num_vectors = stride / HMM_VECTOR_WIDTH;
+    hmm_vec *beta = (hmm_vec *)workspace->rows;
+    hmm_vec *prev_beta = beta + num_vectors;
+    hmm_vec *weighted = prev_beta + num_vectors;
+    for (int v = 0; v < num_vectors; v++){beta[v] = (hmm_vec){0} + 1;}
+    for (int t = length - 1; t >= 0; t--)
+    {
+        const hmm_vec *alpha = vector_row(workspace->alpha, t, stride);
+        if (t < length - 1)
+        {
+            // weighted[j] = P(symbol t+1 | j) beta[t+1][j] / scale[t+1]
+            const hmm_vec *emission = vector_row(model->emission,
+                symbols[t + 1], stride);
+            double scale = workspace->scales[t + 1];
+            for (int v = 0; v < num_vectors; v++)
+            {
+                weighted[v] = emission[v] * beta[v] / scale;
+            }
+            const double *alpha_t = (const double *)alpha;
+            double *prev = (double *)prev_beta;
+            for (int i = 0; i < model->num_states; i++)
+            {
+                const hmm_vec *row = vector_row(model->transition, i, stride);
+                prev[i] = dot_vectors(row, weighted, num_vectors);
+                if (!counts || alpha_t[i] == 0){continue;}
+                hmm_vec *count = (hmm_vec *)(counts->transition
+                                             + (long)i * stride);
+                for (int v = 0; v < num_vectors; v++)
+                {
+                    count[v] += alpha_t[i] * row[v] * weighted[v];
+                }
+            }
+            for (int j = model->num_states; j < stride; j++){prev[j] = 0;}
+            hmm_vec *swap = beta;
+            beta = prev_beta;
+            prev_beta = swap;
+        }
+        // gamma[t][j] = alpha[t][j] beta[t][j]
+        hmm_vec *posterior = posteriors
+            ? (hmm_vec *)(posteriors + (long)t * stride) : NULL;
+        hmm_vec *emission_count = counts
+            ? (hmm_vec *)(counts->emission + (long)symbols[t] * stride)
+            : NULL;
+        for (int v = 0; v < num_vectors; v++)
+        {
+            hmm_vec gamma = alpha[v] * beta[v];
+            if (posterior){posterior[v] = gamma;}
+            if (emission_count){emission_count[v] += gamma;}
+            if (counts && t == 0)
+            {
+                ((hmm_vec *)counts->initial)[v] += gamma;
+            }
+        }
+    }
+}
+
+int hmm_forward_backward(const HiddenMarkovModel *model, const int *symbols,
+    int length, double *posteriors, double *log_likelihood)
+{
+    if (!model || !symbols || !posteriors || !log_likelihood || length < 1)
+    {
+        return EXIT_FAILURE;
+    }
+    HmmWorkspace workspace;
+    if (init_workspace(&workspace, model, length) == EXIT_FAILURE)
+    {
+        return EXIT_FAILURE;
+    }
+    *log_likelihood = forward(model, symbols, length, &workspace);
+    if (*log_likelihood == -INFINITY)
+    {
+        memset(posteriors, 0, (long)length * model->stride * sizeof(double));
+    }
+    else
+    {
+        backward(model, symbols, length, &workspace, posteriors, NULL);
+    }
+    free_workspace(&workspace);
+    return EXIT_SUCCESS;
+}
+
+// ------------------------ THREADING --------------------------
+
+static int max_job_length(const HmmSequences *sequences, int first, int last)
+{
+    int max_length = 0;
+    for (int s = first; s < last; s++)
+    {
+        int length = (int)(sequences->offsets[s + 1] - sequences->offsets[s]);
+        if (length > max_length){max_length = length;}
+    }
+    return max_length;
+}
+
+static void *count_job(void *arg)
+{
+    HmmJob *job = arg;
+    const HmmSequences *sequences = job->sequences;
+    HmmWorkspace workspace;
+    job->status = init_workspace(&workspace, job->model,
+        max_job_length(sequences, job->first, job->last));
+    for (int s = job->first; job->status == EXIT_SUCCESS && s < job->last;
+         s++)
+    {
+        const int *symbols = sequences->symbols + sequences->offsets[s];
+        int length = (int)(sequences->offsets[s + 1] - sequences->offsets[s]);
+        if (length == 0){continue;}
+        double log_likelihood = forward(job->model, symbols, length,
+            &workspace);
+        job->log_likelihood += log_likelihood;
+        if (log_likelihood == -INFINITY){continue;}
+        backward(job->model, symbols, length, &workspace, NULL, &job->counts);
+    }
+    if (job->status == EXIT_SUCCESS){free_workspace(&workspace);}
+    return NULL;
+}
+
+static void *decode_job(void *arg)
+{
+    HmmJob *job = arg;
+    const HmmSequences *sequences = job->sequences;
+    HmmWorkspace workspace;
+    job->status = init_workspace(&workspace, job->model,
+        max_job_length(sequences, job->first, job->last));
+    for (int s = job->first; job->status == EXIT_SUCCESS && s < job->last;
+         s++)
+    {
+        long offset = sequences->offsets[s];
+        int length = (int)(sequences->offsets[s + 1] - offset);
+        job->log_probs[s] = length ? viterbi(job->model,
+            sequences->symbols + offset, length, &workspace,
+            job->states + offset) : 0;
+    }
+    if (job->status == EXIT_SUCCESS){free_workspace(&workspace);}
+    return NULL;
+}
+
+/**
+ * Run a job over contiguous ranges of sequences, the calling thread taking
+ * the first range.
+ * @return EXIT_SUCCESS / EXIT_FAILURE (error printed)
+ */
+static int run_jobs(void *(*job_func)(void *), HmmJob *jobs,
+    int num_threads)
+{
+    pthread_t *threads = malloc(num_threads * sizeof(pthread_t));
+    if (!threads){fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+        return EXIT_FAILURE;}
+    int started = 1;
+    for (; started < num_threads; started++)
+    {
+        if (pthread_create(&threads[started], NULL, job_func,
+            &jobs[started]) != 0){break;}
+    }
+    job_func(&jobs[0]);
+    for (int t = 1; t < started; t++){pthread_join(threads[t], NULL);}
+    free(threads);
+    int status = EXIT_SUCCESS;
+    for (int t = 0; t < started; t++)
+    {
+        if (jobs[t].status == EXIT_FAILURE){status = EXIT_FAILURE;}
+    }
+    if (started < num_threads)
+    {
+        fprintf(stderr, HMM_THREAD_ERROR);
+        status = EXIT_FAILURE;
+    }
+    return status;
+}
+
+static HmmJob *create_jobs(const HiddenMarkovModel *model,
+    const HmmSequences *sequences, int num_threads)
+{
+    HmmJob *jobs = calloc(num_threads, sizeof(HmmJob));
+    if (!jobs){fprintf(stderr, ALLOCATION_ERROR_MASSAGE); return NULL;}
+    int num_sequences = sequences->num_sequences;
+    for (int t = 0; t < num_threads; t++)
+    {
+        jobs[t].model = model;
+        jobs[t].sequences = sequences;
+        jobs[t].first = (int)((long)num_sequences * t / num_threads);
+        jobs[t].last = (int)((long)num_sequences * (t + 1) / num_threads);
+    }
+    return jobs;
+}
+
+static void free_counts(HmmCounts *counts)
+{
+    free(counts->initial);
+    free(counts->transition);
+    free(counts->emission);
+    memset(counts, 0, sizeof(HmmCounts));
+}
+
+static int init_counts(HmmCounts *counts, const HiddenMarkovModel *model)
+{
+    counts->initial = alloc_rows(1, model->stride);
+    counts->transition = alloc_rows(model->num_states, model->stride);
+    counts->emission = alloc_rows(model->num_symbols, model->stride);
+    if (!counts->initial || !counts->transition || !counts->emission)
+    {
+        free_counts(counts);
+        fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Add the counts of the other jobs into the first one, in job order.
+ */
+static void reduce_counts(const HiddenMarkovModel *model, HmmJob *jobs,
+    int num_jobs)
+{
+    long stride = model->stride;
+    long sizes[] = {stride, model->num_states * stride,
+                    model->num_symbols * stride};
+    for (int t = 1; t < num_jobs; t++)
+    {
+        double *into[] = {jobs[0].counts.initial, jobs[0].counts.transition,
+                          jobs[0].counts.emission};
+        double *from[] = {jobs[t].counts.initial, jobs[t].counts.transition,
+                          jobs[t].counts.emission};
+        for (int k = 0; k < 3; k++)
+        {
+            hmm_vec *to = (hmm_vec *)into[k];
+            const hmm_vec *add = (const hmm_vec *)from[k];
+            for (long v = 0; v < sizes[k] / HMM_VECTOR_WIDTH; v++)
+            {
+                to[v] += add[v];
+            }
+        }
+        jobs[0].log_likelihood += jobs[t].log_likelihood;
+    }
+}
+
+int hmm_baum_welch_step(HiddenMarkovModel *model,
+    const HmmSequences *sequences, int num_threads, double *log_likelihood)
+{
+    if (!model || !sequences || !log_likelihood || num_threads < 1)
+    {
+        return EXIT_FAILURE;
+    }
+    if (num_threads > sequences->num_sequences)
+    {
+        num_threads = sequences->num_sequences ? sequences->num_sequences : 1;
+    }
+    HmmJob *jobs = create_jobs(model, sequences, num_threads);
+    if (!jobs){return EXIT_FAILURE;}
+    int status = EXIT_SUCCESS;
+    for (int t = 0; t < num_threads && status == EXIT_SUCCESS; t++)
+    {
+        status = init_counts(&jobs[t].counts, model);
+    }
+    if (status == EXIT_SUCCESS){status = run_jobs(count_job, jobs,
+        num_threads);}
+    if (status == EXIT_SUCCESS)
+    {
+        reduce_counts(model, jobs, num_threads);
+        *log_likelihood = jobs[0].log_likelihood;
+        // Emissions first, in place, so a failure leaves the model as is.
+        status = normalize_emission(jobs[0].counts.emission,
+            model->num_symbols, model->num_states, model->stride,
+            HMM_PSEUDO_COUNT);
+    }
+    if (status == EXIT_SUCCESS)
+    {
+        // M step: the new parameters are the normalized expected counts.
+        HmmCounts *counts = &jobs[0].counts;
+        long stride = model->stride;
+        memcpy(model->initial, counts->initial, stride * sizeof(double));
+        normalize_row(model->initial, model->num_states, HMM_PSEUDO_COUNT);
+        memcpy(model->transition, counts->transition,
+            model->num_states * stride * sizeof(double));
+        for (long i = 0; i < model->num_states; i++)
+        {
+            normalize_row(model->transition + i * stride, model->num_states,
+                HMM_PSEUDO_COUNT);
+        }
+        memcpy(model->emission, counts->emission,
+            model->num_symbols * stride * sizeof(double));
+        update_logs(model);
+    }
+    for (int t = 0; t < num_threads; t++){free_counts(&jobs[t].counts);}
+    free(jobs);
+    return status;
+}
+
+int hmm_decode(const HiddenMarkovModel *model, const HmmSequences *sequences,
+    int num_threads, int *states, double *log_probs)
+{
+    if (!model || !sequences || !states || !log_probs || num_threads < 1)
+    {
+        return EXIT_FAILURE;
+    }
+    if (num_threads > sequences->num_sequences)
+    {
+        num_threads = sequences->num_sequences ? sequences->num_sequences : 1;
+    }
+    HmmJob *jobs = create_jobs(model, sequences, num_threads);
+    if (!jobs){return EXIT_FAILURE;}
+    for (int t = 0; t < num_threads; t++)
+    {
+        jobs[t].states = states;
+        jobs[t].log_probs = log_probs;
+    }
+    int status = run_jobs(decode_job, jobs, num_threads);
+    free(jobs);
+    return status;
+}
@@ -0,0 +1,137 @@
+#ifndef _HMM_H
+#define _HMM_H
+
+#include <stdlib.h>  // For malloc()
+#include <stdint.h>  // For uint64_t
+
+// Doubles per SIMD vector: wider vectors than the target has are split by
+// the compiler, and cost more than they save.
+#ifdef __AVX__
+#define HMM_VECTOR_WIDTH 4
+#else
+#define HMM_VECTOR_WIDTH 2
+#endif
+#define HMM_ALIGNMENT (HMM_VECTOR_WIDTH * sizeof(double))
+#define HMM_PSEUDO_COUNT 1e-3 // added to every expected count in training
+
+#define HMM_THREAD_ERROR "Error: failed to start HMM thread\n"
+
+/**
+ * Hidden Markov model over num_states hidden states emitting symbols
+ * 0..num_symbols-1 (e.g. the state ids of a MarkovIndex). Rows over the
+ * hidden states are padded to stride entries (with probability 0) and
+ * aligned, so every inner loop over the states runs on whole SIMD vectors.
+ * Probabilities are kept along with their logs (log(0) = -INFINITY), the
+ * logs being used by Viterbi.
+ */
+typedef struct HiddenMarkovModel {
+    int num_states;
+    int num_symbols;
+    int stride;             // num_states rounded up to HMM_VECTOR_WIDTH
+    double *initial;        // [stride]: P(first state = j)
+    double *transition;     // [num_states][stride]: P(next = j | i)
+    double *emission;       // [num_symbols][stride]: P(symbol | j), symbol
+                            // major so a time step reads a single row
+    double *log_initial;
+    double *log_transition;
+    double *log_emission;
+} HiddenMarkovModel;
+
+/**
+ * Observation sequences, stored back to back: sequence s is
+ * symbols[offsets[s]..offsets[s+1]).
+ */
+typedef struct HmmSequences {
+    int num_sequences;
+    int capacity;       // of offsets, minus 1
+    long *offsets;
+    int *symbols;
+    long symbols_capacity;
+    int max_length;     // length of the longest sequence
+} HmmSequences;
+
+/**
+ * Create a model with random (seeded) parameters, to be trained by
+ * hmm_baum_welch_step().
+ * @param num_states number of hidden states, >= 1
+ * @param num_symbols size of the observation vocabulary, >= 1
+ * @param seed user seed
+ * @return the model, NULL in case of allocation error
+ */
+HiddenMarkovModel *create_hmm(int num_states, int num_symbols, uint64_t seed);
+
+/**
+ * Free a model.
+ * @param model_ptr model to free, set to NULL
+ */
+void free_hmm(HiddenMarkovModel **model_ptr);
+
+/**
+ * Append a sequence to a set of sequences (initially all zero).
+ * @param sequences
+ * @param symbols symbols of the sequence
+ * @param length number of symbols
+ * @return EXIT_SUCCESS / EXIT_FAILURE in case of allocation error
+ */
+int add_hmm_sequence(HmmSequences *sequences, const int *symbols, int length);
+
+/**
+ * Free the memory held by a set of sequences, leaving it empty.
+ */
+void free_hmm_sequences(HmmSequences *sequences);
+
+/**
+ * Most likely hidden states of one sequence (log space Viterbi).
+ * @param model
+ * @param symbols observed symbols
+ * @param length number of symbols, >= 1
+ * @param states length results
+ * @param log_prob set to the log probability of the best path with the
+ * sequence, -INFINITY if the model cannot emit it
+ * @return EXIT_SUCCESS / EXIT_FAILURE in case of allocation error
+ */
+int hmm_viterbi(const HiddenMarkovModel *model, const int *symbols,
+    int length, int *states, double *log_prob);
+
+/**
+ * Posterior probability of every hidden state at every step of a sequence
+ * (scaled forward-backward).
+ * @param model
+ * @param symbols observed symbols
+ * @param length number of symbols, >= 1
+ * @param posteriors length * model->stride results: P(state j at step t) is
+ * posteriors[t * stride + j]
+ * @param log_likelihood set to the log probability of the sequence
+ * @return EXIT_SUCCESS / EXIT_FAILURE in case of allocation error
+ */
+int hmm_forward_backward(const HiddenMarkovModel *model, const int *symbols,
+    int length, double *posteriors, double *log_likelihood);
+
+/**
+ * One Baum-Welch (EM) iteration over a set of sequences: the expected
+ * counts of the current model are gathered by num_threads threads, each
+ * over a contiguous range of sequences, and the model is re-estimated from
+ * them. Results depend on the number of threads only through rounding.
+ * @param model model to update
+ * @param sequences training sequences
+ * @param num_threads number of worker threads, >= 1
+ * @param log_likelihood set to the log probability of the sequences under
+ * the model before the update
+ * @return EXIT_SUCCESS / EXIT_FAILURE (error printed)
+ */
+int hmm_baum_welch_step(HiddenMarkovModel *model,
+    const HmmSequences *sequences, int num_threads, double *log_likelihood);
+
+/**
+ * Viterbi over a set of sequences, split among num_threads threads.
+ * @param model
+ * @param sequences sequences to tag
+ * @param num_threads number of worker threads, >= 1
+ * @param states results, aligned with sequences->symbols
+ * @param log_probs sequences->num_sequences best path log probabilities
+ * @return EXIT_SUCCESS / EXIT_FAILURE (error printed)
+ */
+int hmm_decode(const HiddenMarkovModel *model, const HmmSequences *sequences,
+    int num_threads, int *states, double *log_probs);
+
+#endif /* _HMM_H */
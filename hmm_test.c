@@ -0,0 +1,171 @@
+#include "hmm.h"
+#include <stdio.h>
+#include <stdbool.h>
+#include <math.h>
+
+#define NUM_STATES 3
+#define NUM_SYMBOLS 3
+#define LENGTH 6
+#define TOLERANCE 1e-9
+#define TEST_SEED 7
+#define TRAINING_ITERATIONS 5
+
+#define CHECK(condition) if (!(condition)) \
+    {fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+    #condition); return EXIT_FAILURE;}
+
+static const double initial[NUM_STATES] = {0.5, 0.3, 0.2};
+static const double transition[NUM_STATES][NUM_STATES] = {
+    {0.6, 0.3, 0.1}, {0.2, 0.5, 0.3}, {0.3, 0.3, 0.4}};
+static const double emission[NUM_STATES][NUM_SYMBOLS] = {
+    {0.7, 0.2, 0.1}, {0.1, 0.6, 0.3}, {0.2, 0.2, 0.6}};
+static const int symbols[LENGTH] = {0, 2, 1, 1, 0, 2};
+
+static bool close_to(double value, double expected)
+{
+    return fabs(value - expected) <= TOLERANCE * (1 + fabs(expected));
+}
+
+/**
+ * Give a model the parameters above, probabilities and logs.
+ */
+static void set_parameters(HiddenMarkovModel *model)
+{
+    long stride = model->stride;
+    for (int i = 0; i < NUM_STATES; i++)
+    {
+        model->initial[i] = initial[i];
+        model->log_initial[i] = log(initial[i]);
+        for (int j = 0; j < NUM_STATES; j++)
+        {
+            model->transition[i * stride + j] = transition[i][j];
+            model->log_transition[i * stride + j] = log(transition[i][j]);
+        }
+        for (int o = 0; o < NUM_SYMBOLS; o++)
+        {
+            model->emission[o * stride + i] = emission[i][o];
+            model->log_emission[o * stride + i] = log(emission[i][o]);
+        }
+    }
+}
+
+/**
+ * Probability of every path, by enumeration: the likelihood, the posterior
+ * of every state at every step and the best path, independently of the
+ * dynamic programming under test.
+ */
+static void enumerate_paths(double *likelihood, double *posteriors,
+    int *best_path, double *best_prob)
+{
+    int num_paths = 1;
+    for (int t = 0; t < LENGTH; t++){num_paths *= NUM_STATES;}
+    *likelihood = 0;
+    *best_prob = 0;
+    for (int k = 0; k < LENGTH * NUM_STATES; k++){posteriors[k] = 0;}
+    for (int p = 0; p < num_paths; p++)
+    {
+        int path[LENGTH];
+        for (int t = 0, code = p; t < LENGTH; t++, code /= NUM_STATES)
+        {
+            path[t] = code % NUM_STATES;
+        }
+        double prob = initial[path[0]] * emission[path[0]][symbols[0]];
+        for (int t = 1; t < LENGTH; t++)
+        {
+            prob *= transition[path[t - 1]][path[t]]
+                    * emission[path[t]][symbols[t]];
+        }
+        *likelihood += prob;
+        for (int t = 0; t < LENGTH; t++)
+        {
+            posteriors[t * NUM_STATES + path[t]] += prob;
+        }
+        if (prob > *best_prob)
+        {
+            *best_prob = prob;
+            for (int t = 0; t < LENGTH; t++){best_path[t] = path[t];}
+        }
+    }
+    for (int k = 0; k < LENGTH * NUM_STATES; k++)
+    {
+        posteriors[k] /= *likelihood;
+    }
+}
+
+static int test_inference(void)
+{
+    HiddenMarkovModel *model = create_hmm(NUM_STATES, NUM_SYMBOLS, TEST_SEED);
+    CHECK(model);
+    set_parameters(model);
+    double likelihood, expected_posteriors[LENGTH * NUM_STATES], best_prob;
+    int best_path[LENGTH];
+    enumerate_paths(&likelihood, expected_posteriors, best_path, &best_prob);
+
+    double posteriors[LENGTH * HMM_VECTOR_WIDTH * 2], log_likelihood;
+    CHECK(model->stride <= HMM_VECTOR_WIDTH * 2);
+    CHECK(hmm_forward_backward(model, symbols, LENGTH, posteriors,
+          &log_likelihood) == EXIT_SUCCESS);
+    CHECK(close_to(log_likelihood, log(likelihood)));
+    for (int t = 0; t < LENGTH; t++)
+    {
+        for (int j = 0; j < NUM_STATES; j++)
+        {
+            CHECK(close_to(posteriors[t * model->stride + j],
+                           expected_posteriors[t * NUM_STATES + j]));
+        }
+    }
+
+    int states[LENGTH];
+    double log_prob;
+    CHECK(hmm_viterbi(model, symbols, LENGTH, states, &log_prob)
+          == EXIT_SUCCESS);
+    CHECK(close_to(log_prob, log(best_prob)));
+    for (int t = 0; t < LENGTH; t++){CHECK(states[t] == best_path[t]);}
+    free_hmm(&model);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Baum-Welch never lowers the likelihood, and gives the same model up to
+ * rounding whatever the number of threads.
+ */
+static int test_training(void)
+{
+    HmmSequences sequences = {0};
+    for (int s = 0; s < LENGTH; s++)
+    {
+        CHECK(add_hmm_sequence(&sequences, symbols + s, LENGTH - s)
+              == EXIT_SUCCESS);
+    }
+    HiddenMarkovModel *one = create_hmm(NUM_STATES, NUM_SYMBOLS, TEST_SEED);
+    HiddenMarkovModel *many = create_hmm(NUM_STATES, NUM_SYMBOLS, TEST_SEED);
+    CHECK(one && many);
+    double previous = -INFINITY;
+    for (int i = 0; i < TRAINING_ITERATIONS; i++)
+    {
+        double log_likelihood, threads_log_likelihood;
+        CHECK(hmm_baum_welch_step(one, &sequences, 1, &log_likelihood)
+              == EXIT_SUCCESS);
+        CHECK(hmm_baum_welch_step(many, &sequences, 3,
+              &threads_log_likelihood) == EXIT_SUCCESS);
+        CHECK(log_likelihood >= previous - TOLERANCE);
+        CHECK(close_to(threads_log_likelihood, log_likelihood));
+        previous = log_likelihood;
+    }
+    for (int k = 0; k < NUM_SYMBOLS * one->stride; k++)
+    {
+        CHECK(close_to(one->emission[k], many->emission[k]));
+    }
+    free_hmm(&one);
+    free_hmm(&many);
+    free_hmm_sequences(&sequences);
+    return EXIT_SUCCESS;
+}
+
+int main(void)
+{
+    if (test_inference() == EXIT_FAILURE ||
+        test_training() == EXIT_FAILURE){return EXIT_FAILURE;}
+    printf("hmm_test: passed\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,217 @@
+#include "markov_beam.h"
+#include <math.h>
+
+#define NO_PARENT -1
+
+BeamSearch *create_beam_search(int beam_width, int top_k, int max_length)
+{
+    if (top_k < 1 || beam_width < top_k || max_length < 2){return NULL;}
+    BeamSearch *search = calloc(1, sizeof(BeamSearch));
+    if (!search){fprintf(stderr, ALLOCATION_ERROR_MASSAGE); return NULL;}
+    search->beam_width = beam_width;
+    search->top_k = top_k;
+    search->max_length = max_length;
+    search->beams = malloc((size_t)max_length * beam_width
+                           * sizeof(BeamEntry));
+    search->beam_sizes = malloc(max_length * sizeof(int));
+    search->expanded = malloc(beam_width * sizeof(BeamEntry));
+    search->finished = malloc(top_k * sizeof(BeamEntry));
+    search->completion_states = malloc((size_t)top_k * max_length
+                                       * sizeof(int));
+    search->completions = malloc(top_k * sizeof(BeamCompletion));
+    if (!search->beams || !search->beam_sizes || !search->expanded ||
+        !search->finished || !search->completion_states ||
+        !search->completions)
+    {
+        fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+        free_beam_search(&search);
+        return NULL;
+    }
+    for (int k = 0; k < top_k; k++)
+    {
+        search->completions[k].states = search->completion_states
+                                        + (size_t)k * max_length;
+    }
+    return search;
+}
+
+void free_beam_search(BeamSearch **search_ptr)
+{
+    if (!search_ptr || !*search_ptr){return;}
+    BeamSearch *search = *search_ptr;
+    free(search->beams);
+    free(search->beam_sizes);
+    free(search->expanded);
+    free(search->finished);
+    free(search->completion_states);
+    free(search->completions);
+    free(search);
+    *search_ptr = NULL;
+}
+
+// -------------------------- HEAPS ----------------------------
+
+/**
+ * Order of the heaps: by probability, then lower state ids first, so
+ * results do not depend on how ties happen to be met.
+ */
+static bool entry_less(const BeamEntry *a, const BeamEntry *b)
+{
+    return a->prob < b->prob || (a->prob == b->prob && a->state > b->state);
+}
+
+static void sift_down(BeamEntry *heap, int size, int i)
+{
+    BeamEntry entry = heap[i];
+    for (int child = 2 * i + 1; child < size; child = 2 * i + 1)
+    {
+        if (child + 1 < size && entry_less(&heap[child + 1], &heap[child]))
+        {
+            child++;
+        }
+        if (!entry_less(&heap[child], &entry)){break;}
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = entry;
+}
+
+/**
+ * Keep entry if it is among the capacity best offered so far.
+ */
+static void heap_offer(BeamEntry *heap, int *size, int capacity,
+    const BeamEntry *entry)
+{
+    if (*size == capacity)
+    {
+        if (!entry_less(&heap[0], entry)){return;}
+        heap[0] = *entry;
+        sift_down(heap, *size, 0);
+        return;
+    }
+    int i = (*size)++;
+    while (i > 0 && entry_less(entry, &heap[(i - 1) / 2]))
+    {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i] = *entry;
+}
+
+/**
+ * @return the probability an entry needs to get in a heap, 0 if not full
+ */
+static double heap_bar(const BeamEntry *heap, int size, int capacity)
+{
+    return size == capacity ? heap[0].prob : 0;
+}
+
+// -------------------------- SEARCH ---------------------------
+
+/**
+ * Expand the partial sequences of a step into the heaps: ended ones into
+ * finished, the others into expanded.
+ * @return number of entries in expanded
+ */
+static int expand_step(BeamSearch *search, const MarkovIndex *index,
+    int step, int *num_finished)
+{
+    const BeamEntry *beam = search->beams + (size_t)step * search->beam_width;
+    bool at_end = step + 2 == search->max_length;
+    int num_expanded = 0;
+    for (int slot = 0; slot < search->beam_sizes[step]; slot++)
+    {
+        const BeamEntry *from = &beam[slot];
+        int first = index->edge_offsets[from->state];
+        int last = index->edge_offsets[from->state + 1];
+        if (first == last || index->total_weights[from->state] <= 0)
+        {
+            // A dead end ends its sequence, unless it is all of it.
+            if (step > 0)
+            {
+                heap_offer(search->finished, num_finished, search->top_k,
+                    from);
+            }
+            continue;
+        }
+        double scale = from->prob / index->total_weights[from->state];
+        for (int edge = first; edge < last; edge++)
+        {
+            BeamEntry next = {scale * index->edge_weights[edge], step + 1,
+                              slot, index->edge_targets[edge]};
+            if (next.prob < heap_bar(search->finished, *num_finished,
+                                     search->top_k)){continue;}
+            if (at_end || index->is_last[next.state])
+            {
+                heap_offer(search->finished, num_finished, search->top_k,
+                    &next);
+            }
+            else if (next.prob >= heap_bar(search->expanded, num_expanded,
+                                           search->beam_width))
+            {
+                heap_offer(search->expanded, &num_expanded,
+                    search->beam_width, &next);
+            }
+        }
+    }
+    return num_expanded;
+}
+
+/**
+ * Write the sequence ending with entry into a completion.
+ */
+static void trace_back(const BeamSearch *search, const BeamEntry *entry,
+    const MarkovIndex *index, BeamCompletion *completion)
+{
+    completion->length = entry->step + 1;
+    completion->log_prob = log(entry->prob);
+    completion->ends_sentence = index->is_last[entry->state];
+    completion->states[entry->step] = entry->state;
+    int parent = entry->parent;
+    for (int step = entry->step - 1; step >= 0; step--)
+    {
+        const BeamEntry *prev = search->beams
+                                + (size_t)step * search->beam_width + parent;
+        completion->states[step] = prev->state;
+        parent = prev->parent;
+    }
+}
+
+int beam_search(BeamSearch *search, const MarkovIndex *index, int start)
+{
+    if (start < 0 || start >= index->num_states){return 0;}
+    BeamEntry first = {1, 0, NO_PARENT, start};
+    search->beams[0] = first;
+    search->beam_sizes[0] = 1;
+    int num_finished = 0;
+    for (int step = 0; step + 1 < search->max_length; step++)
+    {
+        int num_expanded = expand_step(search, index, step, &num_finished);
+        // Nothing left, or nothing left that can beat what ended.
+        double best = 0;
+        for (int i = 0; i < num_expanded; i++)
+        {
+            if (search->expanded[i].prob > best)
+            {
+                best = search->expanded[i].prob;
+            }
+        }
+        if (!num_expanded || best < heap_bar(search->finished, num_finished,
+                                             search->top_k)){break;}
+        BeamEntry *beam = search->beams
+                          + (size_t)(step + 1) * search->beam_width;
+        for (int i = 0; i < num_expanded; i++){beam[i] = search->expanded[i];}
+        search->beam_sizes[step + 1] = num_expanded;
+    }
+    // Pop the least likely first, into the last place.
+    int num_completions = num_finished;
+    while (num_finished > 0)
+    {
+        BeamEntry worst = search->finished[0];
+        search->finished[0] = search->finished[--num_finished];
+        sift_down(search->finished, num_finished, 0);
+        trace_back(search, &worst, index,
+            &search->completions[num_finished]);
+    }
+    return num_completions;
+}
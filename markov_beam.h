@@ -0,0 +1,79 @@
+#ifndef _MARKOV_BEAM_H
+#define _MARKOV_BEAM_H
+
+#include "markov_index.h"
+
+#define DEFAULT_BEAM_WIDTH 64
+#define DEFAULT_TOP_K 5
+
+/**
+ * A partial sequence of a beam: the state it reached, coming from slot
+ * parent of the beam at the previous step, with the probability of the
+ * whole sequence given its first state.
+ */
+typedef struct BeamEntry {
+    double prob;
+    int step;   // its length - 1
+    int parent; // slot in the beam of step - 1
+    int state;
+} BeamEntry;
+
+/**
+ * One of the most likely continuations of a state.
+ */
+typedef struct BeamCompletion {
+    int *states;        // length state ids, the start state first
+    int length;
+    double log_prob;    // natural log of P(states[1..] | states[0])
+    bool ends_sentence; // false if cut at max_length or at a dead end
+} BeamCompletion;
+
+/**
+ * Everything a query needs, allocated once and reused by every query, so
+ * answering one allocates nothing. A search is used by one thread at a
+ * time; threads answering queries each create their own.
+ */
+typedef struct BeamSearch {
+    int beam_width;
+    int top_k;
+    int max_length;
+    BeamEntry *beams;     // [max_length][beam_width]: the partial sequences
+                          // kept at each step, linked by their parents
+    int *beam_sizes;      // [max_length]
+    BeamEntry *expanded;  // min heap of the beam_width best expansions
+    BeamEntry *finished;  // min heap of the top_k best ended sequences
+    int *completion_states;      // [top_k][max_length]
+    BeamCompletion *completions; // [top_k], most likely first
+} BeamSearch;
+
+/**
+ * Create the context of top-k queries.
+ * @param beam_width partial sequences kept at each step, >= top_k
+ * @param top_k number of completions to find, >= 1
+ * @param max_length maximum length of a completion (with its start), >= 2
+ * @return the search, NULL in case of allocation error
+ */
+BeamSearch *create_beam_search(int beam_width, int top_k, int max_length);
+
+/**
+ * Free a search context.
+ * @param search_ptr search to free, set to NULL
+ */
+void free_beam_search(BeamSearch **search_ptr);
+
+/**
+ * Find the top_k most likely sequences starting at a state (beam search).
+ * A sequence ends at a last state (after at least one transition), at a
+ * state without transitions, or at max_length states, like a generated
+ * one. The search stops early once no partial sequence can beat the
+ * top_k sequences already ended, since probabilities only shrink as
+ * sequences grow. Allocation free.
+ * @param search context, its completions are overwritten
+ * @param index index of a trained chain
+ * @param start id of the first state
+ * @return number of completions found (<= top_k), in search->completions
+ * from the most likely
+ */
+int beam_search(BeamSearch *search, const MarkovIndex *index, int start);
+
+#endif /* _MARKOV_BEAM_H */
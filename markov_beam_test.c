@@ -0,0 +1,204 @@
+#include "markov_beam.h"
+#include "counter_rng.h"
+#include <string.h>
+#include <math.h>
+
+#define TOLERANCE 1e-12
+#define MAX_WORD_LENGTH 8
+#define NUM_RANDOM_WORDS 24
+#define RANDOM_TRANSITIONS 60
+#define RANDOM_MAX_LENGTH 5
+#define RANDOM_TOP_K 10
+#define WIDE_BEAM 4096 // more than all the partial sequences
+#define MAX_SEQUENCES 100000
+#define TEST_SEED 99
+
+#define CHECK(condition) if (!(condition)) \
+    {fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+    #condition); return EXIT_FAILURE;}
+
+static void *copy_word(const void *word){return strdup(word);}
+
+static int compare_words(const void *a, const void *b){return strcmp(a, b);}
+
+static void print_word(const void *word){printf("%s", (const char *)word);}
+
+static bool is_last_word(const void *word)
+{
+    return ((const char *)word)[strlen(word) - 1] == '.';
+}
+
+static uint64_t hash_word(const void *word)
+{
+    uint64_t hash = 5381;
+    for (const char *c = word; *c; c++){hash = hash * 33 + *c;}
+    return hash;
+}
+
+static MarkovChain *create_chain(void)
+{
+    MarkovChain *markov_chain = malloc(sizeof(MarkovChain));
+    if (!markov_chain){return NULL;}
+    markov_chain->database = calloc(1, sizeof(LinkedList));
+    if (!markov_chain->database){free(markov_chain); return NULL;}
+    markov_chain->copy_func = copy_word;
+    markov_chain->comp_func = compare_words;
+    markov_chain->free_data = free;
+    markov_chain->print_func = print_word;
+    markov_chain->is_last = is_last_word;
+    return markov_chain;
+}
+
+/**
+ * Count one transition between two words, adding them as needed.
+ */
+static int learn(MarkovChain *markov_chain, const char *from, const char *to)
+{
+    Node *first = add_to_database(markov_chain, (void *)from);
+    Node *second = add_to_database(markov_chain, (void *)to);
+    if (!first || !second){return EXIT_FAILURE;}
+    return add_node_to_frequency_list(first->data, second->data,
+                                      markov_chain);
+}
+
+/**
+ * a -> b (3), c (1); b -> "y." (2), "x." (1); c -> "z." (1). From a:
+ * "a b y." 1/2, "a b x." 1/4 and "a c z." 1/4, the tie going to "x." as it
+ * was added first.
+ */
+static int test_small_chain(void)
+{
+    MarkovChain *markov_chain = create_chain();
+    CHECK(markov_chain);
+    const char *transitions[][2] = {{"a", "b"}, {"b", "y."}, {"a", "b"},
+        {"b", "y."}, {"a", "b"}, {"b", "x."}, {"a", "c"}, {"c", "z."}};
+    for (size_t i = 0; i < sizeof(transitions) / sizeof(transitions[0]); i++)
+    {
+        CHECK(learn(markov_chain, transitions[i][0], transitions[i][1])
+              == EXIT_SUCCESS);
+    }
+    MarkovIndex *index = create_markov_index(markov_chain, hash_word);
+    BeamSearch *search = create_beam_search(3, 3, 5);
+    CHECK(index && search);
+    int a = markov_index_find(index, "a");
+    CHECK(beam_search(search, index, a) == 3);
+    const char *expected[][3] = {{"a", "b", "y."}, {"a", "b", "x."},
+                                 {"a", "c", "z."}};
+    const double expected_probs[] = {0.5, 0.25, 0.25};
+    for (int k = 0; k < 3; k++)
+    {
+        const BeamCompletion *completion = &search->completions[k];
+        CHECK(completion->length == 3 && completion->ends_sentence);
+        CHECK(fabs(completion->log_prob - log(expected_probs[k]))
+              < TOLERANCE);
+        for (int i = 0; i < 3; i++)
+        {
+            CHECK(strcmp(index->states[completion->states[i]]->data,
+                         expected[k][i]) == 0);
+        }
+    }
+    // Cut at max_length: the two prefixes, unfinished.
+    free_beam_search(&search);
+    search = create_beam_search(2, 2, 2);
+    CHECK(search && beam_search(search, index, a) == 2);
+    CHECK(search->completions[0].length == 2);
+    CHECK(!search->completions[0].ends_sentence);
+    CHECK(fabs(search->completions[0].log_prob - log(0.75)) < TOLERANCE);
+    CHECK(fabs(search->completions[1].log_prob - log(0.25)) < TOLERANCE);
+    // Nothing follows a last state.
+    CHECK(beam_search(search, index, markov_index_find(index, "y.")) == 0);
+    free_beam_search(&search);
+    free_markov_index(&index);
+    free_markov_chain(&markov_chain);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Probabilities of every sequence from state that beam_search() can
+ * complete, by depth first enumeration.
+ */
+static void enumerate(const MarkovIndex *index, int state, int length,
+    double prob, double *probs, int *num_probs)
+{
+    int first = index->edge_offsets[state];
+    int last = index->edge_offsets[state + 1];
+    bool ended = length > 1 && index->is_last[state];
+    if (ended || length == RANDOM_MAX_LENGTH || first == last)
+    {
+        if (length > 1 && *num_probs < MAX_SEQUENCES)
+        {
+            probs[(*num_probs)++] = prob;
+        }
+        return;
+    }
+    for (int edge = first; edge < last; edge++)
+    {
+        enumerate(index, index->edge_targets[edge], length + 1,
+            prob * index->edge_weights[edge] / index->total_weights[state],
+            probs, num_probs);
+    }
+}
+
+static int compare_probs(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x < y) - (x > y);
+}
+
+/**
+ * With a beam wide enough to keep everything, the completions of a random
+ * chain are exactly its most likely sequences, most likely first.
+ */
+static int test_random_chain(void)
+{
+    MarkovChain *markov_chain = create_chain();
+    double *probs = malloc(MAX_SEQUENCES * sizeof(double));
+    CHECK(markov_chain && probs);
+    CounterRng rng = counter_rng(TEST_SEED, 0);
+    char words[NUM_RANDOM_WORDS][MAX_WORD_LENGTH];
+    for (int w = 0; w < NUM_RANDOM_WORDS; w++)
+    {
+        snprintf(words[w], MAX_WORD_LENGTH, w % 4 == 3 ? "w%d." : "w%d", w);
+    }
+    for (int i = 0; i < RANDOM_TRANSITIONS; i++)
+    {
+        int from = rng_next(&rng) % NUM_RANDOM_WORDS;
+        int to = rng_next(&rng) % NUM_RANDOM_WORDS;
+        if (is_last_word(words[from])){continue;}
+        CHECK(learn(markov_chain, words[from], words[to]) == EXIT_SUCCESS);
+    }
+    MarkovIndex *index = create_markov_index(markov_chain, hash_word);
+    BeamSearch *search = create_beam_search(WIDE_BEAM, RANDOM_TOP_K,
+                                            RANDOM_MAX_LENGTH);
+    CHECK(index && search);
+    for (int start = 0; start < index->num_states; start++)
+    {
+        int num_probs = 0;
+        if (!index->is_last[start])
+        {
+            enumerate(index, start, 1, 1, probs, &num_probs);
+        }
+        qsort(probs, num_probs, sizeof(double), compare_probs);
+        int expected = num_probs < RANDOM_TOP_K ? num_probs : RANDOM_TOP_K;
+        CHECK(beam_search(search, index, start) == expected);
+        for (int k = 0; k < expected; k++)
+        {
+            CHECK(fabs(search->completions[k].log_prob - log(probs[k]))
+                  < TOLERANCE);
+            CHECK(search->completions[k].states[0] == start);
+        }
+    }
+    free(probs);
+    free_beam_search(&search);
+    free_markov_index(&index);
+    free_markov_chain(&markov_chain);
+    return EXIT_SUCCESS;
+}
+
+int main(void)
+{
+    if (test_small_chain() == EXIT_FAILURE ||
+        test_random_chain() == EXIT_FAILURE){return EXIT_FAILURE;}
+    printf("markov_beam_test: passed\n");
+    return EXIT_SUCCESS;
+}
@@ -1,5 +1,10 @@
 #include "markov_chain.h"
 #include <string.h>
+#include <math.h>
+#include <float.h>
+
+#define HALF 0.5
+
 /**
  * Get random number between 0 and max_number [0, max_number).
  * @param max_number
@@ -7,6 +12,129 @@
  */
 int get_random_number(int max_number){return(max_number)?rand()%max_number:0;}
 
+/**
+ * Get random real number between 0 and max_number [0, max_number).
+ * @param max_number
+ * @return Random number
+ */
+double get_random_real(double max_number)
+{
+    return max_number * ((double)rand() / ((double)RAND_MAX + 1));
+}
+
+MarkovDecay *create_markov_decay(double half_life)
+{
+    if (half_life <= 0){return NULL;}
+    MarkovDecay *decay = malloc(sizeof(MarkovDecay));
+    if (!decay){fprintf(stderr, ALLOCATION_ERROR_MASSAGE); return NULL;}
+    *decay = (MarkovDecay) {log(HALF) / half_life, 0, 0, 0, 0};
+    return decay;
+}
+
+void free_markov_decay(MarkovDecay **decay_ptr)
+{
+    if (!decay_ptr){return;}
+    free(*decay_ptr);
+    *decay_ptr = NULL;
+}
+
+void advance_markov_decay(MarkovDecay *decay)
+{
+    decay->epoch++;
+}
+
+void track_markov_decay(MarkovDecay *decay, MarkovNode *node)
+{
+    if (!decay || !node || node->decay){return;}
+    node->decay = decay;
+    node->decay_epoch = decay->epoch;
+    node->log_weight_scale = 0;
+}
+
+/**
+ * @return log of a weight scale, as of the current epoch. Scales are kept in
+ * log space, since the scale of a node left alone for long underflows.
+ * @param decay
+ * @param log_scale log of the scale
+ * @param epoch epoch it is as of
+ */
+static double current_log_scale(const MarkovDecay *decay, double log_scale,
+    long epoch)
+{
+    return log_scale + decay->log_factor * (double)(decay->epoch - epoch);
+}
+
+/**
+ * Bring the weight scale of a decaying node up to the current epoch before
+ * a new observation is added to it, folding it into the stored weights when
+ * it gets too small for the new observation's stored weight to be
+ * represented.
+ * Old weights folded to 0 are negligible next to the new observation.
+ * @param node - the MarkovNode to update.
+ */
+static void refresh_decay(MarkovNode *node)
+{
+    node->log_weight_scale = current_log_scale(node->decay,
+        node->log_weight_scale, node->decay_epoch);
+    node->decay_epoch = node->decay->epoch;
+    if (node->log_weight_scale >= log(MIN_WEIGHT_SCALE)){return;}
+    double scale = exp(node->log_weight_scale);
+    for (MarkovNodeFrequency *freq = node->frequency_list; freq;
+         freq = freq->next)
+        {
+        freq->weight *= scale;
+        }
+    node->start_weight *= scale;
+    node->log_weight_scale = 0;
+}
+
+void record_sequence_start(MarkovChain *markov_chain, MarkovNode *node)
+{
+    if (!markov_chain || !node || !node->decay ||
+        markov_chain->is_last(node->data)){return;}
+    refresh_decay(node);
+    node->start_weight += exp(-node->log_weight_scale);
+    // The total decays like every start, so it is kept the same way.
+    MarkovDecay *decay = node->decay;
+    decay->log_start_scale = current_log_scale(decay,
+        decay->log_start_scale, decay->start_epoch);
+    decay->start_epoch = decay->epoch;
+    if (decay->log_start_scale < log(MIN_WEIGHT_SCALE))
+        {
+        decay->start_total *= exp(decay->log_start_scale);
+        decay->log_start_scale = 0;
+        }
+    decay->start_total += exp(-decay->log_start_scale);
+}
+
+double get_transition_scale(const MarkovNode *node)
+{
+    if (!node->decay){return 1;}
+    double log_scale = current_log_scale(node->decay,
+        node->log_weight_scale, node->decay_epoch);
+    if (log_scale >= log(DBL_MIN)){return exp(log_scale);}
+    double max_weight = 0;
+    for (const MarkovNodeFrequency *freq = node->frequency_list; freq;
+         freq = freq->next)
+        {
+        max_weight = fmax(max_weight, freq->weight);
+        }
+    if (max_weight <= 0){return 0;}
+    // Keep the largest weight representable, so the proportions survive.
+    return exp(fmax(log_scale + log(max_weight), log(DBL_MIN))) / max_weight;
+}
+
+double get_start_weight(const MarkovNode *node)
+{
+    const MarkovDecay *decay = node->decay;
+    if (!decay || node->start_weight <= 0){return 0;}
+    // In units of the start total, which only differs by a common factor.
+    double log_scale = current_log_scale(decay, node->log_weight_scale,
+        node->decay_epoch) - current_log_scale(decay, decay->log_start_scale,
+        decay->start_epoch);
+    return node->start_weight * exp(log_scale);
+}
+
 /**
  * Function to create a new MarkovNode.
  * @param word - the word data for the node.
@@ -27,6 +155,12 @@ MarkovNode* create_markov_node(MarkovChain *markov_chain, void *data_ptr)
     // Initialize Node.
     new_node->frequency_list = NULL;
     new_node->frequency_count = 0;
+    new_node->log_weight_scale = 0;
+    new_node->decay_epoch = 0;
+    new_node->decay = NULL;
+    new_node->start_weight = 0;
+    new_node->published = NULL;
+    new_node->snapshot_dirty = false;
 
     return new_node;
 }
@@ -43,6 +177,7 @@ MarkovNodeFrequency* create_markov_node_frequency(MarkovNode *markov_node)
     if (!new_frequency){printf(ALLOCATION_ERROR_MASSAGE); return NULL;}
     new_frequency->markov_node = markov_node;
     new_frequency->frequency = 0;
+    new_frequency->weight = 0;
     new_frequency->next = NULL;
     return new_frequency;
 }
@@ -81,6 +216,18 @@ Node* add_to_database(MarkovChain *markov_chain, void *data_ptr)
     Node *found_node = get_node_from_database(markov_chain, data_ptr);
     if (found_node){return found_node;}
     // data_ptr (word) is not in our MarkovChain => we can add it.
+    return append_to_database(markov_chain, data_ptr);
+}
+
+/**
+ * Function to add a word known to be missing from the MarkovChain.
+ * @param markov_chain - pointer to the MarkovChain.
+ * @param data_ptr - pointer for the word to add.
+ * @return - pointer to the new Node, NULL on allocation failure.
+ */
+Node* append_to_database(MarkovChain *markov_chain, void *data_ptr)
+{
+    if (!markov_chain || !data_ptr) {return NULL;}
     MarkovNode *new_markov_node = create_markov_node(markov_chain, data_ptr);
     if (!new_markov_node){return NULL;}
     // Created a valid MarkovNode and will now attempt to add to the database.
@@ -99,21 +246,32 @@ Node* add_to_database(MarkovChain *markov_chain, void *data_ptr)
  * If already in list, update it's occurrence frequency value.
  * @param first_node
  * @param second_node
+ * @param markov_chain - unused, every state has exactly one MarkovNode
  * @return EXIT_SUCCESS / EXIT_FAILURE (in the case of allocation error)
  */
 int add_node_to_frequency_list(MarkovNode *first_node, MarkovNode *second_node,
     MarkovChain *markov_chain)
 {
+    (void)markov_chain;
     if (!first_node || !second_node){return EXIT_FAILURE;}
+    // A new observation weighs 1 at the current epoch.
+    double weight = 1;
+    if (first_node->decay)
+        {
+        refresh_decay(first_node);
+        weight = exp(-first_node->log_weight_scale);
+        }
     MarkovNodeFrequency *current = first_node->frequency_list;
     MarkovNodeFrequency *prev = NULL;
 
     // Check if second_node is already in the list
     while (current)
         {
-        if (!markov_chain->comp_func(current->markov_node, second_node))
+        // Every state has exactly one MarkovNode, so identity is equality.
+        if (current->markov_node == second_node)
             {
             current->frequency++;
+            current->weight += weight;
             return EXIT_SUCCESS;
             }
         prev = current;
@@ -126,6 +284,7 @@ int add_node_to_frequency_list(MarkovNode *first_node, MarkovNode *second_node,
 
     new_freq->markov_node = second_node;
     new_freq->frequency = 1;
+    new_freq->weight = weight;
     new_freq->next = NULL;
 
     if (prev){prev->next = new_freq;}
@@ -170,6 +329,33 @@ void free_markov_chain(MarkovChain **chain_ptr)
     *chain_ptr = NULL;
 }
 
+/**
+ * Choose a non-last MarkovNode by the decayed weight of the sequences that
+ * started at it, in one pass against the chain's running start total.
+ * @param markov_chain
+ * @return the random MarkovNode, NULL if no start was recorded
+ */
+static MarkovNode* get_first_decayed_node(MarkovChain *markov_chain)
+{
+    // Every node of the chain tracks the same decay.
+    const MarkovDecay *decay = markov_chain->database->first->data->decay;
+    if (decay->start_total <= 0){return NULL;}
+    double rand_value = get_random_real(decay->start_total);
+    MarkovNode *last_candidate = NULL;
+    for (Node *current = markov_chain->database->first; current;
+         current = current->next)
+        {
+        MarkovNode *node = current->data;
+        double weight = get_start_weight(node);
+        if (weight <= 0){continue;}
+        last_candidate = node;
+        rand_value -= weight;
+        if (rand_value < 0){return node;}
+        }
+    // Only reachable through rounding errors.
+    return last_candidate;
+}
+
 /**
  * Get one random MarkovNode from the given markov_chain's database.
  * @param markov_chain
@@ -179,6 +365,11 @@ MarkovNode* get_first_random_node(MarkovChain *markov_chain)
 {
     if (!markov_chain || !markov_chain->database ||
         markov_chain->database->size == 0) {return NULL;}
+    if (markov_chain->database->first->data->decay)
+        {
+        MarkovNode *node = get_first_decayed_node(markov_chain);
+        if (node){return node;}
+        }
     int index = get_random_number(markov_chain->database->size);
     Node *current = markov_chain->database->first;
     for (int i = 0; i < index; i++) {
@@ -199,6 +390,31 @@ MarkovNode* get_first_random_node(MarkovChain *markov_chain)
     return node;
 }
 
+/**
+ * Choose randomly the next MarkovNode, depend on its decayed weight. All the
+ * transitions of a node share its weight scale, so the stored weights are
+ * already in proportion.
+ * @param cur_markov_node - current MarkovNode
+ * @return the next random MarkovNode
+ */
+static MarkovNode* get_next_decayed_node(MarkovNode *cur_markov_node)
+{
+    double total_weight = 0;
+    MarkovNodeFrequency *current = cur_markov_node->frequency_list;
+    for (; current; current = current->next){total_weight += current->weight;}
+    double rand_value = get_random_real(total_weight);
+    MarkovNodeFrequency *last = NULL;
+    for (current = cur_markov_node->frequency_list; current;
+         current = current->next)
+        {
+        last = current;
+        rand_value -= current->weight;
+        if (rand_value < 0){return current->markov_node;}
+        }
+    // Only reachable through rounding errors.
+    return last ? last->markov_node : NULL;
+}
+
 /**
  * Choose randomly the next MarkovNode, depend on its occurrence frequency.
  * @param cur_markov_node - current MarkovNode
@@ -207,6 +423,10 @@ MarkovNode* get_first_random_node(MarkovChain *markov_chain)
 MarkovNode* get_next_random_node(MarkovNode *cur_markov_node)
 {
     if (!cur_markov_node || !cur_markov_node->frequency_count){return NULL;}
+    if (cur_markov_node->decay)
+        {
+        return get_next_decayed_node(cur_markov_node);
+        }
     // Get total frequency
     int total_frequency = 0;
     MarkovNodeFrequency *current = cur_markov_node->frequency_list;
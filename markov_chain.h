@@ -8,6 +8,8 @@
 
 #define ALLOCATION_ERROR_MASSAGE "Allocation failure: Failed to allocate \
 new memory\n"
+#define MIN_WEIGHT_SCALE 1e-100 // below it, stored weights are renormalized
+#define NO_HALF_LIFE 0 // half-life that disables time decay
 
 
 /***************************/
@@ -31,6 +33,20 @@ typedef bool (*is_last_t)(const void *);
 /*        STRUCTS          */
 /***************************/
 
+/**
+ * Time decay state of a chain, kept beside it (see create_markov_decay()):
+ * chains trained without decay never see it. The weights of all the
+ * sequence starts are also summed here, so a start can be drawn in a single
+ * pass over the database.
+ */
+typedef struct MarkovDecay {
+    double log_factor;      // log of the multiplier of weights each epoch
+    long epoch;
+    double start_total;     // stored weight of all the recorded starts
+    double log_start_scale; // log of its scale, as of start_epoch
+    long start_epoch;
+} MarkovDecay;
+
 typedef struct MarkovNode {
     void *data;
     struct MarkovNodeFrequency* frequency_list;
@@ -40,6 +56,17 @@ typedef struct MarkovNode {
     // NOT FROM A:
     // int frequency_list_length;
     // int sum_frequencies;
+    // Time decay (see create_markov_decay()): the current weight of each
+    // transition is its stored weight times exp(log_weight_scale), as of
+    // decay_epoch.
+    double log_weight_scale;
+    long decay_epoch;
+    MarkovDecay *decay; // of the node's chain, NULL without decay
+    double start_weight; // stored weight of sentences starting here
+    // Live snapshot (see markov_snapshot.h): the transition table readers
+    // see, swapped atomically by the writer, and whether it is outdated.
+    struct TransitionTable *published;
+    bool snapshot_dirty;
 } MarkovNode;
 
 typedef struct MarkovNodeFrequency {
@@ -47,6 +74,7 @@ typedef struct MarkovNodeFrequency {
     int frequency; // appearances of this node after the node that holds this
                    // pointer
      // NOT SUPPOSED TO CHANGE ANYTHING
+     double weight; // stored weight, frequency unless the node decays
      struct MarkovNodeFrequency* next;
 } MarkovNodeFrequency;
 
@@ -70,7 +98,71 @@ typedef struct MarkovChain {
 } MarkovChain;
 
 /**
- * Get one random state from the given markov_chain's database.
+ * Create the state of an exponential time decay of transition (and start
+ * state) weights: every epoch, all weights are multiplied by
+ * 0.5^(1/half_life), so recent observations matter more than old ones.
+ * Decay is opt in: only the nodes given to track_markov_decay() decay, the
+ * others keep plain counts. It is also lazy: a node is only rescaled when
+ * it is next trained, so advancing an epoch costs O(1). One state serves
+ * one chain, and must outlive it.
+ * @param half_life number of epochs after which a weight is halved, > 0
+ * @return the state, NULL if half_life <= 0 or in case of allocation error
+ */
+MarkovDecay *create_markov_decay(double half_life);
+
+/**
+ * Free a decay state.
+ * @param decay_ptr state to free, set to NULL
+ */
+void free_markov_decay(MarkovDecay **decay_ptr);
+
+/**
+ * Start a new decay epoch (e.g. after each training tweet).
+ */
+void advance_markov_decay(MarkovDecay *decay);
+
+/**
+ * Make a node decay from now on, before it is first trained. Every node of
+ * a chain tracks the same state, or none.
+ * @param decay
+ * @param node node that tracks no state yet (else nothing is done)
+ */
+void track_markov_decay(MarkovDecay *decay, MarkovNode *node);
+
+/**
+ * Record that a sequence started at node, for get_first_random_node() to
+ * favor recent starts. Only nodes tracking a decay record starts, and
+ * starts at last states are not recorded, since sequences are never
+ * started there.
+ * @param markov_chain chain of node
+ * @param node
+ */
+void record_sequence_start(MarkovChain *markov_chain, MarkovNode *node);
+
+/**
+ * Multiplier that turns the stored weights of a node's transitions into
+ * their current (decayed) weights. If those would all underflow, the
+ * stored weights are scaled so that the largest is the least normal double
+ * instead, keeping their proportions.
+ * @param node node holding the transitions in its frequency list
+ * @return the multiplier, 1 if node does not decay (stored weights are
+ * then frequencies)
+ */
+double get_transition_scale(const MarkovNode *node);
+
+/**
+ * Current (decayed) weight of the sequences that started at node, relative
+ * to those of the other nodes of its chain: the weights of all the nodes
+ * are in the same unit, one that keeps their sum representable.
+ * @param node
+ * @return its weight, 0 if node does not decay
+ */
+double get_start_weight(const MarkovNode *node);
+
+/**
+ * Get one random state from the given markov_chain's database. If its
+ * nodes decay, states are chosen by the decayed weight of the sequences
+ * that started at them (uniformly if none was recorded).
  * @param markov_chain
  * @return MarkovNode of the chosen state that is not a "last state" in
  * sequence.
@@ -78,7 +170,8 @@ typedef struct MarkovChain {
 MarkovNode* get_first_random_node(MarkovChain *markov_chain);
 
 /**
- * Choose randomly the next state, depend on it's occurrence frequency.
+ * Choose randomly the next state, depend on it's occurrence frequency (its
+ * decayed weight, if the node decays).
  * @param cur_markov_node MarkovNode to choose from
  * @return MarkovNode of the chosen state
  */
@@ -133,4 +226,14 @@ Node* get_node_from_database(MarkovChain *markov_chain, void *data_ptr);
  */
 Node* add_to_database(MarkovChain *markov_chain, void *data_ptr);
 
+/**
+ * Create a new node for data_ptr and add it to the end of markov_chain's
+ * database, without searching for it first. Use when the caller already
+ * knows data_ptr is not in the database (e.g. it keeps its own index).
+ * @param markov_chain the chain to add to
+ * @param data_ptr the state to add, copied with copy_func
+ * @return node wrapping given data_ptr, NULL on allocation failure
+ */
+Node* append_to_database(MarkovChain *markov_chain, void *data_ptr);
+
 #endif /* MARKOV_CHAIN_H */
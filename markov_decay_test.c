@@ -0,0 +1,234 @@
+#include "markov_chain.h"
+#include <string.h>
+#include <math.h>
+
+#define TOLERANCE 1e-9
+#define EPOCH_HALF_LIFE 4
+#define NUM_EPOCHS 40
+#define FOLD_HALF_LIFE 10
+#define FOLD_EPOCHS 3400 // 0.5^340 is below MIN_WEIGHT_SCALE
+#define IDLE_HALF_LIFE 1
+#define IDLE_EPOCHS 2000 // 0.5^2000 is not even a double
+#define START_HALF_LIFE 2
+
+#define CHECK(condition) if (!(condition)) \
+    {fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+    #condition); return EXIT_FAILURE;}
+
+static void *copy_word(const void *word){return strdup(word);}
+
+static int compare_words(const void *a, const void *b){return strcmp(a, b);}
+
+static void print_word(const void *word){printf("%s", (const char *)word);}
+
+static bool is_last_word(const void *word)
+{
+    return ((const char *)word)[strlen(word) - 1] == '.';
+}
+
+static MarkovChain *create_chain(void)
+{
+    MarkovChain *markov_chain = malloc(sizeof(MarkovChain));
+    if (!markov_chain){return NULL;}
+    markov_chain->database = calloc(1, sizeof(LinkedList));
+    if (!markov_chain->database){free(markov_chain); return NULL;}
+    markov_chain->copy_func = copy_word;
+    markov_chain->comp_func = compare_words;
+    markov_chain->free_data = free;
+    markov_chain->print_func = print_word;
+    markov_chain->is_last = is_last_word;
+    return markov_chain;
+}
+
+static bool close_to(double value, double expected)
+{
+    return fabs(value - expected) <= TOLERANCE * fabs(expected);
+}
+
+/**
+ * @return the node of word, added (and made to track decay) as needed
+ */
+static MarkovNode *word_node(MarkovChain *markov_chain, MarkovDecay *decay,
+    const char *word)
+{
+    Node *node = add_to_database(markov_chain, (void *)word);
+    if (!node){return NULL;}
+    track_markov_decay(decay, node->data);
+    return node->data;
+}
+
+/**
+ * Observe the transition from -> to times times, at the current epoch.
+ */
+static int learn(MarkovChain *markov_chain, MarkovDecay *decay,
+    const char *from, const char *to, int times)
+{
+    MarkovNode *first = word_node(markov_chain, decay, from);
+    MarkovNode *second = word_node(markov_chain, decay, to);
+    if (!first || !second){return EXIT_FAILURE;}
+    for (int i = 0; i < times; i++)
+    {
+        if (add_node_to_frequency_list(first, second, markov_chain)
+            == EXIT_FAILURE){return EXIT_FAILURE;}
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @return current weight of the transition from -> to, 0 if unseen
+ */
+static double current_weight(MarkovChain *markov_chain, const char *from,
+    const char *to)
+{
+    Node *node = get_node_from_database(markov_chain, (void *)from);
+    if (!node){return 0;}
+    MarkovNode *markov_node = node->data;
+    for (MarkovNodeFrequency *freq = markov_node->frequency_list; freq;
+         freq = freq->next)
+    {
+        if (strcmp(freq->markov_node->data, to) == 0)
+        {
+            return freq->weight * get_transition_scale(markov_node);
+        }
+    }
+    return 0;
+}
+
+/**
+ * An observation weighs 0.5^(k / half_life) k epochs later.
+ */
+static int test_epoch_weights(void)
+{
+    MarkovChain *markov_chain = create_chain();
+    MarkovDecay *decay = create_markov_decay(EPOCH_HALF_LIFE);
+    CHECK(markov_chain && decay);
+    CHECK(learn(markov_chain, decay, "a", "b", 1) == EXIT_SUCCESS);
+    for (int k = 0; k <= NUM_EPOCHS; k++)
+    {
+        CHECK(close_to(current_weight(markov_chain, "a", "b"),
+            pow(0.5, (double)k / EPOCH_HALF_LIFE)));
+        advance_markov_decay(decay);
+    }
+    // A new observation adds 1 to what is left of the old ones.
+    CHECK(learn(markov_chain, decay, "a", "b", 1) == EXIT_SUCCESS);
+    double left = pow(0.5, (double)(NUM_EPOCHS + 1) / EPOCH_HALF_LIFE);
+    CHECK(close_to(current_weight(markov_chain, "a", "b"), 1 + left));
+    CHECK(current_weight(markov_chain, "a", "c") == 0);
+    free_markov_chain(&markov_chain);
+    free_markov_decay(&decay);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Training a node whose scale got too small folds the scale into its
+ * stored weights, which must not change its current weights.
+ */
+static int test_folding(void)
+{
+    MarkovChain *markov_chain = create_chain();
+    MarkovDecay *decay = create_markov_decay(FOLD_HALF_LIFE);
+    CHECK(markov_chain && decay);
+    CHECK(learn(markov_chain, decay, "a", "b", 3) == EXIT_SUCCESS);
+    CHECK(learn(markov_chain, decay, "a", "c", 1) == EXIT_SUCCESS);
+    for (int k = 0; k < FOLD_EPOCHS; k++){advance_markov_decay(decay);}
+    double left = pow(0.5, (double)FOLD_EPOCHS / FOLD_HALF_LIFE);
+    CHECK(left < MIN_WEIGHT_SCALE);
+    CHECK(learn(markov_chain, decay, "a", "d", 1) == EXIT_SUCCESS);
+    MarkovNode *a = get_node_from_database(markov_chain, "a")->data;
+    CHECK(a->log_weight_scale == 0);
+    CHECK(close_to(current_weight(markov_chain, "a", "b"), 3 * left));
+    CHECK(close_to(current_weight(markov_chain, "a", "c"), left));
+    CHECK(close_to(current_weight(markov_chain, "a", "d"), 1));
+    free_markov_chain(&markov_chain);
+    free_markov_decay(&decay);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * A node left alone while the rest of the chain trains keeps the
+ * proportions of its transitions, even once its scale underflows.
+ */
+static int test_idle_node(void)
+{
+    MarkovChain *markov_chain = create_chain();
+    MarkovDecay *decay = create_markov_decay(IDLE_HALF_LIFE);
+    CHECK(markov_chain && decay);
+    CHECK(learn(markov_chain, decay, "idle", "b", 3) == EXIT_SUCCESS);
+    CHECK(learn(markov_chain, decay, "idle", "c", 1) == EXIT_SUCCESS);
+    for (int k = 0; k < IDLE_EPOCHS; k++)
+    {
+        CHECK(learn(markov_chain, decay, "a", "b", 1) == EXIT_SUCCESS);
+        advance_markov_decay(decay);
+    }
+    double b_weight = current_weight(markov_chain, "idle", "b");
+    double c_weight = current_weight(markov_chain, "idle", "c");
+    CHECK(b_weight > 0 && c_weight > 0);
+    CHECK(close_to(b_weight / c_weight, 3));
+    // Trained every epoch, the busy node sums 1/2 + 1/4 + ... = 1.
+    CHECK(close_to(current_weight(markov_chain, "a", "b"), 1));
+    free_markov_chain(&markov_chain);
+    free_markov_decay(&decay);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Start weights decay like transitions, and sum to the start total.
+ */
+static int test_start_weights(void)
+{
+    MarkovChain *markov_chain = create_chain();
+    MarkovDecay *decay = create_markov_decay(START_HALF_LIFE);
+    CHECK(markov_chain && decay);
+    MarkovNode *x = word_node(markov_chain, decay, "x");
+    MarkovNode *y = word_node(markov_chain, decay, "y");
+    MarkovNode *end = word_node(markov_chain, decay, "end.");
+    CHECK(x && y && end);
+    record_sequence_start(markov_chain, x);
+    for (int k = 0; k < START_HALF_LIFE; k++){advance_markov_decay(decay);}
+    record_sequence_start(markov_chain, y);
+    record_sequence_start(markov_chain, end); // never a start
+    CHECK(close_to(get_start_weight(x) / get_start_weight(y), 0.5));
+    CHECK(get_start_weight(end) == 0);
+    CHECK(close_to(get_start_weight(x) + get_start_weight(y),
+        decay->start_total));
+    for (int k = 0; k < START_HALF_LIFE; k++){advance_markov_decay(decay);}
+    CHECK(close_to(get_start_weight(x) / get_start_weight(y), 0.5));
+    free_markov_chain(&markov_chain);
+    free_markov_decay(&decay);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Chains trained without a decay count plain frequencies.
+ */
+static int test_no_decay(void)
+{
+    CHECK(!create_markov_decay(NO_HALF_LIFE));
+    MarkovChain *markov_chain = create_chain();
+    CHECK(markov_chain);
+    CHECK(learn(markov_chain, NULL, "a", "b", 3) == EXIT_SUCCESS);
+    CHECK(learn(markov_chain, NULL, "a", "c", 1) == EXIT_SUCCESS);
+    MarkovNode *a = get_node_from_database(markov_chain, "a")->data;
+    record_sequence_start(markov_chain, a);
+    CHECK(!a->decay);
+    CHECK(get_transition_scale(a) == 1);
+    CHECK(get_start_weight(a) == 0);
+    for (MarkovNodeFrequency *freq = a->frequency_list; freq;
+         freq = freq->next)
+    {
+        CHECK(freq->weight == freq->frequency);
+    }
+    free_markov_chain(&markov_chain);
+    return EXIT_SUCCESS;
+}
+
+int main(void)
+{
+    if (test_epoch_weights() == EXIT_FAILURE ||
+        test_folding() == EXIT_FAILURE ||
+        test_idle_node() == EXIT_FAILURE ||
+        test_start_weights() == EXIT_FAILURE ||
+        test_no_decay() == EXIT_FAILURE){return EXIT_FAILURE;}
+    printf("markov_decay_test: passed\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,681 @@
+#include "markov_index.h"
+#include <string.h>
+
+#define EDGE_HASH_MULTIPLIER 0x9E3779B97F4A7C15ULL
+#define ARENA_ALIGNMENT 16
+
+/**
+ * Smallest power of 2 that keeps the load factor of size items under 1/2.
+ */
+static size_t table_capacity(int size)
+{
+    size_t capacity = 2;
+    while (capacity < 2 * (size_t)size){capacity *= 2;}
+    return capacity;
+}
+
+static size_t edge_hash(int from, int to)
+{
+    uint64_t key = ((uint64_t)(uint32_t)from << 32) | (uint32_t)to;
+    return (size_t)((key * EDGE_HASH_MULTIPLIER) >> 17);
+}
+
+int markov_index_find(const MarkovIndex *index, const void *data_ptr)
+{
+    if (!index || !data_ptr){return NOT_IN_INDEX;}
+    size_t mask = index->state_capacity - 1;
+    size_t i = index->hash_func(data_ptr) & mask;
+    for (; index->state_slots[i] != NOT_IN_INDEX; i = (i + 1) & mask)
+    {
+        int id = index->state_slots[i];
+        if (!index->comp_func(index->states[id]->data, data_ptr)){return id;}
+    }
+    return NOT_IN_INDEX;
+}
+
+int markov_index_find_edge(const MarkovIndex *index, int from, int to)
+{
+    if (!index || from < 0 || to < 0){return NOT_IN_INDEX;}
+    size_t mask = index->edge_capacity - 1;
+    size_t i = edge_hash(from, to) & mask;
+    for (; index->edge_slots[i] != NOT_IN_INDEX; i = (i + 1) & mask)
+    {
+        int edge = index->edge_slots[i];
+        if (index->edge_targets[edge] == to &&
+            edge >= index->edge_offsets[from] &&
+            edge < index->edge_offsets[from + 1]){return edge;}
+    }
+    return NOT_IN_INDEX;
+}
+
+static void insert_state_slot(MarkovIndex *index, int id)
+{
+    size_t mask = index->state_capacity - 1;
+    size_t i = index->hash_func(index->states[id]->data) & mask;
+    while (index->state_slots[i] != NOT_IN_INDEX){i = (i + 1) & mask;}
+    index->state_slots[i] = id;
+}
+
+static void insert_edge_slot(MarkovIndex *index, int from, int edge)
+{
+    size_t mask = index->edge_capacity - 1;
+    size_t i = edge_hash(from, index->edge_targets[edge]) & mask;
+    while (index->edge_slots[i] != NOT_IN_INDEX){i = (i + 1) & mask;}
+    index->edge_slots[i] = edge;
+}
+
+/**
+ * Number the states, and make them findable by hash.
+ */
+static void index_states(MarkovIndex *index, MarkovChain *markov_chain)
+{
+    for (Node *cur = markov_chain->database->first; cur; cur = cur->next)
+    {
+        int id = index->num_states++;
+        index->states[id] = cur->data;
+        index->is_last[id] = markov_chain->is_last(index->states[id]->data);
+        index->start_weights[id] = index->is_last[id] ? 0 :
+                                   get_start_weight(index->states[id]);
+        insert_state_slot(index, id);
+    }
+}
+
+static void sum_start_weights(MarkovIndex *index)
+{
+    double sum = 0;
+    for (int id = 0; id < index->num_states; id++)
+    {
+        sum += index->start_weights[id];
+        index->start_cumulative[id] = sum;
+    }
+}
+
+/**
+ * Lay the transitions of every state out contiguously, in frequency list
+ * order, and make them findable by hash.
+ */
+static int index_edges(MarkovIndex *index)
+{
+    int edge = 0;
+    for (int id = 0; id < index->num_states; id++)
+    {
+        index->edge_offsets[id] = edge;
+        index->total_weights[id] = 0;
+        double scale = get_transition_scale(index->states[id]);
+        MarkovNodeFrequency *freq = index->states[id]->frequency_list;
+        for (; freq; freq = freq->next, edge++)
+        {
+            int to = markov_index_find(index, freq->markov_node->data);
+            if (to == NOT_IN_INDEX){return EXIT_FAILURE;}
+            index->edge_targets[edge] = to;
+            index->edge_weights[edge] = freq->weight * scale;
+            index->total_weights[id] += index->edge_weights[edge];
+            insert_edge_slot(index, id, edge);
+        }
+    }
+    index->edge_offsets[index->num_states] = edge;
+    return EXIT_SUCCESS;
+}
+
+MarkovIndex *create_markov_index(MarkovChain *markov_chain,
+    hash_func_t hash_func)
+{
+    if (!markov_chain || !markov_chain->database || !hash_func){return NULL;}
+    MarkovIndex *index = calloc(1, sizeof(MarkovIndex));
+    if (!index){fprintf(stderr, ALLOCATION_ERROR_MASSAGE); return NULL;}
+    int num_states = markov_chain->database->size;
+    int num_edges = 0;
+    for (Node *cur = markov_chain->database->first; cur; cur = cur->next)
+    {
+        num_edges += ((MarkovNode *)cur->data)->frequency_count;
+    }
+    index->num_edges = num_edges;
+    index->hash_func = hash_func;
+    index->comp_func = markov_chain->comp_func;
+    index->state_capacity = table_capacity(num_states);
+    index->edge_capacity = table_capacity(num_edges);
+    index->states = malloc((num_states + 1) * sizeof(MarkovNode *));
+    index->is_last = malloc((num_states + 1) * sizeof(bool));
+    index->total_weights = malloc((num_states + 1) * sizeof(double));
+    index->start_weights = malloc((num_states + 1) * sizeof(double));
+    index->start_cumulative = malloc((num_states + 1) * sizeof(double));
+    index->edge_offsets = malloc((num_states + 1) * sizeof(int));
+    index->edge_targets = malloc((num_edges + 1) * sizeof(int));
+    index->edge_weights = malloc((num_edges + 1) * sizeof(double));
+    index->state_slots = malloc(index->state_capacity * sizeof(int));
+    index->edge_slots = malloc(index->edge_capacity * sizeof(int));
+    if (!index->states || !index->is_last || !index->total_weights ||
+        !index->start_weights || !index->start_cumulative ||
+        !index->edge_offsets || !index->edge_targets || !index->edge_weights
+        || !index->state_slots || !index->edge_slots)
+    {
+        fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+        free_markov_index(&index);
+        return NULL;
+    }
+    // NOT_IN_INDEX is -1, i.e. all bytes set.
+    memset(index->state_slots, 0xff, index->state_capacity * sizeof(int));
+    memset(index->edge_slots, 0xff, index->edge_capacity * sizeof(int));
+    index_states(index, markov_chain);
+    if (index_edges(index) == EXIT_FAILURE)
+    {
+        free_markov_index(&index);
+        return NULL;
+    }
+    sum_start_weights(index);
+    return index;
+}
+
+/**
+ * Free the arrays of the index, wherever they live.
+ */
+static void free_index_arrays(MarkovIndex *index)
+{
+    if (index->arena)
+    {
+        free(index->arena);
+        return;
+    }
+    free(index->states);
+    free(index->is_last);
+    free(index->total_weights);
+    free(index->start_weights);
+    free(index->start_cumulative);
+    free(index->edge_offsets);
+    free(index->edge_targets);
+    free(index->edge_weights);
+}
+
+void free_markov_index(MarkovIndex **index_ptr)
+{
+    if (index_ptr == NULL || *index_ptr == NULL){return;}
+    MarkovIndex *index = *index_ptr;
+    free_index_arrays(index);
+    free(index->state_slots);
+    free(index->edge_slots);
+    free(index);
+    *index_ptr = NULL;
+}
+
+int markov_index_next(const MarkovIndex *index, int from,
+    double random_unit)
+{
+    if (!index || from < 0){return NOT_IN_INDEX;}
+    int begin = index->edge_offsets[from], end = index->edge_offsets[from + 1];
+    if (begin == end){return NOT_IN_INDEX;}
+    double remaining = random_unit * index->total_weights[from];
+    for (int edge = begin; edge < end; edge++)
+    {
+        remaining -= index->edge_weights[edge];
+        if (remaining < 0){return index->edge_targets[edge];}
+    }
+    // Only reachable through rounding errors.
+    return index->edge_targets[end - 1];
+}
+
+int markov_index_first_weighted(const MarkovIndex *index,
+    double random_unit)
+{
+    if (!index || index->num_states == 0){return NOT_IN_INDEX;}
+    double total = index->start_cumulative[index->num_states - 1];
+    if (total <= 0){return NOT_IN_INDEX;}
+    double target = random_unit * total;
+    // First id whose cumulative weight exceeds target.
+    int low = 0, high = index->num_states - 1;
+    while (low < high)
+    {
+        int mid = low + (high - low) / 2;
+        if (index->start_cumulative[mid] > target){high = mid;}
+        else{low = mid + 1;}
+    }
+    return low;
+}
+
+// ------------------------ REORDERING -------------------------
+
+typedef struct SortKey {
+    double key;
+    int id;
+} SortKey;
+
+/**
+ * Sort by decreasing key, ties in increasing id (i.e. stable).
+ */
+static int compare_keys_desc(const void *a, const void *b)
+{
+    const SortKey *first = a, *second = b;
+    if (first->key != second->key){return first->key < second->key ? 1 : -1;}
+    return first->id - second->id;
+}
+
+static int max_degree(const MarkovIndex *index)
+{
+    int max = 0;
+    for (int id = 0; id < index->num_states; id++)
+    {
+        int degree = index->edge_offsets[id + 1] - index->edge_offsets[id];
+        if (degree > max){max = degree;}
+    }
+    return max;
+}
+
+/**
+ * Sort by increasing id.
+ */
+static int compare_ids(const void *a, const void *b)
+{
+    return ((const SortKey *)a)->id - ((const SortKey *)b)->id;
+}
+
+/**
+ * Neighbours of every state in the graph a traversal follows, each list
+ * sorted in the order the traversal visits them.
+ */
+typedef struct StateGraph {
+    int *offsets;        // neighbours of id are [offsets[id], offsets[id+1])
+    SortKey *neighbours; // id: the neighbour, key: its visiting priority
+} StateGraph;
+
+static void free_state_graph(StateGraph *graph)
+{
+    free(graph->offsets);
+    free(graph->neighbours);
+    *graph = (StateGraph) {NULL, NULL};
+}
+
+/**
+ * Keep one copy of each neighbour of every state, dropping self loops.
+ */
+static void remove_duplicates(const MarkovIndex *index, StateGraph *graph)
+{
+    int kept = 0;
+    for (int id = 0; id < index->num_states; id++)
+    {
+        int begin = graph->offsets[id], end = graph->offsets[id + 1];
+        graph->offsets[id] = kept;
+        qsort(graph->neighbours + begin, end - begin, sizeof(SortKey),
+            compare_ids);
+        for (int i = begin; i < end; i++)
+        {
+            int neighbour = graph->neighbours[i].id;
+            if (neighbour == id ||
+                (i > begin && neighbour == graph->neighbours[i - 1].id))
+            {
+                continue;
+            }
+            graph->neighbours[kept++].id = neighbour;
+        }
+    }
+    graph->offsets[index->num_states] = kept;
+}
+
+/**
+ * BFS follows the transitions of a state, most frequent first. RCM works
+ * on the symmetrized graph (a transition links its two states both ways,
+ * as a bandwidth reduction must see them), least connected states first.
+ * @return EXIT_SUCCESS / EXIT_FAILURE in case of allocation error
+ */
+static int build_state_graph(const MarkovIndex *index, MarkovOrder order,
+    StateGraph *graph)
+{
+    int num_states = index->num_states, num_edges = index->num_edges;
+    int links = order == ORDER_RCM ? 2 * num_edges : num_edges;
+    graph->offsets = calloc(num_states + 1, sizeof(int));
+    graph->neighbours = malloc((links + 1) * sizeof(SortKey));
+    int *fill = malloc((num_states + 1) * sizeof(int));
+    if (!graph->offsets || !graph->neighbours || !fill)
+    {
+        free_state_graph(graph);
+        free(fill);
+        return EXIT_FAILURE;
+    }
+    for (int from = 0; from < num_states; from++)
+    {
+        for (int edge = index->edge_offsets[from];
+             edge < index->edge_offsets[from + 1]; edge++)
+        {
+            graph->offsets[from + 1]++;
+            if (order == ORDER_RCM)
+            {
+                graph->offsets[index->edge_targets[edge] + 1]++;
+            }
+        }
+    }
+    for (int id = 0; id < num_states; id++)
+    {
+        graph->offsets[id + 1] += graph->offsets[id];
+        fill[id] = graph->offsets[id];
+    }
+    for (int from = 0; from < num_states; from++)
+    {
+        for (int edge = index->edge_offsets[from];
+             edge < index->edge_offsets[from + 1]; edge++)
+        {
+            int to = index->edge_targets[edge];
+            graph->neighbours[fill[from]++] =
+                (SortKey) {index->edge_weights[edge], to};
+            if (order == ORDER_RCM)
+            {
+                graph->neighbours[fill[to]++] = (SortKey) {0, from};
+            }
+        }
+    }
+    free(fill);
+    if (order == ORDER_RCM)
+    {
+        remove_duplicates(index, graph);
+        for (int i = 0; i < graph->offsets[num_states]; i++)
+        {
+            int id = graph->neighbours[i].id;
+            graph->neighbours[i].key = graph->offsets[id] -
+                                       graph->offsets[id + 1];
+        }
+    }
+    for (int id = 0; id < num_states; id++)
+    {
+        qsort(graph->neighbours + graph->offsets[id],
+            graph->offsets[id + 1] - graph->offsets[id], sizeof(SortKey),
+            compare_keys_desc);
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Rank the states by how often a walk touches them (leaving or entering),
+ * or by -degree for RCM, which starts from the least connected states.
+ */
+static void rank_states(const MarkovIndex *index, MarkovOrder order,
+    const StateGraph *graph, SortKey *ranked)
+{
+    for (int id = 0; id < index->num_states; id++)
+    {
+        ranked[id] = (SortKey) {index->total_weights[id], id};
+        if (order == ORDER_RCM)
+        {
+            ranked[id].key = graph->offsets[id] - graph->offsets[id + 1];
+        }
+    }
+    if (order != ORDER_RCM)
+    {
+        for (int edge = 0; edge < index->num_edges; edge++)
+        {
+            ranked[index->edge_targets[edge]].key += index->edge_weights[edge];
+        }
+    }
+    qsort(ranked, index->num_states, sizeof(SortKey), compare_keys_desc);
+}
+
+/**
+ * Breadth first traversal of a state graph, seeded in ranked order. RCM
+ * (Cuthill-McKee) is reversed at the end.
+ */
+static void traverse_states(const MarkovIndex *index, MarkovOrder order,
+    const StateGraph *graph, const SortKey *ranked, bool *visited,
+    int *new_order)
+{
+    int head = 0, tail = 0; // new_order doubles as the BFS queue
+    for (int seed = 0; seed < index->num_states; seed++)
+    {
+        if (visited[ranked[seed].id]){continue;}
+        visited[ranked[seed].id] = true;
+        new_order[tail++] = ranked[seed].id;
+        while (head < tail)
+        {
+            int from = new_order[head++];
+            for (int i = graph->offsets[from]; i < graph->offsets[from + 1];
+                 i++)
+            {
+                int to = graph->neighbours[i].id;
+                if (visited[to]){continue;}
+                visited[to] = true;
+                new_order[tail++] = to;
+            }
+        }
+    }
+    for (int i = 0; order == ORDER_RCM && i < tail / 2; i++)
+    {
+        int tmp = new_order[i];
+        new_order[i] = new_order[tail - 1 - i];
+        new_order[tail - 1 - i] = tmp;
+    }
+}
+
+static size_t arena_aligned(size_t size)
+{
+    return (size + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT * ARENA_ALIGNMENT;
+}
+
+/**
+ * Take the next block of an arena.
+ * @param cursor start of the free part of the arena, moved past the block
+ */
+static void *arena_carve(char **cursor, size_t size)
+{
+    void *block = *cursor;
+    *cursor += arena_aligned(size);
+    return block;
+}
+
+/**
+ * Bytes of the record of a state in the arena: its node, directly followed
+ * by its transitions, then its data.
+ */
+static size_t record_size(const MarkovIndex *index, int id,
+    data_size_t data_size)
+{
+    size_t degree = index->edge_offsets[id + 1] - index->edge_offsets[id];
+    size_t size = arena_aligned(sizeof(MarkovNode)
+                                + degree * sizeof(MarkovNodeFrequency));
+    if (data_size){size += arena_aligned(data_size(index->states[id]->data));}
+    return size;
+}
+
+/**
+ * Bytes of the arrays of the index, then of all the state records.
+ */
+static size_t arena_size(const MarkovIndex *index, data_size_t data_size)
+{
+    size_t num_states = index->num_states + 1;
+    size_t num_edges = index->num_edges + 1;
+    size_t size = arena_aligned(num_states * sizeof(int))
+                  + 4 * arena_aligned(num_states * sizeof(double))
+                  + arena_aligned(num_states * sizeof(bool))
+                  + arena_aligned(num_states * sizeof(MarkovNode *))
+                  + arena_aligned(num_edges * sizeof(int))
+                  + arena_aligned(num_edges * sizeof(double));
+    for (int id = 0; id < index->num_states; id++)
+    {
+        size += record_size(index, id, data_size);
+    }
+    return size;
+}
+
+/**
+ * Copy a state and its transitions, already renumbered and sorted, into
+ * its record.
+ * @param edges the transitions of old, sorted, by position in its list
+ * @param states new id -> record, for the targets of the transitions
+ * @param entries room for the frequency list of old
+ */
+static void copy_record(const MarkovIndex *index, int old,
+    const SortKey *edges, MarkovNode *const *states, const int *new_ids,
+    MarkovNodeFrequency **entries, MarkovNode *node, data_size_t data_size)
+{
+    int degree = index->edge_offsets[old + 1] - index->edge_offsets[old];
+    MarkovNodeFrequency *freq = index->states[old]->frequency_list;
+    for (int i = 0; i < degree; i++, freq = freq->next){entries[i] = freq;}
+    *node = *index->states[old];
+    MarkovNodeFrequency *list = (MarkovNodeFrequency *)(node + 1);
+    node->frequency_list = degree ? list : NULL;
+    for (int i = 0; i < degree; i++)
+    {
+        int to = new_ids[index->edge_targets[edges[i].id]];
+        list[i] = *entries[edges[i].id - index->edge_offsets[old]];
+        list[i].markov_node = states[to];
+        list[i].next = i + 1 < degree ? &list[i + 1] : NULL;
+    }
+    if (data_size)
+    {
+        void *data = (char *)node + arena_aligned(sizeof(MarkovNode)
+            + degree * sizeof(MarkovNodeFrequency));
+        memcpy(data, index->states[old]->data, data_size(node->data));
+        node->data = data;
+    }
+}
+
+/**
+ * Move the arrays of the index, and the states themselves, into one arena
+ * in the new order, and rebuild the hash tables on top of it.
+ * @param new_order new position -> old id
+ */
+static int apply_order(MarkovIndex *index, const int *new_order,
+    data_size_t data_size)
+{
+    int num_states = index->num_states, num_edges = index->num_edges;
+    int *new_ids = malloc((num_states + 1) * sizeof(int));
+    int degree = max_degree(index);
+    SortKey *edges = malloc((degree + 1) * sizeof(SortKey));
+    MarkovNodeFrequency **entries = malloc((degree + 1)
+                                           * sizeof(MarkovNodeFrequency *));
+    char *arena = malloc(arena_size(index, data_size));
+    if (!new_ids || !edges || !entries || !arena)
+    {
+        free(new_ids);
+        free(edges);
+        free(entries);
+        free(arena);
+        return EXIT_FAILURE;
+    }
+    char *cursor = arena;
+    int *edge_offsets = arena_carve(&cursor, (num_states + 1) * sizeof(int));
+    double *total_weights = arena_carve(&cursor,
+        (num_states + 1) * sizeof(double));
+    double *edge_weights = arena_carve(&cursor,
+        (num_edges + 1) * sizeof(double));
+    int *edge_targets = arena_carve(&cursor, (num_edges + 1) * sizeof(int));
+    bool *is_last = arena_carve(&cursor, (num_states + 1) * sizeof(bool));
+    double *start_weights = arena_carve(&cursor,
+        (num_states + 1) * sizeof(double));
+    double *start_cumulative = arena_carve(&cursor,
+        (num_states + 1) * sizeof(double));
+    MarkovNode **states = arena_carve(&cursor,
+        (num_states + 1) * sizeof(MarkovNode *));
+    for (int id = 0; id < num_states; id++)
+    {
+        new_ids[new_order[id]] = id;
+        states[id] = arena_carve(&cursor,
+            record_size(index, new_order[id], data_size));
+    }
+    int edge = 0;
+    for (int id = 0; id < num_states; id++)
+    {
+        int old = new_order[id], num_edges_of_old = 0;
+        is_last[id] = index->is_last[old];
+        total_weights[id] = index->total_weights[old];
+        start_weights[id] = index->start_weights[old];
+        edge_offsets[id] = edge;
+        for (int e = index->edge_offsets[old];
+             e < index->edge_offsets[old + 1]; e++)
+        {
+            edges[num_edges_of_old++] = (SortKey) {index->edge_weights[e], e};
+        }
+        qsort(edges, num_edges_of_old, sizeof(SortKey), compare_keys_desc);
+        for (int i = 0; i < num_edges_of_old; i++, edge++)
+        {
+            edge_targets[edge] = new_ids[index->edge_targets[edges[i].id]];
+            edge_weights[edge] = edges[i].key;
+        }
+        copy_record(index, old, edges, states, new_ids, entries, states[id],
+            data_size);
+    }
+    edge_offsets[num_states] = edge;
+    free_index_arrays(index);
+    index->arena = arena;
+    index->states = states;
+    index->is_last = is_last;
+    index->total_weights = total_weights;
+    index->start_weights = start_weights;
+    index->start_cumulative = start_cumulative;
+    index->edge_offsets = edge_offsets;
+    index->edge_targets = edge_targets;
+    index->edge_weights = edge_weights;
+    memset(index->state_slots, 0xff, index->state_capacity * sizeof(int));
+    memset(index->edge_slots, 0xff, index->edge_capacity * sizeof(int));
+    for (int id = 0; id < num_states; id++)
+    {
+        insert_state_slot(index, id);
+        for (int e = edge_offsets[id]; e < edge_offsets[id + 1]; e++)
+        {
+            insert_edge_slot(index, id, e);
+        }
+    }
+    sum_start_weights(index);
+    free(new_ids);
+    free(edges);
+    free(entries);
+    return EXIT_SUCCESS;
+}
+
+int markov_index_reorder(MarkovIndex *index, MarkovOrder order,
+    data_size_t data_size)
+{
+    if (!index){return EXIT_FAILURE;}
+    SortKey *ranked = malloc((index->num_states + 1) * sizeof(SortKey));
+    int *new_order = malloc((index->num_states + 1) * sizeof(int));
+    bool *visited = calloc(index->num_states + 1, sizeof(bool));
+    StateGraph graph = {NULL, NULL};
+    int status = EXIT_FAILURE;
+    if (ranked && new_order && visited &&
+        (order == ORDER_FREQUENCY ||
+         build_state_graph(index, order, &graph) == EXIT_SUCCESS))
+    {
+        rank_states(index, order, &graph, ranked);
+        if (order == ORDER_FREQUENCY)
+        {
+            for (int i = 0; i < index->num_states; i++)
+            {
+                new_order[i] = ranked[i].id;
+            }
+        }
+        else
+        {
+            traverse_states(index, order, &graph, ranked, visited,
+                new_order);
+        }
+        status = apply_order(index, new_order, data_size);
+    }
+    if (status == EXIT_FAILURE){fprintf(stderr, ALLOCATION_ERROR_MASSAGE);}
+    free_state_graph(&graph);
+    free(ranked);
+    free(new_order);
+    free(visited);
+    return status;
+}
+
+IndexLocality markov_index_locality(const MarkovIndex *index)
+{
+    IndexLocality locality = {0, 0};
+    double total = 0;
+    for (int from = 0; index && from < index->num_states; from++)
+    {
+        size_t from_page = index->edge_offsets[from] * sizeof(double)
+                           / PAGE_SIZE_BYTES;
+        for (int edge = index->edge_offsets[from];
+             edge < index->edge_offsets[from + 1]; edge++)
+        {
+            int to = index->edge_targets[edge];
+            double weight = index->edge_weights[edge];
+            size_t to_page = index->edge_offsets[to] * sizeof(double)
+                             / PAGE_SIZE_BYTES;
+            locality.mean_jump += weight * abs(from - to);
+            locality.same_page_rate += (from_page == to_page) ? weight : 0;
+            total += weight;
+        }
+    }
+    if (total > 0)
+    {
+        locality.mean_jump /= total;
+        locality.same_page_rate /= total;
+    }
+    return locality;
+}
@@ -0,0 +1,155 @@
+#ifndef _MARKOV_INDEX_H
+#define _MARKOV_INDEX_H
+
+#include "markov_chain.h"
+#include <stdint.h> // For uint64_t
+
+#define NOT_IN_INDEX -1
+#define PAGE_SIZE_BYTES 4096
+
+/**
+ * Ways to renumber the states of an index (see markov_index_reorder).
+ */
+typedef enum MarkovOrder {
+    ORDER_FREQUENCY, // most visited states first
+    ORDER_BFS,       // breadth first from the most visited states, following
+                     // the most frequent transitions first
+    ORDER_RCM        // reverse Cuthill-McKee over the transition graph,
+                     // transitions taken both ways
+} MarkovOrder;
+
+/**
+ * How well the layout of an index matches the way it is walked, weighting
+ * each transition by its frequency.
+ */
+typedef struct IndexLocality {
+    double mean_jump;      // mean |from - to| distance between state ids
+    double same_page_rate; // rate of transitions whose two transition
+                           // blocks share a memory page
+} IndexLocality;
+
+/**
+ * Pointer to a func that gets a pointer of generic data type and returns a
+ * hash of it. Data that comp_func considers equal must hash equally.
+ */
+typedef uint64_t (*hash_func_t)(const void *);
+
+/**
+ * Pointer to a func that gets a pointer of generic data type and returns
+ * the number of bytes it takes, so that it can be copied as is.
+ */
+typedef size_t (*data_size_t)(const void *);
+
+/**
+ * Read-only snapshot of a trained MarkovChain, for hot paths that cannot
+ * afford the linked list walks of the chain itself. States are numbered
+ * 0..num_states-1 (database order); their transitions are stored
+ * contiguously (CSR layout), and both states and transitions can be looked
+ * up by hash in O(1). The index points into the chain's MarkovNodes, so the
+ * chain must outlive it and must not change while it is in use. Once
+ * reordered, it holds its own copies of them (see markov_index_reorder).
+ */
+typedef struct MarkovIndex {
+    int num_states;
+    MarkovNode **states;   // id -> MarkovNode
+    bool *is_last;         // id -> is_last(state)
+    double *total_weights; // id -> sum of its transition weights
+    double *start_weights; // id -> weight of the sequences starting there
+                           // (only recorded with time decay)
+    double *start_cumulative; // id -> sum of start_weights up to id
+
+    int num_edges;
+    int *edge_offsets;     // transitions of id are [offsets[id], offsets[id+1])
+    int *edge_targets;     // transition -> id of the state it leads to
+    double *edge_weights;  // transition -> occurrence frequency (weight)
+
+    hash_func_t hash_func;
+    comp_func_t comp_func;
+    int *state_slots;      // open addressing: state id or NOT_IN_INDEX
+    size_t state_capacity; // power of 2
+    int *edge_slots;       // open addressing: transition or NOT_IN_INDEX
+    size_t edge_capacity;  // power of 2
+
+    void *arena;           // once reordered, holds everything above but the
+                           // hash tables, and the copied states
+} MarkovIndex;
+
+/**
+ * Build an index over the current content of markov_chain. With time decay
+ * enabled, weights are the decayed weights as of the current epoch.
+ * @param markov_chain trained chain
+ * @param hash_func hash of the chain's data type
+ * @return the index, NULL in case of allocation error
+ */
+MarkovIndex *create_markov_index(MarkovChain *markov_chain,
+    hash_func_t hash_func);
+
+/**
+ * Free an index (not the chain it was built from).
+ * @param index_ptr index to free, set to NULL
+ */
+void free_markov_index(MarkovIndex **index_ptr);
+
+/**
+ * Find the id of a state.
+ * @param index
+ * @param data_ptr the state to look for
+ * @return its id, NOT_IN_INDEX if the chain never saw it
+ */
+int markov_index_find(const MarkovIndex *index, const void *data_ptr);
+
+/**
+ * Find the transition between two states.
+ * @param index
+ * @param from id of the first state
+ * @param to id of the second state
+ * @return position of the transition in edge_targets / edge_weights,
+ * NOT_IN_INDEX if the chain never saw it
+ */
+int markov_index_find_edge(const MarkovIndex *index, int from, int to);
+
+/**
+ * Choose randomly the next state, depend on its occurrence frequency.
+ * @param index
+ * @param from id of the current state
+ * @param random_unit uniform random number in [0, 1)
+ * @return id of the chosen state, NOT_IN_INDEX if from has no transitions
+ */
+int markov_index_next(const MarkovIndex *index, int from,
+    double random_unit);
+
+/**
+ * Choose randomly a state by the weight of the sequences that started at it.
+ * @param index
+ * @param random_unit uniform random number in [0, 1)
+ * @return id of the chosen state, NOT_IN_INDEX if no start was recorded
+ */
+int markov_index_first_weighted(const MarkovIndex *index,
+    double random_unit);
+
+/**
+ * Finalize a frozen index for speed: renumber its states in the given order
+ * and relocate everything a walk reads into one arena, in that order: the
+ * arrays of the index, then for each state a copy of its MarkovNode, its
+ * transitions (a copy of its frequency list, leading to the copied nodes)
+ * and its data. Transitions of a state are also sorted by decreasing
+ * frequency, so sampling finds the likely ones first. Ids and MarkovNodes
+ * obtained before the call are no longer valid.
+ * @param index
+ * @param order the new order of the states
+ * @param data_size size of the data of a state, NULL to leave the data in
+ * the chain
+ * @return EXIT_SUCCESS / EXIT_FAILURE (index unchanged) in case of
+ * allocation error
+ */
+int markov_index_reorder(MarkovIndex *index, MarkovOrder order,
+    data_size_t data_size);
+
+/**
+ * Measure the memory locality of the current layout of an index.
+ * @param index
+ * @return the weighted locality statistics
+ */
+IndexLocality markov_index_locality(const MarkovIndex *index);
+
+#endif /* _MARKOV_INDEX_H */
@@ -0,0 +1,180 @@
+#include "markov_index.h"
+#include "corpus_pipeline.h"
+#include "word_table.h"
+#include "counter_rng.h"
+#include <string.h>
+#include <time.h>
+
+#define USAGE "Usage: markov_index_bench <corpus path> [seed]\n"
+#define TRAINING_ERROR "Error: could not train on the corpus\n"
+#define WALK_BENCHMARK_STEPS 5000000
+#define NS_PER_SEC 1e9
+#define DEFAULT_SEED 1
+#define DATABASE_LAYOUT -1 // the index as built, before any MarkovOrder
+
+static void *copy_word(const void *word){return strdup(word);}
+
+static int compare_words(const void *a, const void *b){return strcmp(a, b);}
+
+static void print_word(const void *word){printf(" %s", (const char *)word);}
+
+static bool is_last_word(const void *word)
+{
+    return ((const char *)word)[strlen(word) - 1] == '.';
+}
+
+static size_t word_size(const void *word){return strlen(word) + 1;}
+
+static volatile size_t walked_letters; // keeps the reads of the walk
+
+static MarkovChain *train(const char *path_list)
+{
+    CorpusFiles files;
+    if (collect_corpus_files(path_list, &files) == EXIT_FAILURE)
+    {
+        return NULL;
+    }
+    MarkovChain *markov_chain = malloc(sizeof(MarkovChain));
+    LinkedList *database = calloc(1, sizeof(LinkedList));
+    if (!markov_chain || !database)
+    {
+        free(markov_chain);
+        free(database);
+        free_corpus_files(&files);
+        return NULL;
+    }
+    *markov_chain = (MarkovChain) {database, print_word, compare_words,
+                                   free, copy_word, is_last_word};
+    if (fill_database_from_files(markov_chain, &files, -1, NULL, NULL, NULL)
+        == EXIT_FAILURE)
+    {
+        free_markov_chain(&markov_chain);
+    }
+    free_corpus_files(&files);
+    return markov_chain;
+}
+
+/**
+ * Time a long random walk over the index, reading the word of every state
+ * it goes through, and restarting at a random state whenever a sentence
+ * ends.
+ * @param index
+ * @param walk_ids the id of each state as numbered in the chain's database,
+ * so every layout is timed on walks from the same states
+ * @param seed
+ * @return mean time of a step, in nanoseconds
+ */
+static double benchmark_walk(const MarkovIndex *index, const int *walk_ids,
+    unsigned int seed)
+{
+    CounterRng rng = counter_rng(seed, 0);
+    int state = walk_ids[0];
+    size_t letters = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int step = 0; step < WALK_BENCHMARK_STEPS; step++)
+    {
+        state = markov_index_next(index, state, rng_unit(&rng));
+        if (state == NOT_IN_INDEX || index->is_last[state])
+        {
+            state = walk_ids[rng_next(&rng) % index->num_states];
+        }
+        letters += *(const char *)index->states[state]->data;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start.tv_sec) * NS_PER_SEC
+                     + (end.tv_nsec - start.tv_nsec);
+    walked_letters = letters;
+    return elapsed / WALK_BENCHMARK_STEPS;
+}
+
+/**
+ * Build an index in the given layout and print its statistics.
+ * @param layout a MarkovOrder, or DATABASE_LAYOUT
+ * @return EXIT_SUCCESS / EXIT_FAILURE in case of allocation error
+ */
+static int bench_layout(MarkovChain *markov_chain, int layout,
+    unsigned int seed)
+{
+    static const char *layout_names[] = {"database", "frequency", "bfs",
+                                         "rcm"};
+    MarkovIndex *index = create_markov_index(markov_chain, hash_string);
+    int *walk_ids = index ? malloc((index->num_states + 1) * sizeof(int))
+                          : NULL;
+    if (!walk_ids)
+    {
+        fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+        free_markov_index(&index);
+        return EXIT_FAILURE;
+    }
+    MarkovNode **states = index->states;
+    int status = EXIT_SUCCESS;
+    if (layout != DATABASE_LAYOUT)
+    {
+        // The chain's nodes stay valid, only the index moves.
+        MarkovNode **chain_states = malloc((index->num_states + 1)
+                                           * sizeof(MarkovNode *));
+        if (!chain_states)
+        {
+            fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+            status = EXIT_FAILURE;
+        }
+        else
+        {
+            memcpy(chain_states, states,
+                   index->num_states * sizeof(MarkovNode *));
+            status = markov_index_reorder(index, layout, word_size);
+            for (int id = 0; status == EXIT_SUCCESS &&
+                 id < index->num_states; id++)
+            {
+                walk_ids[id] = markov_index_find(index,
+                    chain_states[id]->data);
+            }
+            free(chain_states);
+        }
+    }
+    else
+    {
+        for (int id = 0; id < index->num_states; id++){walk_ids[id] = id;}
+    }
+    if (status == EXIT_SUCCESS)
+    {
+        IndexLocality locality = markov_index_locality(index);
+        printf("Layout %s: mean jump %.1f states, same page %.1f%%, "
+               "walk %.1f ns/step\n", layout_names[layout + 1],
+               locality.mean_jump, 100 * locality.same_page_rate,
+               benchmark_walk(index, walk_ids, seed));
+    }
+    free(walk_ids);
+    free_markov_index(&index);
+    return status;
+}
+
+/**
+ * Compare the layouts of markov_index_reorder() on a corpus: their
+ * locality, and the time of a random walk over each.
+ */
+int main(int argc, char *argv[])
+{
+    if (argc != 2 && argc != 3)
+    {
+        fprintf(stderr, USAGE);
+        return EXIT_FAILURE;
+    }
+    unsigned int seed = argc == 3 ? strtoul(argv[2], NULL, 10)
+                                  : DEFAULT_SEED;
+    MarkovChain *markov_chain = train(argv[1]);
+    if (!markov_chain)
+    {
+        fprintf(stderr, TRAINING_ERROR);
+        return EXIT_FAILURE;
+    }
+    int status = EXIT_SUCCESS;
+    for (int layout = DATABASE_LAYOUT; layout <= ORDER_RCM &&
+         status == EXIT_SUCCESS; layout++)
+    {
+        status = bench_layout(markov_chain, layout, seed);
+    }
+    free_markov_chain(&markov_chain);
+    return status;
+}
@@ -0,0 +1,220 @@
+#include "markov_index.h"
+#include "word_table.h"
+#include "counter_rng.h"
+#include <string.h>
+#include <math.h>
+
+#define TOLERANCE 1e-12
+#define NUM_WORDS 300
+#define NUM_ENDS 8
+#define MAX_WORD_LENGTH 8
+#define MAX_SENTENCE_WORDS 15
+#define NUM_SENTENCES 5000
+#define PATH_LENGTH 50
+#define PATH_STRIDE 7 // coprime with PATH_LENGTH
+#define TEST_SEED 3
+
+#define CHECK(condition) if (!(condition)) \
+    {fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+    #condition); return EXIT_FAILURE;}
+
+static void *copy_word(const void *word){return strdup(word);}
+
+static int compare_words(const void *a, const void *b){return strcmp(a, b);}
+
+static void print_word(const void *word){printf("%s", (const char *)word);}
+
+static bool is_last_word(const void *word)
+{
+    return ((const char *)word)[strlen(word) - 1] == '.';
+}
+
+static size_t word_size(const void *word){return strlen(word) + 1;}
+
+static MarkovChain *create_chain(void)
+{
+    MarkovChain *markov_chain = malloc(sizeof(MarkovChain));
+    if (!markov_chain){return NULL;}
+    markov_chain->database = calloc(1, sizeof(LinkedList));
+    if (!markov_chain->database){free(markov_chain); return NULL;}
+    markov_chain->copy_func = copy_word;
+    markov_chain->comp_func = compare_words;
+    markov_chain->free_data = free;
+    markov_chain->print_func = print_word;
+    markov_chain->is_last = is_last_word;
+    return markov_chain;
+}
+
+static int learn(MarkovChain *markov_chain, const char *from, const char *to)
+{
+    Node *from_node = add_to_database(markov_chain, (void *)from);
+    Node *to_node = add_to_database(markov_chain, (void *)to);
+    if (!from_node || !to_node){return EXIT_FAILURE;}
+    return add_node_to_frequency_list(from_node->data, to_node->data,
+        markov_chain);
+}
+
+/**
+ * Random sentences over a vocabulary where a few words are much more
+ * frequent than the others, as in real text.
+ */
+static int train_sentences(MarkovChain *markov_chain)
+{
+    CounterRng rng = counter_rng(TEST_SEED, 0);
+    char words[NUM_WORDS + NUM_ENDS][MAX_WORD_LENGTH];
+    for (int i = 0; i < NUM_WORDS + NUM_ENDS; i++)
+    {
+        sprintf(words[i], i < NUM_WORDS ? "w%d" : "e%d.", i);
+    }
+    for (int s = 0; s < NUM_SENTENCES; s++)
+    {
+        int length = 1 + (int)(rng_next(&rng) % MAX_SENTENCE_WORDS);
+        const char *prev = words[rng_next(&rng) % NUM_WORDS];
+        for (int i = 0; i < length; i++)
+        {
+            uint64_t word = rng_next(&rng) % NUM_WORDS;
+            word = word * word / NUM_WORDS; // skewed towards w0
+            const char *next = i + 1 == length
+                ? words[NUM_WORDS + rng_next(&rng) % NUM_ENDS] : words[word];
+            if (learn(markov_chain, prev, next) == EXIT_FAILURE)
+            {
+                return EXIT_FAILURE;
+            }
+            prev = next;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+static bool close_to(double value, double expected)
+{
+    return fabs(value - expected) <= TOLERANCE * (1 + fabs(expected));
+}
+
+/**
+ * A reordered index holds the states of the original one, with the same
+ * transition probabilities, sorted by decreasing weight, and copies of
+ * their nodes, frequency lists and data that agree with its arrays.
+ */
+static int check_same_model(const MarkovIndex *expected,
+    const MarkovIndex *index)
+{
+    CHECK(index->num_states == expected->num_states);
+    CHECK(index->num_edges == expected->num_edges);
+    for (int from = 0; from < expected->num_states; from++)
+    {
+        const char *word = expected->states[from]->data;
+        int id = markov_index_find(index, word);
+        CHECK(id != NOT_IN_INDEX);
+        MarkovNode *node = index->states[id];
+        CHECK(node != expected->states[from]);
+        CHECK(node->data != expected->states[from]->data);
+        CHECK(strcmp(node->data, word) == 0);
+        CHECK(index->is_last[id] == expected->is_last[from]);
+        CHECK(close_to(index->start_weights[id],
+            expected->start_weights[from]));
+        int begin = index->edge_offsets[id], end = index->edge_offsets[id + 1];
+        CHECK(end - begin == expected->edge_offsets[from + 1]
+                             - expected->edge_offsets[from]);
+        for (int e = expected->edge_offsets[from];
+             e < expected->edge_offsets[from + 1]; e++)
+        {
+            int to = markov_index_find(index,
+                expected->states[expected->edge_targets[e]]->data);
+            int edge = markov_index_find_edge(index, id, to);
+            CHECK(edge >= begin && edge < end);
+            CHECK(close_to(index->edge_weights[edge]
+                           / index->total_weights[id],
+                           expected->edge_weights[e]
+                           / expected->total_weights[from]));
+        }
+        MarkovNodeFrequency *freq = node->frequency_list;
+        for (int edge = begin; edge < end; edge++, freq = freq->next)
+        {
+            CHECK(edge == begin || index->edge_weights[edge]
+                                   <= index->edge_weights[edge - 1]);
+            CHECK(freq && freq->markov_node
+                          == index->states[index->edge_targets[edge]]);
+            CHECK(freq->frequency == index->edge_weights[edge]);
+        }
+        CHECK(!freq);
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Every order keeps the model, also when an index is reordered again.
+ */
+static int test_orders(MarkovChain *markov_chain)
+{
+    MarkovIndex *expected = create_markov_index(markov_chain, hash_string);
+    MarkovIndex *index = create_markov_index(markov_chain, hash_string);
+    CHECK(expected && index);
+    MarkovOrder orders[] = {ORDER_FREQUENCY, ORDER_BFS, ORDER_RCM};
+    for (int i = 0; i < 3; i++)
+    {
+        CHECK(markov_index_reorder(index, orders[i], word_size)
+              == EXIT_SUCCESS);
+        CHECK(check_same_model(expected, index) == EXIT_SUCCESS);
+    }
+    free_markov_index(&index);
+
+    // Without data_size, the data stay in the chain.
+    index = create_markov_index(markov_chain, hash_string);
+    CHECK(index);
+    CHECK(markov_index_reorder(index, ORDER_BFS, NULL) == EXIT_SUCCESS);
+    for (int id = 0; id < index->num_states; id++)
+    {
+        int old = markov_index_find(expected, index->states[id]->data);
+        CHECK(index->states[id]->data == expected->states[old]->data);
+    }
+    free_markov_index(&index);
+    free_markov_index(&expected);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * A path whose transitions alternate direction, stored in scrambled order:
+ * only a traversal of the transitions taken both ways finds the path, and
+ * reverse Cuthill-McKee then lays it out state after state.
+ */
+static int test_rcm_path(void)
+{
+    MarkovChain *markov_chain = create_chain();
+    CHECK(markov_chain);
+    char words[PATH_LENGTH][MAX_WORD_LENGTH];
+    for (int k = 0; k < PATH_LENGTH; k++){sprintf(words[k], "p%d", k);}
+    for (int k = 0; k < PATH_LENGTH; k++)
+    {
+        CHECK(add_to_database(markov_chain,
+            words[k * PATH_STRIDE % PATH_LENGTH]));
+    }
+    for (int k = 0; k + 1 < PATH_LENGTH; k++)
+    {
+        CHECK((k % 2 ? learn(markov_chain, words[k + 1], words[k])
+                     : learn(markov_chain, words[k], words[k + 1]))
+              == EXIT_SUCCESS);
+    }
+    MarkovIndex *index = create_markov_index(markov_chain, hash_string);
+    CHECK(index);
+    CHECK(markov_index_locality(index).mean_jump > 1);
+    CHECK(markov_index_reorder(index, ORDER_RCM, word_size) == EXIT_SUCCESS);
+    CHECK(markov_index_locality(index).mean_jump == 1);
+    free_markov_index(&index);
+    free_markov_chain(&markov_chain);
+    return EXIT_SUCCESS;
+}
+
+int main(void)
+{
+    MarkovChain *markov_chain = create_chain();
+    if (!markov_chain || train_sentences(markov_chain) == EXIT_FAILURE)
+    {
+        return EXIT_FAILURE;
+    }
+    int status = test_orders(markov_chain);
+    free_markov_chain(&markov_chain);
+    if (status == EXIT_SUCCESS){status = test_rcm_path();}
+    if (status == EXIT_SUCCESS){printf("markov_index_test: passed\n");}
+    return status;
+}
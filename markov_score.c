@@ -0,0 +1,203 @@
+#include "markov_score.h"
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#define SCORE_THREAD_ERROR "Error: failed to start scoring thread\n"
+
+double transition_log_prob(const MarkovIndex *index, int from, int to,
+    double smoothing)
+{
+    // Every unseen state is folded into one extra state.
+    double vocabulary = index->num_states + 1;
+    if (from == NOT_IN_INDEX){return -log(vocabulary);}
+    double weight = 0;
+    int edge = markov_index_find_edge(index, from, to);
+    if (edge != NOT_IN_INDEX){weight = index->edge_weights[edge];}
+    return log((weight + smoothing) /
+               (index->total_weights[from] + smoothing * vocabulary));
+}
+
+/**
+ * Score a single line, tokenizing it in place.
+ */
+static LineScore score_line(const MarkovIndex *index, char *line,
+    double smoothing)
+{
+    LineScore score = {0, 0};
+    int prev = NOT_IN_INDEX;
+    bool sentence_start = true;
+    char *save_ptr;
+    for (char *word = strtok_r(line, SCORE_DELIMITERS, &save_ptr); word;
+         word = strtok_r(NULL, SCORE_DELIMITERS, &save_ptr))
+    {
+        int id = markov_index_find(index, word);
+        if (!sentence_start)
+        {
+            score.log_prob += transition_log_prob(index, prev, id, smoothing);
+            score.num_transitions++;
+        }
+        // Unknown words are never last: the chain cannot tell.
+        sentence_start = id != NOT_IN_INDEX && index->is_last[id];
+        prev = id;
+    }
+    return score;
+}
+
+typedef struct ScoreJob {
+    ScorePool *pool;
+    const MarkovIndex *index;
+    char **lines;
+    LineScore *scores;
+    int num_lines;
+    double smoothing;
+} ScoreJob;
+
+struct ScorePool {
+    int num_threads;
+    ScoreJob *jobs;        // one per thread, jobs[0] for the calling thread
+    pthread_t *threads;    // workers of jobs[1..num_threads-1]
+    pthread_mutex_t lock;  // guards round, pending and stop
+    pthread_cond_t work;   // a new round of jobs was handed out, or stop
+    pthread_cond_t done;   // pending reached 0
+    long round;            // number of score_lines() calls so far
+    int pending;           // workers still scoring the current round
+    bool stop;
+};
+
+static void score_job(ScoreJob *job)
+{
+    for (int i = 0; i < job->num_lines; i++)
+    {
+        job->scores[i] = score_line(job->index, job->lines[i], job->smoothing);
+    }
+}
+
+/**
+ * Score the job of every round until told to stop.
+ */
+static void *score_worker(void *arg)
+{
+    ScoreJob *job = arg;
+    ScorePool *pool = job->pool;
+    long round = 0;
+    pthread_mutex_lock(&pool->lock);
+    while (true)
+    {
+        while (pool->round == round && !pool->stop)
+        {
+            pthread_cond_wait(&pool->work, &pool->lock);
+        }
+        if (pool->stop){break;}
+        round = pool->round;
+        pthread_mutex_unlock(&pool->lock);
+        score_job(job);
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->pending == 0){pthread_cond_signal(&pool->done);}
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+/**
+ * Stop and join the first num_workers workers of a pool, and free it.
+ */
+static void stop_score_pool(ScorePool *pool, int num_workers)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+    for (int t = 1; t <= num_workers; t++)
+    {
+        pthread_join(pool->threads[t], NULL);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work);
+    pthread_cond_destroy(&pool->done);
+    free(pool->jobs);
+    free(pool->threads);
+    free(pool);
+}
+
+ScorePool *create_score_pool(int num_threads)
+{
+    if (num_threads < 1){return NULL;}
+    ScorePool *pool = calloc(1, sizeof(ScorePool));
+    ScoreJob *jobs = calloc(num_threads, sizeof(ScoreJob));
+    pthread_t *threads = malloc(num_threads * sizeof(pthread_t));
+    if (!pool || !jobs || !threads)
+    {
+        free(pool);
+        free(jobs);
+        free(threads);
+        fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+        return NULL;
+    }
+    pool->num_threads = num_threads;
+    pool->jobs = jobs;
+    pool->threads = threads;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    for (int t = 1; t < num_threads; t++)
+    {
+        jobs[t].pool = pool;
+        if (pthread_create(&threads[t], NULL, score_worker, &jobs[t]) != 0)
+        {
+            fprintf(stderr, SCORE_THREAD_ERROR);
+            stop_score_pool(pool, t - 1);
+            return NULL;
+        }
+    }
+    return pool;
+}
+
+void free_score_pool(ScorePool **pool_ptr)
+{
+    if (!pool_ptr || !*pool_ptr){return;}
+    stop_score_pool(*pool_ptr, (*pool_ptr)->num_threads - 1);
+    *pool_ptr = NULL;
+}
+
+int score_lines(ScorePool *pool, const MarkovIndex *index, char **lines,
+    int num_lines, double smoothing, LineScore *scores, CorpusScore *total)
+{
+    if (!pool || !index || !lines || !scores || smoothing <= 0)
+    {
+        return EXIT_FAILURE;
+    }
+    // Contiguous ranges of lines; the calling thread takes the first one.
+    for (int t = 0; t < pool->num_threads; t++)
+    {
+        int first = (int)((long)num_lines * t / pool->num_threads);
+        int last = (int)((long)num_lines * (t + 1) / pool->num_threads);
+        pool->jobs[t] = (ScoreJob) {pool, index, lines + first,
+                                    scores + first, last - first, smoothing};
+    }
+    pthread_mutex_lock(&pool->lock);
+    pool->round++;
+    pool->pending = pool->num_threads - 1;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+    score_job(&pool->jobs[0]);
+    pthread_mutex_lock(&pool->lock);
+    while (pool->pending)
+    {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    // Sum in line order, so the total does not depend on the threads.
+    for (int i = 0; total && i < num_lines; i++)
+    {
+        total->log_prob += scores[i].log_prob;
+        total->num_transitions += scores[i].num_transitions;
+    }
+    return EXIT_SUCCESS;
+}
+
+double corpus_perplexity(const CorpusScore *total)
+{
+    if (!total || total->num_transitions == 0){return NAN;}
+    return exp(-total->log_prob / (double)total->num_transitions);
+}
@@ -0,0 +1,84 @@
+#ifndef _MARKOV_SCORE_H
+#define _MARKOV_SCORE_H
+
+#include "markov_index.h"
+
+#define DEFAULT_SMOOTHING 0.1
+#define SCORE_DELIMITERS " \n\t\r"
+
+/**
+ * Score of one line of text.
+ */
+typedef struct LineScore {
+    double log_prob;     // natural log probability of the line's transitions
+    int num_transitions; // number of scored transitions
+} LineScore;
+
+/**
+ * Running score of a whole corpus.
+ */
+typedef struct CorpusScore {
+    double log_prob;
+    long num_transitions;
+} CorpusScore;
+
+/**
+ * Threads scoring lines, started once and reused by every score_lines()
+ * call.
+ */
+typedef struct ScorePool ScorePool;
+
+/**
+ * Log probability of moving from one state to another, with additive
+ * smoothing so unseen transitions (and unseen states) get a non zero
+ * probability. Unseen states share a single extra id.
+ * @param index index of a trained chain
+ * @param from id of the first state, NOT_IN_INDEX if unknown
+ * @param to id of the second state, NOT_IN_INDEX if unknown
+ * @param smoothing pseudo count added to every transition, > 0
+ * @return natural log of P(to | from)
+ */
+double transition_log_prob(const MarkovIndex *index, int from, int to,
+    double smoothing);
+
+/**
+ * Start the threads of a pool.
+ * @param num_threads number of threads scoring, >= 1, the calling thread of
+ * score_lines() being one of them
+ * @return the pool, NULL on failure (error printed)
+ */
+ScorePool *create_score_pool(int num_threads);
+
+/**
+ * Stop the threads of a pool and free it.
+ * @param pool_ptr pool to free, set to NULL
+ */
+void free_score_pool(ScorePool **pool_ptr);
+
+/**
+ * Score lines of whitespace separated words against an index built over a
+ * chain of strings. Transitions are scored the way the chain was trained:
+ * a word for which is_last holds ends the sentence, and the next word
+ * starts a new one. Lines are split among the threads of the pool; lines
+ * are tokenized in place.
+ * @param pool threads to score with
+ * @param index index of a trained chain of strings
+ * @param lines lines to score, modified
+ * @param num_lines
+ * @param smoothing pseudo count added to every transition, > 0
+ * @param scores num_lines results, in order
+ * @param total if not NULL, the scores of the lines are added to it
+ * @return EXIT_SUCCESS / EXIT_FAILURE
+ */
+int score_lines(ScorePool *pool, const MarkovIndex *index, char **lines,
+    int num_lines, double smoothing, LineScore *scores, CorpusScore *total);
+
+/**
+ * Perplexity of a corpus: exp of the average negative log probability of
+ * its transitions.
+ * @param total score of the corpus
+ * @return the perplexity, NAN if nothing was scored
+ */
+double corpus_perplexity(const CorpusScore *total);
+
+#endif /* _MARKOV_SCORE_H */
@@ -0,0 +1,198 @@
+#include "markov_score.h"
+#include "word_table.h"
+#include <string.h>
+#include <math.h>
+
+#define TOLERANCE 1e-12
+#define SMOOTHING 0.5
+#define NUM_LINES 1000
+#define MAX_LINE 64
+#define MAX_THREADS 4
+
+#define CHECK(condition) if (!(condition)) \
+    {fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+    #condition); return EXIT_FAILURE;}
+
+// x -> y, y -> z., x -> z., y -> y, y -> z.
+static const char *const sentences[][4] = {
+    {"x", "y", "z.", NULL}, {"x", "z.", NULL}, {"y", "y", "z.", NULL}};
+#define NUM_SENTENCES (sizeof(sentences) / sizeof(sentences[0]))
+
+static void *copy_word(const void *word){return strdup(word);}
+
+static int compare_words(const void *a, const void *b){return strcmp(a, b);}
+
+static void print_word(const void *word){printf("%s", (const char *)word);}
+
+static bool is_last_word(const void *word)
+{
+    return ((const char *)word)[strlen(word) - 1] == '.';
+}
+
+static MarkovChain *create_chain(void)
+{
+    MarkovChain *markov_chain = malloc(sizeof(MarkovChain));
+    if (!markov_chain){return NULL;}
+    markov_chain->database = calloc(1, sizeof(LinkedList));
+    if (!markov_chain->database){free(markov_chain); return NULL;}
+    markov_chain->copy_func = copy_word;
+    markov_chain->comp_func = compare_words;
+    markov_chain->free_data = free;
+    markov_chain->print_func = print_word;
+    markov_chain->is_last = is_last_word;
+    return markov_chain;
+}
+
+static int train(MarkovChain *markov_chain)
+{
+    for (size_t s = 0; s < NUM_SENTENCES; s++)
+    {
+        MarkovNode *prev_node = NULL;
+        for (int i = 0; sentences[s][i]; i++)
+        {
+            Node *node = add_to_database(markov_chain,
+                                         (void *)sentences[s][i]);
+            if (!node || (prev_node && add_node_to_frequency_list(prev_node,
+                node->data, markov_chain) == EXIT_FAILURE))
+            {
+                return EXIT_FAILURE;
+            }
+            prev_node = node->data;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+static bool close_to(double value, double expected)
+{
+    return fabs(value - expected) <= TOLERANCE * (1 + fabs(expected));
+}
+
+/**
+ * P(to | from) = (weight + s) / (total + s * V), V counting one extra
+ * state for all the unseen ones.
+ */
+static int test_smoothing(const MarkovIndex *index)
+{
+    int x = markov_index_find(index, "x");
+    int y = markov_index_find(index, "y");
+    int z = markov_index_find(index, "z.");
+    CHECK(index->num_states == 3);
+    double vocabulary = 4;
+    double s = SMOOTHING;
+    CHECK(close_to(transition_log_prob(index, x, y, s),
+        log((1 + s) / (2 + s * vocabulary))));
+    CHECK(close_to(transition_log_prob(index, y, z, s),
+        log((2 + s) / (3 + s * vocabulary))));
+    CHECK(close_to(transition_log_prob(index, y, x, s),
+        log(s / (3 + s * vocabulary))));
+    CHECK(close_to(transition_log_prob(index, x, NOT_IN_INDEX, s),
+        log(s / (2 + s * vocabulary))));
+    CHECK(close_to(transition_log_prob(index, z, x, s),
+        log(s / (s * vocabulary))));
+    CHECK(close_to(transition_log_prob(index, NOT_IN_INDEX, x, s),
+        -log(vocabulary)));
+    // Probabilities out of a state, unseen ones included, sum to 1.
+    for (int from = 0; from < index->num_states; from++)
+    {
+        double sum = exp(transition_log_prob(index, from, NOT_IN_INDEX, s));
+        for (int to = 0; to < index->num_states; to++)
+        {
+            sum += exp(transition_log_prob(index, from, to, s));
+        }
+        CHECK(close_to(sum, 1));
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Lines score their transitions, not across a last word, and perplexity
+ * is exp of their average negative log probability.
+ */
+static int test_perplexity(const MarkovIndex *index)
+{
+    ScorePool *pool = create_score_pool(1);
+    CHECK(pool);
+    // x -> y, y -> z., then q (unknown, never last) -> x
+    char line[] = "x y z. q x";
+    char *lines[] = {line};
+    LineScore score;
+    CorpusScore total = {0, 0};
+    CHECK(score_lines(pool, index, lines, 1, SMOOTHING, &score, &total)
+          == EXIT_SUCCESS);
+    double expected = log(1.5 / 4) + log(2.5 / 5) + log(1.0 / 4);
+    CHECK(score.num_transitions == 3);
+    CHECK(close_to(score.log_prob, expected));
+    CHECK(total.num_transitions == 3);
+    CHECK(close_to(corpus_perplexity(&total), exp(-expected / 3)));
+    CorpusScore empty = {0, 0};
+    CHECK(isnan(corpus_perplexity(&empty)));
+    free_score_pool(&pool);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * A pool reused for several blocks gives the same scores, and the same
+ * total, whatever its number of threads.
+ */
+static int test_threads(const MarkovIndex *index)
+{
+    static char text[NUM_LINES][MAX_LINE];
+    static char *lines[NUM_LINES];
+    static LineScore scores[MAX_THREADS + 1][NUM_LINES];
+    CorpusScore totals[MAX_THREADS + 1];
+    const char *words[] = {"x", "y", "z.", "q"};
+    for (int threads = 1; threads <= MAX_THREADS; threads++)
+    {
+        ScorePool *pool = create_score_pool(threads);
+        CHECK(pool);
+        totals[threads] = (CorpusScore) {0, 0};
+        for (int i = 0; i < NUM_LINES; i++)
+        {
+            text[i][0] = '\0';
+            for (int k = 0; k < i % 9; k++)
+            {
+                strcat(text[i], words[(i * 7 + k * 3) % 4]);
+                strcat(text[i], " ");
+            }
+            lines[i] = text[i];
+        }
+        // Blocks of uneven sizes, some smaller than the pool.
+        for (int first = 0, size = 1; first < NUM_LINES; first += size,
+             size = size * 3 % 97 + 1)
+        {
+            int num_lines = first + size > NUM_LINES ? NUM_LINES - first
+                                                     : size;
+            CHECK(score_lines(pool, index, lines + first, num_lines,
+                SMOOTHING, scores[threads] + first, &totals[threads])
+                  == EXIT_SUCCESS);
+        }
+        free_score_pool(&pool);
+        CHECK(totals[threads].num_transitions == totals[1].num_transitions);
+        CHECK(totals[threads].log_prob == totals[1].log_prob);
+        for (int i = 0; i < NUM_LINES; i++)
+        {
+            CHECK(scores[threads][i].log_prob == scores[1][i].log_prob);
+        }
+    }
+    CHECK(totals[1].num_transitions > 0);
+    return EXIT_SUCCESS;
+}
+
+int main(void)
+{
+    MarkovChain *markov_chain = create_chain();
+    if (!markov_chain || train(markov_chain) == EXIT_FAILURE)
+    {
+        return EXIT_FAILURE;
+    }
+    MarkovIndex *index = create_markov_index(markov_chain, hash_string);
+    int status = index ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (status == EXIT_SUCCESS){status = test_smoothing(index);}
+    if (status == EXIT_SUCCESS){status = test_perplexity(index);}
+    if (status == EXIT_SUCCESS){status = test_threads(index);}
+    free_markov_index(&index);
+    free_markov_chain(&markov_chain);
+    if (status == EXIT_SUCCESS){printf("markov_score_test: passed\n");}
+    return status;
+}
@@ -0,0 +1,393 @@
+#include "markov_snapshot.h"
+#include <string.h>
+#include <stdatomic.h>
+
+#define INITIAL_SNAPSHOT_CAPACITY 1024
+#define NOT_READING 0 // epochs start at FIRST_EPOCH
+#define FIRST_EPOCH 1
+#define UPDATES_PER_COPY 16 // updates between publishes, per transition the
+                            // last publish copied
+
+/**
+ * Immutable transitions of a node, as published: cumulative[i] is the sum
+ * of the weights of transitions 0..i. One allocation, targets follow
+ * cumulative.
+ */
+typedef struct TransitionTable {
+    int num_transitions;
+    MarkovNode **targets;
+    double cumulative[];
+} TransitionTable;
+
+/**
+ * Nodes a sequence may start with. The writer appends past count and then
+ * publishes the new count, so readers only ever see the first count nodes;
+ * the table is replaced (and retired) only when it is full.
+ */
+typedef struct StartTable {
+    int capacity;
+    atomic_int count;
+    MarkovNode *nodes[];
+} StartTable;
+
+/**
+ * One per reader, on its own cache line so readers do not slow each other.
+ */
+typedef struct ReaderSlot {
+    _Alignas(CACHE_LINE_SIZE) atomic_ulong epoch; // NOT_READING, or the
+                                                  // epoch the read started in
+} ReaderSlot;
+
+typedef struct Retired {
+    void *block;         // table replaced in epoch
+    unsigned long epoch;
+} Retired;
+
+struct MarkovSnapshot {
+    ReaderSlot readers[MAX_SNAPSHOT_READERS];
+    atomic_ulong epoch;
+    atomic_int num_readers;
+    _Atomic(StartTable *) starts;
+    MarkovChain *markov_chain;
+
+    // Owned by the writer:
+    MarkovNode **dirty;      // nodes with snapshot_dirty set
+    int num_dirty;
+    int dirty_capacity;
+    MarkovNode **new_starts; // noted since the last publish
+    int num_new_starts;
+    int new_starts_capacity;
+    Retired *retired;        // waiting for the readers to move on
+    int num_retired;
+    int retired_capacity;
+    long pending_updates;    // updates noted since the last publish
+    long publish_cost;       // transitions copied by the last publish
+};
+
+/**
+ * Make room for at least size items in a growable array.
+ */
+static int reserve_items(void **items, int *capacity, int size,
+    size_t item_size)
+{
+    if (size <= *capacity){return EXIT_SUCCESS;}
+    int new_capacity = *capacity ? *capacity : INITIAL_SNAPSHOT_CAPACITY;
+    while (new_capacity < size){new_capacity *= 2;}
+    void *new_items = realloc(*items, new_capacity * item_size);
+    if (!new_items){return EXIT_FAILURE;}
+    *items = new_items;
+    *capacity = new_capacity;
+    return EXIT_SUCCESS;
+}
+
+// ------------------------ WRITER SIDE ------------------------
+
+int snapshot_note_node(MarkovSnapshot *snapshot, MarkovNode *markov_node)
+{
+    if (!snapshot || !markov_node){return EXIT_FAILURE;}
+    if (snapshot->markov_chain->is_last(markov_node->data))
+    {
+        return EXIT_SUCCESS;
+    }
+    if (reserve_items((void **)&snapshot->new_starts,
+        &snapshot->new_starts_capacity, snapshot->num_new_starts + 1,
+        sizeof(MarkovNode *)) == EXIT_FAILURE){return EXIT_FAILURE;}
+    snapshot->new_starts[snapshot->num_new_starts++] = markov_node;
+    return EXIT_SUCCESS;
+}
+
+int snapshot_note_transition(MarkovSnapshot *snapshot,
+    MarkovNode *markov_node)
+{
+    if (!snapshot || !markov_node){return EXIT_FAILURE;}
+    snapshot->pending_updates++;
+    if (markov_node->snapshot_dirty){return EXIT_SUCCESS;}
+    if (reserve_items((void **)&snapshot->dirty, &snapshot->dirty_capacity,
+        snapshot->num_dirty + 1, sizeof(MarkovNode *)) == EXIT_FAILURE)
+    {
+        return EXIT_FAILURE;
+    }
+    snapshot->dirty[snapshot->num_dirty++] = markov_node;
+    markov_node->snapshot_dirty = true;
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Copy the current transitions of a node into a new table.
+ * @return the table, NULL in case of allocation error
+ */
+static TransitionTable *build_table(MarkovSnapshot *snapshot,
+    MarkovNode *markov_node)
+{
+    int num_transitions = 0;
+    MarkovNodeFrequency *freq = markov_node->frequency_list;
+    for (; freq; freq = freq->next){num_transitions++;}
+    TransitionTable *table = malloc(sizeof(TransitionTable) +
+        num_transitions * (sizeof(double) + sizeof(MarkovNode *)));
+    if (!table){return NULL;}
+    snapshot->publish_cost += num_transitions;
+    table->num_transitions = num_transitions;
+    table->targets = (MarkovNode **)(table->cumulative + num_transitions);
+    double scale = get_transition_scale(markov_node);
+    double sum = 0;
+    int i = 0;
+    for (freq = markov_node->frequency_list; freq; freq = freq->next, i++)
+    {
+        sum += freq->weight * scale;
+        table->cumulative[i] = sum;
+        table->targets[i] = freq->markov_node;
+    }
+    return table;
+}
+
+/**
+ * Queue a replaced block until no reader can hold it. Room was reserved.
+ */
+static void retire(MarkovSnapshot *snapshot, void *block, unsigned long epoch)
+{
+    if (!block){return;}
+    snapshot->retired[snapshot->num_retired].block = block;
+    snapshot->retired[snapshot->num_retired].epoch = epoch;
+    snapshot->num_retired++;
+}
+
+static int publish_starts(MarkovSnapshot *snapshot, unsigned long epoch)
+{
+    if (snapshot->num_new_starts == 0){return EXIT_SUCCESS;}
+    StartTable *table = atomic_load_explicit(&snapshot->starts,
+        memory_order_relaxed);
+    int count = table ? atomic_load_explicit(&table->count,
+        memory_order_relaxed) : 0;
+    int new_count = count + snapshot->num_new_starts;
+    if (table && new_count <= table->capacity)
+    {
+        memcpy(table->nodes + count, snapshot->new_starts,
+            snapshot->num_new_starts * sizeof(MarkovNode *));
+        atomic_store_explicit(&table->count, new_count, memory_order_release);
+        snapshot->num_new_starts = 0;
+        return EXIT_SUCCESS;
+    }
+    int capacity = table ? 2 * table->capacity : INITIAL_SNAPSHOT_CAPACITY;
+    while (capacity < new_count){capacity *= 2;}
+    StartTable *new_table = malloc(sizeof(StartTable) +
+        capacity * sizeof(MarkovNode *));
+    if (!new_table){return EXIT_FAILURE;}
+    new_table->capacity = capacity;
+    if (count){memcpy(new_table->nodes, table->nodes,
+        count * sizeof(MarkovNode *));}
+    memcpy(new_table->nodes + count, snapshot->new_starts,
+        snapshot->num_new_starts * sizeof(MarkovNode *));
+    atomic_init(&new_table->count, new_count);
+    atomic_store(&snapshot->starts, new_table);
+    retire(snapshot, table, epoch);
+    snapshot->num_new_starts = 0;
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Free the retired blocks older than the oldest epoch a reader is in.
+ */
+static void reclaim(MarkovSnapshot *snapshot)
+{
+    // Pairs with the fence of snapshot_read_begin(): a reader whose epoch is
+    // not seen here is certain to see the blocks that replaced the retired
+    // ones.
+    atomic_thread_fence(memory_order_seq_cst);
+    unsigned long oldest = atomic_load(&snapshot->epoch);
+    int num_readers = atomic_load(&snapshot->num_readers);
+    if (num_readers > MAX_SNAPSHOT_READERS){num_readers = MAX_SNAPSHOT_READERS;}
+    for (int reader = 0; reader < num_readers; reader++)
+    {
+        unsigned long epoch = atomic_load(&snapshot->readers[reader].epoch);
+        if (epoch != NOT_READING && epoch < oldest){oldest = epoch;}
+    }
+    int kept = 0;
+    for (int i = 0; i < snapshot->num_retired; i++)
+    {
+        if (snapshot->retired[i].epoch < oldest)
+        {
+            free(snapshot->retired[i].block);
+        }
+        else
+        {
+            snapshot->retired[kept++] = snapshot->retired[i];
+        }
+    }
+    snapshot->num_retired = kept;
+}
+
+int snapshot_publish(MarkovSnapshot *snapshot)
+{
+    if (!snapshot){return EXIT_FAILURE;}
+    // Every block this call may replace gets a retired entry.
+    if (reserve_items((void **)&snapshot->retired,
+        &snapshot->retired_capacity,
+        snapshot->num_retired + snapshot->num_dirty + 1, sizeof(Retired))
+        == EXIT_FAILURE){return EXIT_FAILURE;}
+    unsigned long epoch = atomic_load(&snapshot->epoch);
+    int status = publish_starts(snapshot, epoch);
+    snapshot->pending_updates = 0;
+    snapshot->publish_cost = 0;
+    int kept = 0;
+    for (int i = 0; i < snapshot->num_dirty; i++)
+    {
+        MarkovNode *markov_node = snapshot->dirty[i];
+        TransitionTable *table = build_table(snapshot, markov_node);
+        if (!table)
+        {
+            // Stays dirty, published by a later call.
+            snapshot->dirty[kept++] = markov_node;
+            status = EXIT_FAILURE;
+            continue;
+        }
+        markov_node->snapshot_dirty = false;
+        // MarkovNode is a plain struct, hence the builtins.
+        retire(snapshot, __atomic_exchange_n(&markov_node->published, table,
+            __ATOMIC_SEQ_CST), epoch);
+    }
+    snapshot->num_dirty = kept;
+    atomic_fetch_add(&snapshot->epoch, 1);
+    reclaim(snapshot);
+    return status;
+}
+
+bool snapshot_publish_due(const MarkovSnapshot *snapshot)
+{
+    return snapshot && snapshot->pending_updates
+                       >= UPDATES_PER_COPY * snapshot->publish_cost;
+}
+
+int snapshot_retired_tables(const MarkovSnapshot *snapshot)
+{
+    return snapshot ? snapshot->num_retired : 0;
+}
+
+// ------------------------ READER SIDE ------------------------
+
+int snapshot_register_reader(MarkovSnapshot *snapshot)
+{
+    if (!snapshot){return -1;}
+    int reader = atomic_fetch_add(&snapshot->num_readers, 1);
+    return (reader < MAX_SNAPSHOT_READERS) ? reader : -1;
+}
+
+void snapshot_read_begin(MarkovSnapshot *snapshot, int reader)
+{
+    ReaderSlot *slot = &snapshot->readers[reader];
+    atomic_store(&slot->epoch, atomic_load(&snapshot->epoch));
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+void snapshot_read_end(MarkovSnapshot *snapshot, int reader)
+{
+    atomic_store_explicit(&snapshot->readers[reader].epoch, NOT_READING,
+        memory_order_release);
+}
+
+static MarkovNode *first_published_node(MarkovSnapshot *snapshot,
+    CounterRng *rng)
+{
+    StartTable *table = atomic_load_explicit(&snapshot->starts,
+        memory_order_acquire);
+    if (!table){return NULL;}
+    int count = atomic_load_explicit(&table->count, memory_order_acquire);
+    if (count == 0){return NULL;}
+    return table->nodes[rng_next(rng) % (uint64_t)count];
+}
+
+static MarkovNode *next_published_node(MarkovNode *markov_node,
+    double random_unit)
+{
+    TransitionTable *table = __atomic_load_n(&markov_node->published,
+        __ATOMIC_ACQUIRE);
+    if (!table || table->num_transitions == 0){return NULL;}
+    double target = random_unit
+                    * table->cumulative[table->num_transitions - 1];
+    // First transition whose cumulative weight exceeds target.
+    int low = 0, high = table->num_transitions - 1;
+    while (low < high)
+    {
+        int mid = low + (high - low) / 2;
+        if (table->cumulative[mid] > target){high = mid;}
+        else{low = mid + 1;}
+    }
+    return table->targets[low];
+}
+
+int snapshot_generate(MarkovSnapshot *snapshot, int reader, CounterRng *rng,
+    int max_length, MarkovNode **sequence)
+{
+    if (!snapshot || !rng || !sequence || max_length < 2 || reader < 0 ||
+        reader >= MAX_SNAPSHOT_READERS){return 0;}
+    snapshot_read_begin(snapshot, reader);
+    int length = 0;
+    MarkovNode *markov_node = first_published_node(snapshot, rng);
+    while (markov_node)
+    {
+        sequence[length++] = markov_node;
+        if (length == max_length ||
+            snapshot->markov_chain->is_last(markov_node->data)){break;}
+        markov_node = next_published_node(markov_node, rng_unit(rng));
+    }
+    snapshot_read_end(snapshot, reader);
+    return length;
+}
+
+// ------------------------- LIFETIME --------------------------
+
+MarkovSnapshot *create_markov_snapshot(MarkovChain *markov_chain)
+{
+    if (!markov_chain || !markov_chain->database){return NULL;}
+    MarkovSnapshot *snapshot = aligned_alloc(CACHE_LINE_SIZE,
+        sizeof(MarkovSnapshot));
+    if (!snapshot){fprintf(stderr, ALLOCATION_ERROR_MASSAGE); return NULL;}
+    memset(snapshot, 0, sizeof(MarkovSnapshot));
+    for (int reader = 0; reader < MAX_SNAPSHOT_READERS; reader++)
+    {
+        atomic_init(&snapshot->readers[reader].epoch, NOT_READING);
+    }
+    atomic_init(&snapshot->epoch, FIRST_EPOCH);
+    atomic_init(&snapshot->num_readers, 0);
+    atomic_init(&snapshot->starts, NULL);
+    snapshot->markov_chain = markov_chain;
+    int status = EXIT_SUCCESS;
+    for (Node *cur = markov_chain->database->first;
+         cur && status == EXIT_SUCCESS; cur = cur->next)
+    {
+        status = snapshot_note_node(snapshot, cur->data);
+        if (status == EXIT_SUCCESS && cur->data->frequency_list)
+        {
+            status = snapshot_note_transition(snapshot, cur->data);
+        }
+    }
+    if (status == EXIT_FAILURE || snapshot_publish(snapshot) == EXIT_FAILURE)
+    {
+        fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+        free_markov_snapshot(&snapshot);
+        return NULL;
+    }
+    return snapshot;
+}
+
+void free_markov_snapshot(MarkovSnapshot **snapshot_ptr)
+{
+    if (!snapshot_ptr || !*snapshot_ptr){return;}
+    MarkovSnapshot *snapshot = *snapshot_ptr;
+    for (int i = 0; i < snapshot->num_retired; i++)
+    {
+        free(snapshot->retired[i].block);
+    }
+    for (Node *cur = snapshot->markov_chain->database->first; cur;
+         cur = cur->next)
+    {
+        free(cur->data->published);
+        cur->data->published = NULL;
+        cur->data->snapshot_dirty = false;
+    }
+    free(atomic_load(&snapshot->starts));
+    free(snapshot->dirty);
+    free(snapshot->new_starts);
+    free(snapshot->retired);
+    free(snapshot);
+    *snapshot_ptr = NULL;
+}
@@ -0,0 +1,119 @@
+#ifndef _MARKOV_SNAPSHOT_H
+#define _MARKOV_SNAPSHOT_H
+
+#include "markov_chain.h"
+#include "counter_rng.h"
+
+#define MAX_SNAPSHOT_READERS 64
+#define CACHE_LINE_SIZE 64
+
+/**
+ * Read-mostly view of a MarkovChain that is still being trained. The single
+ * thread training the chain (the writer) reports what it changes, and every
+ * so often publishes it: each changed MarkovNode gets a new immutable
+ * transition table, swapped in with an atomic pointer store. Reader threads
+ * only ever follow published tables, so they never take a lock nor see a
+ * transition list half way through an update.
+ *
+ * Replaced tables are reclaimed by epochs: a reader announces the epoch it
+ * started reading in, and a table retired in epoch e is freed once no
+ * reader is still in an epoch <= e. MarkovNodes themselves (and their data)
+ * are never freed while training, so readers may keep using the nodes they
+ * generated after they stop reading.
+ */
+typedef struct MarkovSnapshot MarkovSnapshot;
+
+/**
+ * Create a live snapshot of a chain, and publish what it already holds.
+ * @param markov_chain chain with an allocated database; it must outlive the
+ * snapshot
+ * @return the snapshot, NULL in case of allocation error
+ */
+MarkovSnapshot *create_markov_snapshot(MarkovChain *markov_chain);
+
+/**
+ * Free a snapshot and every table it published. Readers must be done.
+ * @param snapshot_ptr snapshot to free, set to NULL
+ */
+void free_markov_snapshot(MarkovSnapshot **snapshot_ptr);
+
+// ------------------------ WRITER SIDE ------------------------
+
+/**
+ * Report a node that was added to the chain.
+ * @return EXIT_SUCCESS / EXIT_FAILURE in case of allocation error
+ */
+int snapshot_note_node(MarkovSnapshot *snapshot, MarkovNode *markov_node);
+
+/**
+ * Report that the transitions of a node changed.
+ * @return EXIT_SUCCESS / EXIT_FAILURE in case of allocation error
+ */
+int snapshot_note_transition(MarkovSnapshot *snapshot,
+    MarkovNode *markov_node);
+
+/**
+ * Publish every change reported since the last call, then free the tables
+ * no reader can still hold. Costs O(transitions of the changed nodes), so
+ * call it once per batch of updates rather than per word.
+ * @return EXIT_SUCCESS / EXIT_FAILURE in case of allocation error (what was
+ * published stays valid)
+ */
+int snapshot_publish(MarkovSnapshot *snapshot);
+
+/**
+ * Tell whether enough updates were noted to pay for the next publish: hot
+ * nodes are copied whole every time, so publishing after a fixed number of
+ * updates would make training slower as the chain grows. Publishing when
+ * this returns true keeps the copying to a fraction of the updates.
+ * @return true if it is time to call snapshot_publish()
+ */
+bool snapshot_publish_due(const MarkovSnapshot *snapshot);
+
+/**
+ * @return number of replaced tables not freed yet, as some reader may still
+ * hold them
+ */
+int snapshot_retired_tables(const MarkovSnapshot *snapshot);
+
+// ------------------------ READER SIDE ------------------------
+
+/**
+ * Reserve a reader slot, once per reader thread.
+ * @return the reader's id, -1 if all MAX_SNAPSHOT_READERS are taken
+ */
+int snapshot_register_reader(MarkovSnapshot *snapshot);
+
+/**
+ * Announce that a reader starts following published tables: until it calls
+ * snapshot_read_end(), none of the tables it may reach is freed.
+ * snapshot_generate() reads between the two calls on its own.
+ * @param snapshot
+ * @param reader id returned by snapshot_register_reader()
+ */
+void snapshot_read_begin(MarkovSnapshot *snapshot, int reader);
+
+/**
+ * Announce that a reader no longer holds any published table.
+ * @param snapshot
+ * @param reader id returned by snapshot_register_reader()
+ */
+void snapshot_read_end(MarkovSnapshot *snapshot, int reader);
+
+/**
+ * Generate a random sequence from the published state of the chain, like
+ * get_first_random_node() and generate_random_sequence() would without
+ * decay: the first node is drawn uniformly among the published non-last
+ * nodes, as start weights are not published (transition weights are, with
+ * their decay). Lock free: it only announces its epoch while it reads.
+ * @param snapshot
+ * @param reader id returned by snapshot_register_reader()
+ * @param rng random numbers of the reader
+ * @param max_length maximum length of the sequence, >= 2
+ * @param sequence at least max_length entries, filled with the nodes
+ * @return length of the sequence, 0 if nothing is published yet
+ */
+int snapshot_generate(MarkovSnapshot *snapshot, int reader, CounterRng *rng,
+    int max_length, MarkovNode **sequence);
+
+#endif /* _MARKOV_SNAPSHOT_H */
@@ -0,0 +1,255 @@
+#include "markov_snapshot.h"
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+
+#define NUM_WORDS 60
+#define NUM_ENDS 6
+#define MAX_WORD_LENGTH 8
+#define MAX_SENTENCE_WORDS 12
+#define NUM_SENTENCES 20000
+#define NUM_READERS 4
+#define MAX_LENGTH 20
+#define MAX_PAIRS 200000 // transitions recorded per reader
+#define TEST_SEED 5
+
+#define CHECK(condition) if (!(condition)) \
+    {fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+    #condition); return EXIT_FAILURE;}
+
+static void *copy_word(const void *word){return strdup(word);}
+
+static int compare_words(const void *a, const void *b){return strcmp(a, b);}
+
+static void print_word(const void *word){printf("%s", (const char *)word);}
+
+static bool is_last_word(const void *word)
+{
+    return ((const char *)word)[strlen(word) - 1] == '.';
+}
+
+static MarkovChain *create_chain(void)
+{
+    MarkovChain *markov_chain = malloc(sizeof(MarkovChain));
+    if (!markov_chain){return NULL;}
+    markov_chain->database = calloc(1, sizeof(LinkedList));
+    if (!markov_chain->database){free(markov_chain); return NULL;}
+    markov_chain->copy_func = copy_word;
+    markov_chain->comp_func = compare_words;
+    markov_chain->free_data = free;
+    markov_chain->print_func = print_word;
+    markov_chain->is_last = is_last_word;
+    return markov_chain;
+}
+
+/**
+ * Learn from -> to, and report it (and the nodes it adds) to the snapshot,
+ * as the training pipeline does.
+ */
+static int learn(MarkovChain *markov_chain, MarkovSnapshot *snapshot,
+    const char *from, const char *to)
+{
+    MarkovNode *nodes[2];
+    const char *words[2] = {from, to};
+    for (int i = 0; i < 2; i++)
+    {
+        Node *node = get_node_from_database(markov_chain, (void *)words[i]);
+        if (!node)
+        {
+            node = append_to_database(markov_chain, (void *)words[i]);
+            if (!node || snapshot_note_node(snapshot, node->data)
+                == EXIT_FAILURE){return EXIT_FAILURE;}
+        }
+        nodes[i] = node->data;
+    }
+    if (add_node_to_frequency_list(nodes[0], nodes[1], markov_chain)
+        == EXIT_FAILURE){return EXIT_FAILURE;}
+    return snapshot_note_transition(snapshot, nodes[0]);
+}
+
+/**
+ * A replaced table is freed only once no reader that could hold it still
+ * reads, whatever the readers that came later do.
+ */
+static int test_reclamation(void)
+{
+    MarkovChain *markov_chain = create_chain();
+    CHECK(markov_chain);
+    MarkovSnapshot *snapshot = create_markov_snapshot(markov_chain);
+    CHECK(snapshot);
+    CHECK(learn(markov_chain, snapshot, "a", "b") == EXIT_SUCCESS);
+    CHECK(learn(markov_chain, snapshot, "b", "end.") == EXIT_SUCCESS);
+    CHECK(snapshot_publish(snapshot) == EXIT_SUCCESS);
+    CHECK(snapshot_retired_tables(snapshot) == 0);
+    int holder = snapshot_register_reader(snapshot);
+    int late = snapshot_register_reader(snapshot);
+    CHECK(holder != -1 && late != -1);
+
+    snapshot_read_begin(snapshot, holder);
+    CHECK(learn(markov_chain, snapshot, "a", "c") == EXIT_SUCCESS);
+    CHECK(snapshot_publish(snapshot) == EXIT_SUCCESS);
+    CHECK(snapshot_retired_tables(snapshot) == 1);
+    CHECK(snapshot_publish(snapshot) == EXIT_SUCCESS);
+    CHECK(snapshot_retired_tables(snapshot) == 1);
+    // Other readers keep generating meanwhile.
+    CounterRng rng = counter_rng(TEST_SEED, 0);
+    MarkovNode *sequence[MAX_LENGTH];
+    CHECK(snapshot_generate(snapshot, late, &rng, MAX_LENGTH, sequence) > 0);
+    CHECK(snapshot_retired_tables(snapshot) == 1);
+
+    // A reader that started after the replacement cannot hold the old table.
+    snapshot_read_begin(snapshot, late);
+    snapshot_read_end(snapshot, holder);
+    CHECK(snapshot_publish(snapshot) == EXIT_SUCCESS);
+    CHECK(snapshot_retired_tables(snapshot) == 0);
+    snapshot_read_end(snapshot, late);
+
+    free_markov_snapshot(&snapshot);
+    free_markov_chain(&markov_chain);
+    return EXIT_SUCCESS;
+}
+
+typedef struct Reader {
+    MarkovSnapshot *snapshot;
+    atomic_bool *stop;
+    atomic_int sequences;
+    int id;
+    int num_pairs;
+    MarkovNode *(*pairs)[2]; // transitions walked
+    int bad_sequences;       // not ending as generate_random_sequence() would
+} Reader;
+
+static void *read_snapshot(void *arg)
+{
+    Reader *reader = arg;
+    CounterRng rng = counter_rng(TEST_SEED, reader->id);
+    MarkovNode *sequence[MAX_LENGTH];
+    while (!atomic_load(reader->stop))
+    {
+        int length = snapshot_generate(reader->snapshot, reader->id, &rng,
+            MAX_LENGTH, sequence);
+        if (!length){sched_yield(); continue;}
+        if (is_last_word(sequence[0]->data)){reader->bad_sequences++;}
+        for (int i = 1; i < length; i++)
+        {
+            if (is_last_word(sequence[i - 1]->data)){reader->bad_sequences++;}
+            if (reader->num_pairs == MAX_PAIRS){continue;}
+            reader->pairs[reader->num_pairs][0] = sequence[i - 1];
+            reader->pairs[reader->num_pairs][1] = sequence[i];
+            reader->num_pairs++;
+        }
+        atomic_fetch_add(&reader->sequences, 1);
+    }
+    return NULL;
+}
+
+static bool has_transition(const MarkovNode *from, const MarkovNode *to)
+{
+    for (MarkovNodeFrequency *freq = from->frequency_list; freq;
+         freq = freq->next)
+    {
+        if (freq->markov_node == to){return true;}
+    }
+    return false;
+}
+
+/**
+ * Train a random corpus the way fill_database_from_files() does.
+ * @param wait_for readers that must have generated before training goes on
+ */
+static int train(MarkovChain *markov_chain, MarkovSnapshot *snapshot,
+    Reader *wait_for)
+{
+    CounterRng rng = counter_rng(TEST_SEED, NUM_READERS);
+    char words[NUM_WORDS + NUM_ENDS][MAX_WORD_LENGTH];
+    for (int i = 0; i < NUM_WORDS + NUM_ENDS; i++)
+    {
+        sprintf(words[i], i < NUM_WORDS ? "w%d" : "e%d.", i);
+    }
+    for (int s = 0; s < NUM_SENTENCES; s++)
+    {
+        int length = 1 + (int)(rng_next(&rng) % MAX_SENTENCE_WORDS);
+        const char *prev = words[rng_next(&rng) % NUM_WORDS];
+        for (int i = 0; i < length; i++)
+        {
+            const char *next = i + 1 == length
+                ? words[NUM_WORDS + rng_next(&rng) % NUM_ENDS]
+                : words[rng_next(&rng) % NUM_WORDS];
+            if (learn(markov_chain, snapshot, prev, next) == EXIT_FAILURE)
+            {
+                return EXIT_FAILURE;
+            }
+            prev = next;
+        }
+        if (snapshot_publish_due(snapshot) &&
+            snapshot_publish(snapshot) == EXIT_FAILURE){return EXIT_FAILURE;}
+        if (s == 0)
+        {
+            // Make sure every reader runs while the chain still changes.
+            if (snapshot_publish(snapshot) == EXIT_FAILURE)
+            {
+                return EXIT_FAILURE;
+            }
+            for (int r = 0; r < NUM_READERS; r++)
+            {
+                while (!atomic_load(&wait_for[r].sequences)){sched_yield();}
+            }
+        }
+    }
+    return snapshot_publish(snapshot);
+}
+
+/**
+ * Readers generating while the chain trains only ever walk transitions
+ * the chain has, and every table they leave behind is eventually freed.
+ */
+static int test_concurrent_training(void)
+{
+    MarkovChain *markov_chain = create_chain();
+    CHECK(markov_chain);
+    MarkovSnapshot *snapshot = create_markov_snapshot(markov_chain);
+    CHECK(snapshot);
+    atomic_bool stop;
+    atomic_init(&stop, false);
+    Reader readers[NUM_READERS];
+    pthread_t threads[NUM_READERS];
+    for (int r = 0; r < NUM_READERS; r++)
+    {
+        readers[r] = (Reader) {snapshot, &stop, 0, 0, 0, NULL, 0};
+        readers[r].id = snapshot_register_reader(snapshot);
+        readers[r].pairs = malloc(MAX_PAIRS * sizeof(*readers[r].pairs));
+        CHECK(readers[r].id == r && readers[r].pairs);
+        CHECK(pthread_create(&threads[r], NULL, read_snapshot, &readers[r])
+              == 0);
+    }
+    int status = train(markov_chain, snapshot, readers);
+    atomic_store(&stop, true);
+    for (int r = 0; r < NUM_READERS; r++){pthread_join(threads[r], NULL);}
+    CHECK(status == EXIT_SUCCESS);
+
+    for (int r = 0; r < NUM_READERS; r++)
+    {
+        CHECK(atomic_load(&readers[r].sequences) > 0);
+        CHECK(readers[r].bad_sequences == 0);
+        for (int i = 0; i < readers[r].num_pairs; i++)
+        {
+            CHECK(has_transition(readers[r].pairs[i][0],
+                readers[r].pairs[i][1]));
+        }
+        free(readers[r].pairs);
+    }
+    CHECK(snapshot_publish(snapshot) == EXIT_SUCCESS);
+    CHECK(snapshot_retired_tables(snapshot) == 0);
+    free_markov_snapshot(&snapshot);
+    free_markov_chain(&markov_chain);
+    return EXIT_SUCCESS;
+}
+
+int main(void)
+{
+    if (test_reclamation() == EXIT_FAILURE ||
+        test_concurrent_training() == EXIT_FAILURE){return EXIT_FAILURE;}
+    printf("markov_snapshot_test: passed\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,188 @@
+#include "novelty_filter.h"
+#include "counter_rng.h"
+#include <string.h>
+
+#define NOVELTY_BASE 0xC2B2AE3D27D4EB4FULL // odd multiplier of rolling hashes
+#define WINDOW_SALT 0x165667B19E3779F9ULL
+#define SENTENCE_SALT 0x27D4EB2F165667C5ULL
+#define BITS_PER_BLOCK (NOVELTY_BLOCK_WORDS * 64)
+#define PROBE_BITS 9 // log2(BITS_PER_BLOCK)
+#define CACHE_LINE_BYTES 64
+#define INITIAL_SET_CAPACITY 1024
+#define EMPTY_SLOT 0
+
+NoveltyFilter *create_novelty_filter(long expected_items, int ngram,
+    hash_func_t hash_func)
+{
+    if (ngram < 1 || ngram > MAX_NOVELTY_NGRAM || !hash_func){return NULL;}
+    NoveltyFilter *filter = malloc(sizeof(NoveltyFilter));
+    if (!filter){fprintf(stderr, ALLOCATION_ERROR_MASSAGE); return NULL;}
+    size_t wanted = (expected_items > 0 ? expected_items : 1)
+                    * NOVELTY_BITS_PER_ITEM / BITS_PER_BLOCK + 1;
+    filter->num_blocks = 1;
+    while (filter->num_blocks < wanted){filter->num_blocks *= 2;}
+    size_t size = filter->num_blocks * NOVELTY_BLOCK_WORDS * sizeof(uint64_t);
+    filter->blocks = aligned_alloc(CACHE_LINE_BYTES, size);
+    if (!filter->blocks)
+    {
+        free(filter);
+        fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+        return NULL;
+    }
+    memset(filter->blocks, 0, size);
+    filter->ngram = ngram;
+    filter->hash_func = hash_func;
+    filter->top_power = 1;
+    for (int i = 1; i < ngram; i++){filter->top_power *= NOVELTY_BASE;}
+    return filter;
+}
+
+void free_novelty_filter(NoveltyFilter **filter_ptr)
+{
+    if (!filter_ptr || !*filter_ptr){return;}
+    free((*filter_ptr)->blocks);
+    free(*filter_ptr);
+    *filter_ptr = NULL;
+}
+
+// ------------------------- BLOOM -----------------------------
+
+static void bloom_add(NoveltyFilter *filter, uint64_t key)
+{
+    uint64_t hash = rng_mix(key);
+    uint64_t *block = filter->blocks + (hash & (filter->num_blocks - 1))
+                                       * NOVELTY_BLOCK_WORDS;
+    uint64_t probes = rng_mix(hash + 1);
+    for (int i = 0; i < NOVELTY_PROBES; i++, probes >>= PROBE_BITS)
+    {
+        unsigned bit = probes & (BITS_PER_BLOCK - 1);
+        block[bit / 64] |= 1ULL << (bit % 64);
+    }
+}
+
+static bool bloom_contains(const NoveltyFilter *filter, uint64_t key)
+{
+    uint64_t hash = rng_mix(key);
+    const uint64_t *block = filter->blocks + (hash & (filter->num_blocks - 1))
+                                             * NOVELTY_BLOCK_WORDS;
+    uint64_t probes = rng_mix(hash + 1);
+    for (int i = 0; i < NOVELTY_PROBES; i++, probes >>= PROBE_BITS)
+    {
+        unsigned bit = probes & (BITS_PER_BLOCK - 1);
+        if (!(block[bit / 64] & (1ULL << (bit % 64)))){return false;}
+    }
+    return true;
+}
+
+// ------------------------ SENTENCES --------------------------
+
+void novelty_start(NoveltyCursor *cursor)
+{
+    memset(cursor, 0, sizeof(NoveltyCursor));
+}
+
+/**
+ * Roll the hashes of a cursor forward by one state: the window hash is
+ * sum(hash_i * NOVELTY_BASE^(ngram-1-i)) over its states, so the oldest
+ * state is taken out and the new one put in with O(1) work.
+ */
+static void push_state(const NoveltyFilter *filter, NoveltyCursor *cursor,
+    const void *data)
+{
+    uint64_t hash = rng_mix(filter->hash_func(data));
+    int slot = cursor->length % filter->ngram;
+    if (cursor->length >= filter->ngram)
+    {
+        cursor->window_hash -= cursor->window[slot] * filter->top_power;
+    }
+    cursor->window_hash = cursor->window_hash * NOVELTY_BASE + hash;
+    cursor->window[slot] = hash;
+    cursor->sentence_hash = cursor->sentence_hash * NOVELTY_BASE + hash;
+    cursor->length++;
+}
+
+static uint64_t window_key(const NoveltyCursor *cursor)
+{
+    return cursor->window_hash ^ WINDOW_SALT;
+}
+
+static uint64_t sentence_key(const NoveltyCursor *cursor)
+{
+    return rng_mix(cursor->sentence_hash + cursor->length) ^ SENTENCE_SALT;
+}
+
+void novelty_learn(NoveltyFilter *filter, NoveltyCursor *cursor,
+    const void *data, bool ends_sentence)
+{
+    push_state(filter, cursor, data);
+    if (cursor->length >= filter->ngram)
+    {
+        bloom_add(filter, window_key(cursor));
+    }
+    if (ends_sentence)
+    {
+        bloom_add(filter, sentence_key(cursor));
+        novelty_start(cursor);
+    }
+}
+
+bool novelty_extend(const NoveltyFilter *filter, NoveltyCursor *cursor,
+    const void *data)
+{
+    push_state(filter, cursor, data);
+    return cursor->length < filter->ngram ||
+           !bloom_contains(filter, window_key(cursor));
+}
+
+bool novelty_is_copy(const NoveltyFilter *filter,
+    const NoveltyCursor *cursor)
+{
+    return bloom_contains(filter, sentence_key(cursor));
+}
+
+// ------------------------- BATCHES ---------------------------
+
+static uint64_t *set_slot(uint64_t *slots, size_t capacity, uint64_t key)
+{
+    size_t i = rng_mix(key) & (capacity - 1);
+    while (slots[i] != EMPTY_SLOT && slots[i] != key)
+    {
+        i = (i + 1) & (capacity - 1);
+    }
+    return &slots[i];
+}
+
+int sequence_set_insert(SequenceSet *set, const NoveltyCursor *cursor)
+{
+    uint64_t key = sentence_key(cursor);
+    if (key == EMPTY_SLOT){key++;}
+    if (2 * (set->size + 1) > set->capacity)
+    {
+        size_t capacity = set->capacity ? 2 * set->capacity
+                                        : INITIAL_SET_CAPACITY;
+        uint64_t *slots = calloc(capacity, sizeof(uint64_t));
+        if (!slots){return -1;}
+        for (size_t i = 0; i < set->capacity; i++)
+        {
+            if (set->slots[i] != EMPTY_SLOT)
+            {
+                *set_slot(slots, capacity, set->slots[i]) = set->slots[i];
+            }
+        }
+        free(set->slots);
+        set->slots = slots;
+        set->capacity = capacity;
+    }
+    uint64_t *slot = set_slot(set->slots, set->capacity, key);
+    if (*slot == key){return 0;}
+    *slot = key;
+    set->size++;
+    return 1;
+}
+
+void free_sequence_set(SequenceSet *set)
+{
+    if (!set){return;}
+    free(set->slots);
+    memset(set, 0, sizeof(SequenceSet));
+}
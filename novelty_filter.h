@@ -0,0 +1,107 @@
+#ifndef _NOVELTY_FILTER_H
+#define _NOVELTY_FILTER_H
+
+#include "markov_index.h" // For hash_func_t
+
+#define MAX_NOVELTY_NGRAM 16
+#define DEFAULT_NOVELTY_NGRAM 4
+#define NOVELTY_BITS_PER_ITEM 10 // about 1% false positives
+#define NOVELTY_BLOCK_WORDS 8    // 512 bit blocks, one cache line
+#define NOVELTY_PROBES 7         // bits set per item, all in one block
+
+/**
+ * Blocked Bloom filter over the sentences of a training corpus and their
+ * n-word windows, so generated sentences that copy the corpus can be told
+ * apart from novel ones. Each item sets NOVELTY_PROBES bits of a single
+ * block, so a lookup costs one cache miss. Items are hashes of the
+ * content of the states (not of their addresses), so the filter, and the
+ * output it selects, is the same from one run to the next.
+ */
+typedef struct NoveltyFilter {
+    uint64_t *blocks;   // num_blocks * NOVELTY_BLOCK_WORDS words
+    size_t num_blocks;  // power of 2
+    int ngram;          // window length, in states
+    hash_func_t hash_func;
+    uint64_t top_power; // NOVELTY_BASE^(ngram - 1), to roll windows
+} NoveltyFilter;
+
+/**
+ * Rolling hashes of the sentence being read or generated.
+ */
+typedef struct NoveltyCursor {
+    uint64_t window[MAX_NOVELTY_NGRAM]; // last ngram state hashes, circular
+    uint64_t window_hash;
+    uint64_t sentence_hash;
+    int length;
+} NoveltyCursor;
+
+/**
+ * Exact set of sentence hashes, to drop repeats within a batch.
+ */
+typedef struct SequenceSet {
+    uint64_t *slots; // open addressing, 0 is empty
+    size_t capacity; // power of 2
+    size_t size;
+} SequenceSet;
+
+/**
+ * Create an empty filter.
+ * @param expected_items about how many windows and sentences will be added
+ * @param ngram window length, 1..MAX_NOVELTY_NGRAM
+ * @param hash_func hash of the chain's data type
+ * @return the filter, NULL in case of allocation error
+ */
+NoveltyFilter *create_novelty_filter(long expected_items, int ngram,
+    hash_func_t hash_func);
+
+/**
+ * Free a filter.
+ * @param filter_ptr filter to free, set to NULL
+ */
+void free_novelty_filter(NoveltyFilter **filter_ptr);
+
+/**
+ * Start a new sentence.
+ */
+void novelty_start(NoveltyCursor *cursor);
+
+/**
+ * Training: add a state to the current sentence, recording its window once
+ * ngram states long, and the whole sentence if the state ends it.
+ * @param filter
+ * @param cursor the sentence, restarted after its last state
+ * @param data the state
+ * @param ends_sentence whether it is the last state of the sentence
+ */
+void novelty_learn(NoveltyFilter *filter, NoveltyCursor *cursor,
+    const void *data, bool ends_sentence);
+
+/**
+ * Generation: add a state to the sentence being generated, checking its
+ * window against the training corpus.
+ * @return false if the sentence now copies ngram states of the corpus
+ */
+bool novelty_extend(const NoveltyFilter *filter, NoveltyCursor *cursor,
+    const void *data);
+
+/**
+ * Generation: check a whole generated sentence against the corpus, which
+ * matters for sentences shorter than ngram.
+ * @return true if some training sentence is the same (up to false
+ * positives)
+ */
+bool novelty_is_copy(const NoveltyFilter *filter,
+    const NoveltyCursor *cursor);
+
+/**
+ * Add the sentence of a cursor to a set.
+ * @return 1 if it was new, 0 if it was already in, -1 on allocation error
+ */
+int sequence_set_insert(SequenceSet *set, const NoveltyCursor *cursor);
+
+/**
+ * Free the memory held by a set, leaving it empty.
+ */
+void free_sequence_set(SequenceSet *set);
+
+#endif /* _NOVELTY_FILTER_H */
@@ -0,0 +1,163 @@
+#include "novelty_filter.h"
+#include "word_table.h"
+#include <string.h>
+
+#define NUM_ITEMS 20000
+#define MAX_FALSE_POSITIVE_RATE 0.02 // NOVELTY_BITS_PER_ITEM gives about 1%
+#define NUM_SENTENCES 5000
+#define MAX_WORD_LENGTH 16
+#define WINDOW 3
+
+#define CHECK(condition) if (!(condition)) \
+    {fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+    #condition); return EXIT_FAILURE;}
+
+/**
+ * Learn a sentence of words, the last one ending it.
+ */
+static void learn_sentence(NoveltyFilter *filter, const char *const *words,
+    int length)
+{
+    NoveltyCursor cursor;
+    novelty_start(&cursor);
+    for (int i = 0; i < length; i++)
+    {
+        novelty_learn(filter, &cursor, words[i], i + 1 == length);
+    }
+}
+
+/**
+ * Generate a sentence of words.
+ * @return the number of words added before one copied the corpus, length
+ * if none did
+ */
+static int extend_sentence(const NoveltyFilter *filter,
+    NoveltyCursor *cursor, const char *const *words, int length)
+{
+    novelty_start(cursor);
+    for (int i = 0; i < length; i++)
+    {
+        if (!novelty_extend(filter, cursor, words[i])){return i;}
+    }
+    return length;
+}
+
+/**
+ * Every learned item is found, and items never learned are taken for
+ * learned ones at about the rate the filter is sized for.
+ */
+static int test_false_positives(void)
+{
+    NoveltyFilter *filter = create_novelty_filter(NUM_ITEMS, 1, hash_string);
+    CHECK(filter);
+    char word[MAX_WORD_LENGTH];
+    NoveltyCursor cursor;
+    novelty_start(&cursor);
+    for (int i = 0; i < NUM_ITEMS; i++)
+    {
+        sprintf(word, "learned%d", i);
+        novelty_learn(filter, &cursor, word, false);
+    }
+    int false_positives = 0;
+    for (int i = 0; i < NUM_ITEMS; i++)
+    {
+        sprintf(word, "learned%d", i);
+        novelty_start(&cursor);
+        CHECK(!novelty_extend(filter, &cursor, word));
+        sprintf(word, "unseen%d", i);
+        novelty_start(&cursor);
+        false_positives += !novelty_extend(filter, &cursor, word);
+    }
+    CHECK(false_positives <= MAX_FALSE_POSITIVE_RATE * NUM_ITEMS);
+    free_novelty_filter(&filter);
+    CHECK(!filter);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Windows roll: a window is the same whatever came before it, so copied
+ * words are caught anywhere in a sentence, while short prefixes and
+ * reordered words are not.
+ */
+static int test_rolling_windows(void)
+{
+    NoveltyFilter *filter = create_novelty_filter(1000, WINDOW, hash_string);
+    CHECK(filter);
+    const char *corpus[] = {"a", "b", "c", "d", "e."};
+    learn_sentence(filter, corpus, 5);
+
+    NoveltyCursor shifted, fresh;
+    const char *late[] = {"x", "y", "a", "b", "c"};
+    CHECK(extend_sentence(filter, &shifted, late, 5) == 4);
+    CHECK(extend_sentence(filter, &fresh, corpus, WINDOW) == WINDOW - 1);
+    CHECK(shifted.window_hash == fresh.window_hash);
+    const char *inner[] = {"z", "c", "d", "e."};
+    CHECK(extend_sentence(filter, &fresh, inner, 4) == 3);
+    const char *prefix[] = {"a", "b"};
+    CHECK(extend_sentence(filter, &fresh, prefix, 2) == 2);
+    const char *reordered[] = {"a", "c", "b", "d", "e."};
+    CHECK(extend_sentence(filter, &fresh, reordered, 5) == 5);
+    free_novelty_filter(&filter);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Whole sentences of the corpus are copies, even shorter than a window,
+ * but not their prefixes.
+ */
+static int test_copies(void)
+{
+    NoveltyFilter *filter = create_novelty_filter(1000, WINDOW, hash_string);
+    CHECK(filter);
+    const char *short_sentence[] = {"hi", "there."};
+    learn_sentence(filter, short_sentence, 2);
+    NoveltyCursor cursor;
+    CHECK(extend_sentence(filter, &cursor, short_sentence, 2) == 2);
+    CHECK(novelty_is_copy(filter, &cursor));
+    CHECK(extend_sentence(filter, &cursor, short_sentence, 1) == 1);
+    CHECK(!novelty_is_copy(filter, &cursor));
+    const char *other[] = {"there.", "hi"};
+    CHECK(extend_sentence(filter, &cursor, other, 2) == 2);
+    CHECK(!novelty_is_copy(filter, &cursor));
+    free_novelty_filter(&filter);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * A set takes each sentence once, however large it grows.
+ */
+static int test_sequence_set(void)
+{
+    NoveltyFilter *filter = create_novelty_filter(1, WINDOW, hash_string);
+    CHECK(filter);
+    SequenceSet set = {NULL, 0, 0};
+    NoveltyCursor cursor;
+    char words[2][MAX_WORD_LENGTH];
+    const char *sentence[] = {words[0], words[1]};
+    for (int round = 0; round < 2; round++)
+    {
+        for (int i = 0; i < NUM_SENTENCES; i++)
+        {
+            // "w<i> w<i+1>" and, reordered, "w<i+1> w<i>"
+            sprintf(words[i % 2], "w%d", i / 2);
+            sprintf(words[1 - i % 2], "w%d", i / 2 + 1);
+            extend_sentence(filter, &cursor, sentence, 2);
+            CHECK(sequence_set_insert(&set, &cursor) == (round == 0));
+        }
+        CHECK(set.size == NUM_SENTENCES);
+    }
+    free_sequence_set(&set);
+    CHECK(!set.slots && !set.size);
+    free_novelty_filter(&filter);
+    return EXIT_SUCCESS;
+}
+
+int main(void)
+{
+    if (test_false_positives() == EXIT_FAILURE ||
+        test_rolling_windows() == EXIT_FAILURE ||
+        test_copies() == EXIT_FAILURE ||
+        test_sequence_set() == EXIT_FAILURE){return EXIT_FAILURE;}
+    printf("novelty_filter_test: passed\n");
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,292 @@
+#include "parallel_generator.h"
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define FIRST_STATE_ATTEMPTS 64
+#define INITIAL_CHUNK_CAPACITY 4096
+#define GENERATOR_THREAD_ERROR "Error: failed to start generation thread\n"
+#define GENERATOR_WRITE_ERROR "Error: failed to write the generated sequences\n"
+
+/**
+ * Reusable output buffer of one chunk of sequences.
+ */
+typedef struct ChunkBuffer {
+    char *text;
+    size_t len;
+    size_t capacity;
+    long chunk; // the chunk this buffer holds or is waiting for
+    bool ready; // chunk is complete, waiting to be written
+} ChunkBuffer;
+
+typedef struct Generation {
+    const MarkovIndex *index;
+    uint64_t seed;
+    long num_sequences;
+    int max_length;
+    const char *label;
+    format_func_t format_func;
+    long num_chunks;
+    int num_slots;
+    ChunkBuffer *slots;     // chunk c lives in slots[c % num_slots]
+    atomic_long next_chunk; // next chunk a worker should claim
+    pthread_mutex_t lock;   // guards chunk, ready and failed
+    pthread_cond_t changed;
+    bool failed;
+} Generation;
+
+int index_first_random_state(const MarkovIndex *index, CounterRng *rng)
+{
+    if (!index || index->num_states == 0){return NOT_IN_INDEX;}
+    if (index->start_cumulative[index->num_states - 1] > 0)
+    {
+        return markov_index_first_weighted(index, rng_unit(rng));
+    }
+    for (int attempt = 0; attempt < FIRST_STATE_ATTEMPTS; attempt++)
+    {
+        int id = (int)(rng_next(rng) % (uint64_t)index->num_states);
+        if (!index->is_last[id]){return id;}
+    }
+    // Almost every state is last: take the next one that is not.
+    int start = (int)(rng_next(rng) % (uint64_t)index->num_states);
+    for (int i = 0; i < index->num_states; i++)
+    {
+        int id = (start + i) % index->num_states;
+        if (!index->is_last[id]){return id;}
+    }
+    return NOT_IN_INDEX;
+}
+
+int generate_sequence_ids(const MarkovIndex *index, uint64_t seed,
+    long sequence_number, int max_length, int *ids)
+{
+    if (!index || !ids || max_length < 2){return 0;}
+    CounterRng rng = counter_rng(seed, (uint64_t)sequence_number);
+    int id = index_first_random_state(index, &rng);
+    if (id == NOT_IN_INDEX){return 0;}
+    int length = 0;
+    ids[length++] = id;
+    while (length < max_length)
+    {
+        id = markov_index_next(index, id, rng_unit(&rng));
+        if (id == NOT_IN_INDEX){break;}
+        ids[length++] = id;
+        if (index->is_last[id]){break;}
+    }
+    return length;
+}
+
+// ------------------------- BUFFERS ---------------------------
+
+static int reserve(ChunkBuffer *buffer, size_t extra)
+{
+    if (buffer->len + extra < buffer->capacity){return EXIT_SUCCESS;}
+    size_t capacity = buffer->capacity ? buffer->capacity
+                                       : INITIAL_CHUNK_CAPACITY;
+    while (capacity <= buffer->len + extra){capacity *= 2;}
+    char *text = realloc(buffer->text, capacity);
+    if (!text){return EXIT_FAILURE;}
+    buffer->text = text;
+    buffer->capacity = capacity;
+    return EXIT_SUCCESS;
+}
+
+static int append_header(ChunkBuffer *buffer, const char *label,
+    long number)
+{
+    size_t room = buffer->capacity - buffer->len;
+    int len = snprintf(buffer->text + buffer->len, room, "%s %ld:", label,
+        number);
+    if (len < 0){return EXIT_FAILURE;}
+    if ((size_t)len >= room)
+    {
+        if (reserve(buffer, len) == EXIT_FAILURE){return EXIT_FAILURE;}
+        snprintf(buffer->text + buffer->len, len + 1, "%s %ld:", label,
+            number);
+    }
+    buffer->len += len;
+    return EXIT_SUCCESS;
+}
+
+static int append_state(ChunkBuffer *buffer, format_func_t format_func,
+    const void *data)
+{
+    size_t room = buffer->capacity - buffer->len;
+    int len = format_func(buffer->text + buffer->len, room, data);
+    if (len < 0){return EXIT_FAILURE;}
+    if ((size_t)len >= room)
+    {
+        if (reserve(buffer, len) == EXIT_FAILURE){return EXIT_FAILURE;}
+        format_func(buffer->text + buffer->len, len + 1, data);
+    }
+    buffer->len += len;
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Generate the sequences of one chunk into its buffer.
+ */
+static int fill_chunk(Generation *generation, long chunk, ChunkBuffer *buffer,
+    int *ids)
+{
+    long first = chunk * SEQUENCES_PER_CHUNK;
+    long last = first + SEQUENCES_PER_CHUNK;
+    if (last > generation->num_sequences){last = generation->num_sequences;}
+    if (reserve(buffer, 1) == EXIT_FAILURE){return EXIT_FAILURE;}
+    for (long sequence = first; sequence < last; sequence++)
+    {
+        int length = generate_sequence_ids(generation->index,
+            generation->seed, sequence, generation->max_length, ids);
+        if (append_header(buffer, generation->label, sequence + 1)
+            == EXIT_FAILURE){return EXIT_FAILURE;}
+        for (int i = 0; i < length; i++)
+        {
+            if (append_state(buffer, generation->format_func,
+                generation->index->states[ids[i]]->data) == EXIT_FAILURE)
+            {
+                return EXIT_FAILURE;
+            }
+        }
+        if (reserve(buffer, 1) == EXIT_FAILURE){return EXIT_FAILURE;}
+        buffer->text[buffer->len++] = '\n';
+    }
+    return EXIT_SUCCESS;
+}
+
+// ------------------------ THREADING --------------------------
+
+static void *generation_worker(void *arg)
+{
+    Generation *generation = arg;
+    int *ids = malloc(generation->max_length * sizeof(int));
+    long chunk;
+    while (ids && (chunk = atomic_fetch_add(&generation->next_chunk, 1))
+                  < generation->num_chunks)
+    {
+        ChunkBuffer *buffer = &generation->slots[chunk % generation->num_slots];
+        // Wait until the writer is done with the previous chunk of the slot.
+        pthread_mutex_lock(&generation->lock);
+        while (buffer->chunk != chunk && !generation->failed)
+        {
+            pthread_cond_wait(&generation->changed, &generation->lock);
+        }
+        bool failed = generation->failed;
+        pthread_mutex_unlock(&generation->lock);
+        if (failed){break;}
+        int res = fill_chunk(generation, chunk, buffer, ids);
+        pthread_mutex_lock(&generation->lock);
+        buffer->ready = true;
+        generation->failed |= (res == EXIT_FAILURE);
+        pthread_cond_broadcast(&generation->changed);
+        pthread_mutex_unlock(&generation->lock);
+    }
+    if (!ids)
+    {
+        pthread_mutex_lock(&generation->lock);
+        generation->failed = true;
+        pthread_cond_broadcast(&generation->changed);
+        pthread_mutex_unlock(&generation->lock);
+    }
+    free(ids);
+    return NULL;
+}
+
+/**
+ * Write the chunks out in order as they complete, then flush them.
+ * @return EXIT_SUCCESS / EXIT_FAILURE (error printed) if a worker failed or
+ * out did not take all the text (short write, closed pipe, full disk)
+ */
+static int write_chunks(Generation *generation, FILE *out)
+{
+    for (long chunk = 0; chunk < generation->num_chunks; chunk++)
+    {
+        ChunkBuffer *buffer = &generation->slots[chunk % generation->num_slots];
+        pthread_mutex_lock(&generation->lock);
+        while (!buffer->ready && !generation->failed)
+        {
+            pthread_cond_wait(&generation->changed, &generation->lock);
+        }
+        bool failed = generation->failed;
+        pthread_mutex_unlock(&generation->lock);
+        if (failed)
+        {
+            fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+            return EXIT_FAILURE;
+        }
+        if (fwrite(buffer->text, 1, buffer->len, out) != buffer->len)
+        {
+            fprintf(stderr, GENERATOR_WRITE_ERROR);
+            return EXIT_FAILURE;
+        }
+        pthread_mutex_lock(&generation->lock);
+        buffer->len = 0;
+        buffer->ready = false;
+        buffer->chunk = chunk + generation->num_slots;
+        pthread_cond_broadcast(&generation->changed);
+        pthread_mutex_unlock(&generation->lock);
+    }
+    if (fflush(out) == EOF)
+    {
+        fprintf(stderr, GENERATOR_WRITE_ERROR);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int generate_sequences_parallel(const MarkovIndex *index, uint64_t seed,
+    long num_sequences, int max_length, const char *label,
+    format_func_t format_func, int num_threads, FILE *out)
+{
+    if (!index || !label || !format_func || !out || num_threads < 1 ||
+        max_length < 2 || num_sequences < 0){return EXIT_FAILURE;}
+    Generation generation = {index, seed, num_sequences, max_length, label,
+                             format_func, 0, 0, NULL, 0,
+                             PTHREAD_MUTEX_INITIALIZER,
+                             PTHREAD_COND_INITIALIZER, false};
+    generation.num_chunks = (num_sequences + SEQUENCES_PER_CHUNK - 1)
+                            / SEQUENCES_PER_CHUNK;
+    generation.num_slots = num_threads * CHUNKS_PER_THREAD;
+    generation.slots = calloc(generation.num_slots, sizeof(ChunkBuffer));
+    pthread_t *threads = malloc(num_threads * sizeof(pthread_t));
+    if (!generation.slots || !threads)
+    {
+        free(generation.slots);
+        free(threads);
+        fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+        return EXIT_FAILURE;
+    }
+    for (int i = 0; i < generation.num_slots; i++)
+    {
+        generation.slots[i].chunk = i;
+    }
+    int started = 0;
+    for (; started < num_threads; started++)
+    {
+        if (pthread_create(&threads[started], NULL, generation_worker,
+            &generation) != 0){break;}
+    }
+    int status = EXIT_FAILURE;
+    if (started == num_threads)
+    {
+        status = write_chunks(&generation, out);
+    }
+    if (status == EXIT_FAILURE)
+    {
+        // Release workers waiting for a slot, they will not get it.
+        pthread_mutex_lock(&generation.lock);
+        generation.failed = true;
+        pthread_cond_broadcast(&generation.changed);
+        pthread_mutex_unlock(&generation.lock);
+        if (started < num_threads){fprintf(stderr, GENERATOR_THREAD_ERROR);}
+    }
+    for (int t = 0; t < started; t++){pthread_join(threads[t], NULL);}
+    for (int i = 0; i < generation.num_slots; i++)
+    {
+        free(generation.slots[i].text);
+    }
+    free(generation.slots);
+    free(threads);
+    pthread_mutex_destroy(&generation.lock);
+    pthread_cond_destroy(&generation.changed);
+    return status;
+}
@@ -0,0 +1,63 @@
+#ifndef _PARALLEL_GENERATOR_H
+#define _PARALLEL_GENERATOR_H
+
+#include "markov_index.h"
+#include "counter_rng.h"
+
+#define SEQUENCES_PER_CHUNK 256
+#define CHUNKS_PER_THREAD 2 // chunks in flight, per worker thread
+
+/**
+ * Pointer to a func that writes a state, as the chain's print_func would
+ * print it, into buffer (snprintf semantics).
+ * @return number of characters the state needs, excluding the NUL
+ */
+typedef int (*format_func_t)(char *buffer, size_t size, const void *data);
+
+/**
+ * Choose randomly a state that is not a "last state", like
+ * get_first_random_node() does (by start weight, if any was recorded),
+ * drawing from rng.
+ * @param index
+ * @param rng generator of the sequence
+ * @return id of the chosen state, NOT_IN_INDEX if every state is last
+ */
+int index_first_random_state(const MarkovIndex *index, CounterRng *rng);
+
+/**
+ * Generate sequence number sequence_number (counting from 0) of a seed,
+ * the way generate_random_sequence() does. Its random numbers come from
+ * counter_rng(seed, sequence_number), so the result depends on nothing
+ * else: not on other sequences, nor on the thread generating it.
+ * @param index
+ * @param seed user seed
+ * @param sequence_number
+ * @param max_length maximum length of the sequence, >= 2
+ * @param ids at least max_length entries, filled with the state ids
+ * @return length of the sequence, 0 if the index has no first state
+ */
+int generate_sequence_ids(const MarkovIndex *index, uint64_t seed,
+    long sequence_number, int max_length, int *ids);
+
+/**
+ * Generate num_sequences sequences with num_threads threads and write them,
+ * in order, as lines "<label> <n>: <state> <state> ...". Workers fill
+ * chunks of SEQUENCES_PER_CHUNK sequences in a bounded window of reusable
+ * buffers, which the calling thread writes out in order, so memory does not
+ * grow with num_sequences and the output does not depend on num_threads.
+ * @param index
+ * @param seed user seed
+ * @param num_sequences
+ * @param max_length maximum length of a sequence, >= 2
+ * @param label line prefix, e.g. "Tweet"
+ * @param format_func writes a state
+ * @param num_threads number of worker threads, >= 1
+ * @param out stream to write to, flushed at the end
+ * @return EXIT_SUCCESS / EXIT_FAILURE (error printed) in case of
+ * allocation or thread error, or if out did not take all the output
+ */
+int generate_sequences_parallel(const MarkovIndex *index, uint64_t seed,
+    long num_sequences, int max_length, const char *label,
+    format_func_t format_func, int num_threads, FILE *out);
+
+#endif /* _PARALLEL_GENERATOR_H */
@@ -0,0 +1,155 @@
+#include "parallel_generator.h"
+#include "word_table.h"
+#include <string.h>
+
+#define NUM_WORDS 200
+#define NUM_ENDS 8
+#define MAX_WORD_LENGTH 8
+#define MAX_SENTENCE_WORDS 15
+#define NUM_SENTENCES 3000
+#define NUM_SEQUENCES (5 * SEQUENCES_PER_CHUNK + 17) // last chunk partial
+#define MAX_LENGTH 20
+#define MAX_OUTPUT (NUM_SEQUENCES * (MAX_LENGTH + 2) * (MAX_WORD_LENGTH + 1))
+#define TEST_SEED 11
+
+#define CHECK(condition) if (!(condition)) \
+    {fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+    #condition); return EXIT_FAILURE;}
+
+static void *copy_word(const void *word){return strdup(word);}
+
+static int compare_words(const void *a, const void *b){return strcmp(a, b);}
+
+static void print_word(const void *word){printf(" %s", (const char *)word);}
+
+static int format_word(char *buffer, size_t size, const void *word)
+{
+    return snprintf(buffer, size, " %s", (const char *)word);
+}
+
+static bool is_last_word(const void *word)
+{
+    return ((const char *)word)[strlen(word) - 1] == '.';
+}
+
+static MarkovChain *create_chain(void)
+{
+    MarkovChain *markov_chain = malloc(sizeof(MarkovChain));
+    if (!markov_chain){return NULL;}
+    markov_chain->database = calloc(1, sizeof(LinkedList));
+    if (!markov_chain->database){free(markov_chain); return NULL;}
+    markov_chain->copy_func = copy_word;
+    markov_chain->comp_func = compare_words;
+    markov_chain->free_data = free;
+    markov_chain->print_func = print_word;
+    markov_chain->is_last = is_last_word;
+    return markov_chain;
+}
+
+static int train(MarkovChain *markov_chain)
+{
+    CounterRng rng = counter_rng(TEST_SEED, 0);
+    char words[NUM_WORDS + NUM_ENDS][MAX_WORD_LENGTH];
+    for (int i = 0; i < NUM_WORDS + NUM_ENDS; i++)
+    {
+        sprintf(words[i], i < NUM_WORDS ? "w%d" : "e%d.", i);
+    }
+    for (int s = 0; s < NUM_SENTENCES; s++)
+    {
+        int length = 1 + (int)(rng_next(&rng) % MAX_SENTENCE_WORDS);
+        MarkovNode *prev_node = NULL;
+        for (int i = 0; i <= length; i++)
+        {
+            const char *word = i == length
+                ? words[NUM_WORDS + rng_next(&rng) % NUM_ENDS]
+                : words[rng_next(&rng) % NUM_WORDS];
+            Node *node = add_to_database(markov_chain, (void *)word);
+            if (!node || (prev_node && add_node_to_frequency_list(prev_node,
+                node->data, markov_chain) == EXIT_FAILURE))
+            {
+                return EXIT_FAILURE;
+            }
+            prev_node = node->data;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * The output of generate_sequences_parallel(), written one sequence after
+ * another by the calling thread.
+ * @return its length
+ */
+static size_t expected_output(const MarkovIndex *index, char *text)
+{
+    int ids[MAX_LENGTH];
+    size_t len = 0;
+    for (long sequence = 0; sequence < NUM_SEQUENCES; sequence++)
+    {
+        int length = generate_sequence_ids(index, TEST_SEED, sequence,
+            MAX_LENGTH, ids);
+        len += sprintf(text + len, "Tweet %ld:", sequence + 1);
+        for (int i = 0; i < length; i++)
+        {
+            len += format_word(text + len, MAX_WORD_LENGTH + 2,
+                index->states[ids[i]]->data);
+        }
+        text[len++] = '\n';
+    }
+    return len;
+}
+
+/**
+ * Any number of threads writes the same text, the sequential one.
+ */
+static int test_threads(const MarkovIndex *index)
+{
+    static char expected[MAX_OUTPUT], text[MAX_OUTPUT];
+    size_t expected_len = expected_output(index, expected);
+    int thread_counts[] = {1, 2, 4, 7};
+    for (int i = 0; i < 4; i++)
+    {
+        FILE *out = tmpfile();
+        CHECK(out);
+        CHECK(generate_sequences_parallel(index, TEST_SEED, NUM_SEQUENCES,
+            MAX_LENGTH, "Tweet", format_word, thread_counts[i], out)
+              == EXIT_SUCCESS);
+        rewind(out);
+        size_t len = fread(text, 1, MAX_OUTPUT, out);
+        fclose(out);
+        CHECK(len == expected_len);
+        CHECK(memcmp(text, expected, len) == 0);
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * A stream that does not take the output makes the generation fail.
+ */
+static int test_write_error(const MarkovIndex *index)
+{
+    FILE *out = fopen("/dev/full", "w");
+    if (!out){return EXIT_SUCCESS;} // no such device here
+    int status = generate_sequences_parallel(index, TEST_SEED, NUM_SEQUENCES,
+        MAX_LENGTH, "Tweet", format_word, 2, out);
+    fclose(out);
+    CHECK(status == EXIT_FAILURE);
+    return EXIT_SUCCESS;
+}
+
+int main(void)
+{
+    MarkovChain *markov_chain = create_chain();
+    if (!markov_chain || train(markov_chain) == EXIT_FAILURE)
+    {
+        return EXIT_FAILURE;
+    }
+    MarkovIndex *index = create_markov_index(markov_chain, hash_string);
+    int status = index ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (status == EXIT_SUCCESS){status = test_threads(index);}
+    if (status == EXIT_SUCCESS){status = test_write_error(index);}
+    free_markov_index(&index);
+    free_markov_chain(&markov_chain);
+    if (status == EXIT_SUCCESS){printf("parallel_generator_test: passed\n");}
+    return status;
+}
@@ -1,5 +1,9 @@
 #include <string.h> // For strlen(), strcmp(), strcpy()
+#include <time.h>
+#include <math.h>
 #include "markov_chain.h"
+#include "board_eval.h"
+#include "cli_options.h"
 
 #define MAX(X, Y) (((X) < (Y)) ? (Y) : (X))
 
@@ -13,6 +17,28 @@
 #define EXPECTED_ARGS 3
 #define DECIMAL_BASE 10
 #define NUM_ARGS_ERROR "Usage: invalid number of arguments"
+#define FILE_PATH_ERROR "Error: incorrect file path"
+#define RANDOM_BOARD_ERROR "Error: cannot fit the requested snakes and ladders"
+
+#define NUM_SNAKES 10
+#define NUM_LADDERS 10
+#define DEFAULT_TOP_BOARDS 10
+#define NS_PER_SEC 1e9
+
+/**
+ * Optional "--name=value" arguments, for evaluating board variants.
+ */
+typedef struct BoardOptions {
+    char *boards_path;    // --boards: file of board definitions
+    int random_boards;    // --random-boards: number of boards to generate
+    int board_size;       // --board-size: cells of generated boards
+    int dice_max;         // --dice: highest dice outcome of generated boards
+    int num_snakes;       // --snakes: snakes of generated boards
+    int num_ladders;      // --ladders: ladders of generated boards
+    int num_threads;      // --threads: worker threads, defaults to all cores
+    int top;              // --top: number of ranked boards to print
+    BoardRank rank;       // --rank: length/variance/snakes/ladders
+} BoardOptions;
 
 /**
  * represents the transitions by ladders and snakes in the game
@@ -189,8 +215,48 @@ bool is_last_cell(const void *data)
     return cell->number == BOARD_SIZE;
 }
 // -------------------------------------------------------
-bool preprocessed_snake(int argc, char **argv, int *seed, int *num_sequences)
+bool parse_rank(const char *value, BoardRank *rank)
+{
+    static const char *rank_names[] = {"length", "variance", "snakes",
+                                       "ladders"};
+    *rank = RANK_LENGTH;
+    if (!value){return true;}
+    for (int i = 0; i < (int)(sizeof(rank_names) / sizeof(char *)); i++)
+    {
+        if (!strcmp(value, rank_names[i])){*rank = i; return true;}
+    }
+    return false;
+}
+
+bool parse_board_options(int *argc, char **argv, BoardOptions *options)
+{
+    options->boards_path = take_option(argc, argv, "boards");
+    if (parse_int_option(take_option(argc, argv, "random-boards"), 0, 0,
+            &options->random_boards) == EXIT_FAILURE
+        || parse_int_option(take_option(argc, argv, "board-size"),
+            BOARD_SIZE, 2, &options->board_size) == EXIT_FAILURE
+        || parse_int_option(take_option(argc, argv, "dice"), DICE_MAX, 1,
+            &options->dice_max) == EXIT_FAILURE
+        || parse_int_option(take_option(argc, argv, "snakes"), NUM_SNAKES, 0,
+            &options->num_snakes) == EXIT_FAILURE
+        || parse_int_option(take_option(argc, argv, "ladders"), NUM_LADDERS,
+            0, &options->num_ladders) == EXIT_FAILURE
+        || parse_int_option(take_option(argc, argv, "threads"),
+            default_num_threads(), 1, &options->num_threads) == EXIT_FAILURE
+        || parse_int_option(take_option(argc, argv, "top"),
+            DEFAULT_TOP_BOARDS, 0, &options->top) == EXIT_FAILURE
+        || !parse_rank(take_option(argc, argv, "rank"), &options->rank))
+    {
+        printf(OPTION_ERROR);
+        return false;
+    }
+    return true;
+}
+
+bool preprocessed_snake(int argc, char **argv, int *seed, int *num_sequences,
+    BoardOptions *options)
 {
+    if (!parse_board_options(&argc, argv, options)){return false;}
     if (argc!=EXPECTED_ARGS) {printf(NUM_ARGS_ERROR); return false;}
     *seed = strtol(argv[1], NULL,DECIMAL_BASE);
     srand(*seed);
@@ -223,6 +289,89 @@ bool initialize_markov_chain(MarkovChain** chain)
     return true;
 }
 
+/**
+ * Gather the boards to evaluate: those of --boards, then --random-boards
+ * generated ones.
+ * @return EXIT_SUCCESS / EXIT_FAILURE
+ */
+int load_board_variants(const BoardOptions *options, int seed,
+    BoardDefinition **boards, int *num_boards)
+{
+    *boards = NULL;
+    *num_boards = 0;
+    if (options->boards_path)
+    {
+        FILE *fp = fopen(options->boards_path, "r");
+        if (!fp){printf(FILE_PATH_ERROR); return EXIT_FAILURE;}
+        int res = read_boards(fp, boards, num_boards);
+        fclose(fp);
+        if (res == EXIT_FAILURE){return EXIT_FAILURE;}
+    }
+    BoardDefinition *all = realloc(*boards,
+        (*num_boards + options->random_boards + 1) * sizeof(BoardDefinition));
+    if (!all)
+    {
+        free(*boards);
+        return handle_error_snakes(ALLOCATION_ERROR_MASSAGE, NULL);
+    }
+    *boards = all;
+    for (int i = 0; i < options->random_boards; i++, (*num_boards)++)
+    {
+        if (generate_random_board(&all[*num_boards], options->board_size,
+            options->dice_max, options->num_snakes, options->num_ladders,
+            seed, i) == EXIT_FAILURE)
+        {
+            free(*boards);
+            return handle_error_snakes(RANDOM_BOARD_ERROR, NULL);
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Evaluate every board variant in parallel and print the best ones.
+ * @return EXIT_SUCCESS or EXIT_FAILURE
+ */
+int evaluate_board_variants(const BoardOptions *options, int seed)
+{
+    BoardDefinition *boards;
+    int num_boards;
+    if (load_board_variants(options, seed, &boards, &num_boards)
+        == EXIT_FAILURE){return EXIT_FAILURE;}
+    BoardStats *stats = malloc((num_boards + 1) * sizeof(BoardStats));
+    if (!stats)
+    {
+        free(boards);
+        return handle_error_snakes(ALLOCATION_ERROR_MASSAGE, NULL);
+    }
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int res = evaluate_boards(boards, num_boards, options->num_threads, stats);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (res == EXIT_SUCCESS)
+    {
+        rank_boards(stats, num_boards, options->rank);
+        int num_invalid = 0;
+        for (int i = 0; i < num_boards; i++)
+        {
+            if (!stats[i].valid){num_invalid++; continue;}
+            if (i >= options->top){continue;}
+            printf("Rank %d: board %d: expected length %.2f (std %.2f), "
+                   "snakes %.2f, ladders %.2f per game\n", i + 1,
+                   stats[i].board + 1, stats[i].expected_length,
+                   sqrt(stats[i].variance), stats[i].snake_hits,
+                   stats[i].ladder_hits);
+        }
+        double elapsed = (end.tv_sec - start.tv_sec)
+                         + (end.tv_nsec - start.tv_nsec) / NS_PER_SEC;
+        printf("Evaluated %d boards (%d can not be finished) in %.3f s\n",
+            num_boards, num_invalid, elapsed);
+    }
+    free(stats);
+    free(boards);
+    return res;
+}
+
 /**
  * @param argc num of arguments
  * @param argv 1) Seed
@@ -233,7 +382,8 @@ int main(int argc, char *argv[])
 {
     int seed;
     int num_sequences;
-    if (!preprocessed_snake(argc, argv, &seed, &num_sequences))
+    BoardOptions options;
+    if (!preprocessed_snake(argc, argv, &seed, &num_sequences, &options))
         {
         return EXIT_FAILURE;
         }
@@ -253,5 +403,9 @@ int main(int argc, char *argv[])
         // printf("\n");
     }
     free_markov_chain(&markov_chain);
+    if (options.boards_path || options.random_boards)
+    {
+        return evaluate_board_variants(&options, seed);
+    }
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,51 @@
+#include "tweets_complete.h"
+#include "tweets_generator.h"
+#include "markov_score.h"
+#include "markov_beam.h"
+#include <string.h>
+
+int complete_file(const MarkovIndex *index, const TweetOptions *options)
+{
+    FILE *fp = fopen(options->complete_path, "r");
+    if (!fp){fprintf(stderr, FILE_PATH_ERROR); return EXIT_FAILURE;}
+    BeamSearch *search = create_beam_search(options->beam_width,
+        options->top_k, MAX_TWEET_LENGTH);
+    if (!search){fclose(fp); return EXIT_FAILURE;}
+    char *line = NULL;
+    size_t capacity = 0;
+    for (int query = 1; getline(&line, &capacity, fp) != -1; query++)
+        {
+        char *last_word = NULL;
+        char *save_ptr;
+        for (char *word = strtok_r(line, SCORE_DELIMITERS, &save_ptr); word;
+             word = strtok_r(NULL, SCORE_DELIMITERS, &save_ptr))
+            {
+            last_word = word;
+            }
+        int start = last_word ? markov_index_find(index, last_word)
+                              : NOT_IN_INDEX;
+        int found = beam_search(search, index, start);
+        if (!found){printf("Completion %d: none\n", query);}
+        for (int k = 0; k < found; k++)
+            {
+            const BeamCompletion *completion = &search->completions[k];
+            printf("Completion %d.%d: %f", query, k + 1,
+                completion->log_prob);
+            for (int i = 0; i < completion->length; i++)
+                {
+                print_string(index->states[completion->states[i]]->data);
+                }
+            printf("\n");
+            }
+        }
+    int status = EXIT_SUCCESS;
+    if (ferror(fp))
+        {
+        fprintf(stderr, FILE_PATH_ERROR);
+        status = EXIT_FAILURE;
+        }
+    free(line);
+    free_beam_search(&search);
+    fclose(fp);
+    return status;
+}
@@ -0,0 +1,13 @@
+#ifndef _TWEETS_COMPLETE_H
+#define _TWEETS_COMPLETE_H
+
+#include "tweets_options.h"
+
+/**
+ * Print the --top most likely continuations of the last word of every line
+ * of the --complete file, as autocomplete would suggest them. Every query
+ * reuses the same search, so only reading the lines allocates.
+ */
+int complete_file(const MarkovIndex *index, const TweetOptions *options);
+
+#endif /* _TWEETS_COMPLETE_H */
@@ -1,17 +1,19 @@
-#include "markov_chain.h"
+#include "tweets_generator.h"
+#include "tweets_options.h"
+#include "tweets_layout.h"
+#include "tweets_score.h"
+#include "tweets_hmm.h"
+#include "tweets_complete.h"
+#include "tweets_novel.h"
+#include "tweets_live.h"
+#include "tweets_tokens.h"
+#include "parallel_generator.h"
 #include <string.h>
 
-#define FILE_PATH_ERROR "Error: incorrect file path"
 #define NUM_ARGS_ERROR "Usage: invalid number of arguments"
 
-#define DELIMITERS " \n\t\r"
-
-#define DECIMAL_BASE 10
 #define MIN_EXPECTED_ARGS 4
 #define MAX_EXPECTED_ARGS 5
-#define MAX_LINE_LENGTH 1000
-#define MAX_TWEET_LENGTH 20
-#define DEFAULT_WORDS_TO_READ -1
 
 // --------------------- FUNCTIONS -----------------------
 
@@ -29,9 +31,14 @@ void *copy_string(const void *data){return strdup((const char *)data);}
 // void print_string(const void *data) {printf("%s", (const char *)data);}
 void print_string(const void *data) {printf(" %s", (const char *)data);}
 
+int format_string(char *buffer, size_t size, const void *data)
+{return snprintf(buffer, size, " %s", (const char *)data);}
+
 int compare_strings(const void *a, const void *b)
 {return strcmp((const char *)a, (const char *)b);}
 
+size_t string_size(const void *data){return strlen((const char *)data) + 1;}
+
 bool is_last_string(const void *data) {
     const char *str = (const char *)data;
     size_t len = strlen(str);
@@ -39,12 +46,14 @@ bool is_last_string(const void *data) {
 }
 
 // -------------------------------------------------------
-void read_file(FILE *fp, MarkovChain *markov_chain, int words_to_read);
-int fill_database(FILE *fp, int words_to_read, MarkovChain *markov_chain);
+int fill_database(const TrainingCorpus *corpus, int words_to_read,
+    MarkovChain *markov_chain, training_hook_t hook, void *context,
+    int live_readers, unsigned int seed);
 // -------------------------------------------------------
 bool preprocessed(int argc, char **argv, unsigned int *seed, int *num_tweets,
-    FILE **fp, int *words_to_read)
+    CorpusFiles *files, int *words_to_read, TweetOptions *options)
 {
+    if (!parse_options(&argc, argv, options)){return false;}
     if (argc < MIN_EXPECTED_ARGS || argc > MAX_EXPECTED_ARGS)
         {
         fprintf(stderr, NUM_ARGS_ERROR);
@@ -53,14 +62,14 @@ bool preprocessed(int argc, char **argv, unsigned int *seed, int *num_tweets,
     *seed = strtol(argv[1], NULL,DECIMAL_BASE);
     srand(*seed);
     *num_tweets = strtol(argv[2], NULL, DECIMAL_BASE);
-    char *file_path = argv[3];
+    // A file, a directory, or a comma separated list of them (may be gzip).
+    char *file_paths = argv[3];
     *words_to_read = DEFAULT_WORDS_TO_READ;
     if (argc == MAX_EXPECTED_ARGS)
         {
         *words_to_read = strtol(argv[4], NULL, DECIMAL_BASE);
         }
-    *fp = fopen(file_path, "r");
-    if (!*fp)
+    if (collect_corpus_files(file_paths, files) == EXIT_FAILURE)
         {
         fprintf(stderr, FILE_PATH_ERROR);
         return false;
@@ -72,10 +81,12 @@ int main(int argc, char *argv[])
 {
     unsigned int seed;
     int num_tweets;
-    FILE *fp;
+    CorpusFiles files;
     int words_to_read;
+    TweetOptions options;
     // Preprocess CLI input
-    if (!preprocessed(argc, argv, &seed, &num_tweets, &fp, &words_to_read))
+    if (!preprocessed(argc, argv, &seed, &num_tweets, &files, &words_to_read,
+        &options))
         {
         return EXIT_FAILURE;
         }
@@ -84,6 +95,7 @@ int main(int argc, char *argv[])
     if (!markov_chain)
         {
         fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+        free_corpus_files(&files);
         return EXIT_FAILURE;
         }
     markov_chain->database = NULL;
@@ -92,62 +104,111 @@ int main(int argc, char *argv[])
     markov_chain->free_data = (free_data_t)free;
     markov_chain->print_func = (print_func_t)print_string;
     markov_chain->is_last = (is_last_t)is_last_string;
-    if (fill_database(fp, words_to_read, markov_chain) == EXIT_FAILURE)
+    TrainingCorpus corpus = {&files, NULL, {0, 0, NO_FOLDS, 0, false},
+                             create_markov_decay(options.half_life)};
+    if (options.half_life != NO_HALF_LIFE && !corpus.decay)
+        {
+        free(markov_chain);
+        free_corpus_files(&files);
+        return EXIT_FAILURE;
+        }
+    CorpusTokens *tokens = NULL;
+    if (options.tokens_path)
+        {
+        tokens = open_token_index(&files, markov_chain, options.tokens_path);
+        if (!tokens)
+            {
+            free_markov_decay(&corpus.decay);
+            free(markov_chain);
+            free_corpus_files(&files);
+            return EXIT_FAILURE;
+            }
+        corpus.tokens = tokens;
+        corpus.selection = select_sentences(tokens, &options);
+        }
+    NoveltyRun novelty = {NULL, {NULL, 0, 0}, 0, 0, 0, {{0}, 0, 0, 0}};
+    training_hook_t hook = NULL;
+    if (options.novel != NO_NOVELTY)
+        {
+        novelty.filter = create_corpus_novelty_filter(&files, words_to_read,
+            options.novel);
+        hook = learn_novelty;
+        }
+    if ((options.novel != NO_NOVELTY && !novelty.filter) ||
+        fill_database(&corpus, words_to_read, markov_chain, hook, &novelty,
+        options.live_readers, seed) == EXIT_FAILURE)
         {
+        free_novelty_filter(&novelty.filter);
+        free_corpus_tokens(&tokens);
         free_markov_chain(&markov_chain);
-        fclose(fp);
+        free_markov_decay(&corpus.decay);
+        free_corpus_files(&files);
         return EXIT_FAILURE;
         }
+    // Freeze the model for the fast paths
+    MarkovIndex *index = NULL;
+    int status = EXIT_SUCCESS;
+    if (options.score_path || options.stats || options.order != NO_REORDER
+        || options.parallel || options.hmm_path || options.complete_path)
+        {
+        index = create_markov_index(markov_chain, hash_string);
+        status = index ? finalize_index(index, &options) : EXIT_FAILURE;
+        }
     // Make "predictions" of tweets (create user specified tweets)
-    for (int i = 1; i <= num_tweets; i++)
+    if (status == EXIT_SUCCESS && options.parallel)
+        {
+        status = generate_sequences_parallel(index, seed, num_tweets,
+            MAX_TWEET_LENGTH, "Tweet", format_string, options.num_threads,
+            stdout);
+        }
+    if (status == EXIT_SUCCESS && novelty.filter)
+        {
+        status = print_novel_tweets(markov_chain, &novelty, num_tweets);
+        }
+    // A reordered model is only worth its layout if tweets walk it
+    if (status == EXIT_SUCCESS && !options.parallel && !novelty.filter &&
+        options.order != NO_REORDER)
+        {
+        status = print_index_tweets(index, seed, num_tweets);
+        }
+    for (int i = 1; status == EXIT_SUCCESS && !options.parallel &&
+         !novelty.filter && options.order == NO_REORDER && i <= num_tweets;
+         i++)
         {
         MarkovNode *first_node = get_first_random_node(markov_chain);
         printf("Tweet %d:", i);
         generate_random_sequence(markov_chain, first_node, MAX_TWEET_LENGTH);
         }
+    // Score user given text against the model
+    if (status == EXIT_SUCCESS && options.score_path)
+        {
+        status = score_file(index, &options);
+        }
+    // Tag user given text with hidden states learned from it
+    if (status == EXIT_SUCCESS && options.hmm_path)
+        {
+        status = tag_file(index, &options, seed);
+        }
+    // Complete user given text with its most likely continuations
+    if (status == EXIT_SUCCESS && options.complete_path)
+        {
+        status = complete_file(index, &options);
+        }
+    // Evaluate the model on parts of the corpus it was not trained on
+    if (status == EXIT_SUCCESS && options.folds != NO_FOLDS)
+        {
+        status = print_cross_validation(markov_chain, &corpus, &options);
+        }
 
+    free_novelty_filter(&novelty.filter);
+    free_sequence_set(&novelty.seen);
+    free_markov_index(&index);
     free_markov_chain(&markov_chain);
-    fclose(fp);
+    free_markov_decay(&corpus.decay);
+    free_corpus_tokens(&tokens);
+    free_corpus_files(&files);
 
-    return EXIT_SUCCESS;
-}
-
-int read_and_process_file(FILE *fp, int words_to_read, MarkovChain
-    *markov_chain)
-{
-    char line[MAX_LINE_LENGTH];
-    MarkovNode *prev_node = NULL;
-    int words_read = 0;
-    // Read file line by line
-    while (fgets(line, sizeof(line), fp)
-           && (words_to_read == DEFAULT_WORDS_TO_READ ||
-               words_read < words_to_read))
-        {
-        char *token = strtok(line, DELIMITERS);
-        // Process each word (token) in the line
-        while (token && (words_to_read == DEFAULT_WORDS_TO_READ ||
-            words_read < words_to_read))
-            {
-            char *word = strdup(token);
-            if (!word) {return EXIT_FAILURE;}
-            Node *current_node = add_to_database(markov_chain, (void*)word);
-            free(word);
-            if (!current_node){return EXIT_FAILURE;}
-            MarkovNode *markov_node = current_node->data;
-            if (prev_node)
-                {
-                if (add_node_to_frequency_list(prev_node, markov_node,
-                    markov_chain) == EXIT_FAILURE){return EXIT_FAILURE;}
-                }
-            if (markov_chain->is_last(markov_node->data)) {
-                prev_node = NULL;
-            }
-            else {prev_node = markov_node;}
-            token = strtok(NULL, DELIMITERS);
-            words_read++;
-            }
-        }
-    return EXIT_SUCCESS;
+    return status;
 }
 
 int validate_and_finalize_database(MarkovChain *markov_chain) {
@@ -177,7 +238,9 @@ int validate_and_finalize_database(MarkovChain *markov_chain) {
     return EXIT_SUCCESS;
 }
 
-int fill_database(FILE *fp, int words_to_read, MarkovChain *markov_chain)
+int fill_database(const TrainingCorpus *corpus, int words_to_read,
+    MarkovChain *markov_chain, training_hook_t hook, void *context,
+    int live_readers, unsigned int seed)
 {
     // Allocate memory for the database
     markov_chain->database = malloc(sizeof(LinkedList));
@@ -190,8 +253,25 @@ int fill_database(FILE *fp, int words_to_read, MarkovChain *markov_chain)
     markov_chain->database->last = NULL;
     markov_chain->database->size = 0;
 
-    // Read and process the file
-    if (read_and_process_file(fp, words_to_read, markov_chain) == EXIT_FAILURE)
+    // Read and process the files, maybe generating from them meanwhile, or
+    // learn their words straight from the token index
+    int status;
+    if (corpus->tokens)
+        {
+        status = fill_database_from_tokens(markov_chain, corpus->tokens,
+            &corpus->selection, words_to_read, corpus->decay, hook, context);
+        }
+    else if (live_readers)
+        {
+        status = train_with_live_readers(corpus, words_to_read,
+            markov_chain, hook, context, live_readers, seed);
+        }
+    else
+        {
+        status = fill_database_from_files(markov_chain, corpus->files,
+            words_to_read, corpus->decay, hook, context);
+        }
+    if (status == EXIT_FAILURE)
         {
         return EXIT_FAILURE;
         }
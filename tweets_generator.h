@@ -0,0 +1,33 @@
+#ifndef _TWEETS_GENERATOR_H
+#define _TWEETS_GENERATOR_H
+
+#include "markov_chain.h"
+#include "corpus_pipeline.h"
+#include "corpus_tokens.h"
+#include "word_table.h" // For hash_string()
+
+#define FILE_PATH_ERROR "Error: incorrect file path"
+
+#define MAX_TWEET_LENGTH 20
+#define DEFAULT_WORDS_TO_READ -1
+
+/**
+ * What the chain learns from: the corpus files, or the selected sentences
+ * of their token index, and how its weights decay.
+ */
+typedef struct TrainingCorpus {
+    const CorpusFiles *files;
+    const CorpusTokens *tokens; // NULL to read the files
+    TokenSelection selection;
+    MarkovDecay *decay;         // NULL to count frequencies
+} TrainingCorpus;
+
+// The functions of a chain of words, shared by the modes of the generator.
+void *copy_string(const void *data);
+void print_string(const void *data);
+int format_string(char *buffer, size_t size, const void *data);
+int compare_strings(const void *a, const void *b);
+size_t string_size(const void *data);
+bool is_last_string(const void *data);
+
+#endif /* _TWEETS_GENERATOR_H */
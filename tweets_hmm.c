@@ -0,0 +1,119 @@
+#include "tweets_hmm.h"
+#include "tweets_generator.h"
+#include "markov_score.h"
+#include "hmm.h"
+#include <string.h>
+
+/**
+ * Read the lines of a file as sequences of the index's state ids, the words
+ * the chain never saw sharing the extra id index->num_states.
+ */
+static int read_hmm_sequences(FILE *fp, const MarkovIndex *index,
+    HmmSequences *sequences)
+{
+    char *line = NULL;
+    size_t capacity = 0;
+    int *symbols = NULL;
+    size_t symbols_capacity = 0;
+    ssize_t len;
+    int status = EXIT_SUCCESS;
+    while (status == EXIT_SUCCESS && (len = getline(&line, &capacity, fp))
+           != -1)
+        {
+        // Words are separated, so there are at most len / 2 + 1.
+        if ((size_t)len / 2 + 1 > symbols_capacity)
+            {
+            symbols_capacity = len / 2 + 1;
+            int *new_symbols = realloc(symbols,
+                symbols_capacity * sizeof(int));
+            if (!new_symbols){status = EXIT_FAILURE; break;}
+            symbols = new_symbols;
+            }
+        int length = 0;
+        char *save_ptr;
+        for (char *word = strtok_r(line, SCORE_DELIMITERS, &save_ptr); word;
+             word = strtok_r(NULL, SCORE_DELIMITERS, &save_ptr))
+            {
+            int id = markov_index_find(index, word);
+            symbols[length++] = (id == NOT_IN_INDEX) ? index->num_states : id;
+            }
+        status = add_hmm_sequence(sequences, symbols, length);
+        }
+    if (status == EXIT_FAILURE || ferror(fp))
+        {
+        fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+        status = EXIT_FAILURE;
+        }
+    free(line);
+    free(symbols);
+    return status;
+}
+
+static int print_tags(const HiddenMarkovModel *model,
+    const HmmSequences *sequences, int num_threads)
+{
+    long num_symbols = sequences->num_sequences
+                       ? sequences->offsets[sequences->num_sequences] : 0;
+    int *states = malloc((num_symbols ? num_symbols : 1) * sizeof(int));
+    double *log_probs = malloc((sequences->num_sequences
+                                ? sequences->num_sequences : 1)
+                               * sizeof(double));
+    int status = EXIT_FAILURE;
+    if (!states || !log_probs)
+        {
+        fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+        }
+    else
+        {
+        status = hmm_decode(model, sequences, num_threads, states, log_probs);
+        }
+    for (int s = 0; status == EXIT_SUCCESS && s < sequences->num_sequences;
+         s++)
+        {
+        printf("Tags %d:", s + 1);
+        for (long k = sequences->offsets[s]; k < sequences->offsets[s + 1];
+             k++)
+            {
+            printf(" %d", states[k]);
+            }
+        printf("\n");
+        }
+    free(states);
+    free(log_probs);
+    return status;
+}
+
+int tag_file(const MarkovIndex *index, const TweetOptions *options,
+    unsigned int seed)
+{
+    FILE *fp = fopen(options->hmm_path, "r");
+    if (!fp){fprintf(stderr, FILE_PATH_ERROR); return EXIT_FAILURE;}
+    HmmSequences sequences = {0};
+    int status = read_hmm_sequences(fp, index, &sequences);
+    fclose(fp);
+    HiddenMarkovModel *model = NULL;
+    if (status == EXIT_SUCCESS)
+        {
+        model = create_hmm(options->hmm_states, index->num_states + 1, seed);
+        if (!model){status = EXIT_FAILURE;}
+        }
+    for (int i = 1; status == EXIT_SUCCESS && i <= options->hmm_iterations;
+         i++)
+        {
+        double log_likelihood;
+        status = hmm_baum_welch_step(model, &sequences, options->num_threads,
+            &log_likelihood);
+        if (status == EXIT_SUCCESS)
+            {
+            printf("HMM iteration %d: log likelihood %f\n", i,
+                log_likelihood);
+            }
+        }
+    if (status == EXIT_SUCCESS)
+        {
+        status = print_tags(model, &sequences, options->num_threads);
+        }
+    free_hmm(&model);
+    free_hmm_sequences(&sequences);
+    return status;
+}
@@ -0,0 +1,14 @@
+#ifndef _TWEETS_HMM_H
+#define _TWEETS_HMM_H
+
+#include "tweets_options.h"
+
+/**
+ * Train a hidden Markov model on the lines of the --hmm file, its symbols
+ * being the words of the chain, then print the most likely hidden state of
+ * every word.
+ */
+int tag_file(const MarkovIndex *index, const TweetOptions *options,
+    unsigned int seed);
+
+#endif /* _TWEETS_HMM_H */
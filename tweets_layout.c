@@ -0,0 +1,47 @@
+#include "tweets_layout.h"
+#include "tweets_generator.h"
+#include "parallel_generator.h"
+
+int print_index_tweets(const MarkovIndex *index, unsigned int seed,
+    int num_tweets)
+{
+    int tweet[MAX_TWEET_LENGTH];
+    for (int i = 1; i <= num_tweets; i++)
+        {
+        int length = generate_sequence_ids(index, seed, i - 1,
+            MAX_TWEET_LENGTH, tweet);
+        printf("Tweet %d:", i);
+        for (int k = 0; k < length; k++)
+            {
+            print_string(index->states[tweet[k]]->data);
+            }
+        printf("\n");
+        }
+    return EXIT_SUCCESS;
+}
+
+static void print_layout_stats(const MarkovIndex *index, const char *layout)
+{
+    IndexLocality locality = markov_index_locality(index);
+    printf("Layout %s: mean jump %.1f states, same page %.1f%%\n", layout,
+           locality.mean_jump, 100 * locality.same_page_rate);
+}
+
+int finalize_index(MarkovIndex *index, const TweetOptions *options)
+{
+    static const char *order_names[] = {"frequency", "bfs", "rcm"};
+    if (options->stats)
+        {
+        printf("States: %d, transitions: %d\n", index->num_states,
+            index->num_edges);
+        print_layout_stats(index, "database");
+        }
+    if (options->order == NO_REORDER){return EXIT_SUCCESS;}
+    if (markov_index_reorder(index, options->order, string_size)
+        == EXIT_FAILURE){return EXIT_FAILURE;}
+    if (options->stats)
+        {
+        print_layout_stats(index, order_names[options->order]);
+        }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,22 @@
+#ifndef _TWEETS_LAYOUT_H
+#define _TWEETS_LAYOUT_H
+
+#include "tweets_options.h"
+
+/**
+ * Generate tweets from the frozen (reordered) model, one after another.
+ * Tweet i is drawn like --parallel draws it, from the stream keyed by
+ * (seed, i), but reordered states are numbered differently, so the tweets
+ * differ from the --parallel ones.
+ */
+int print_index_tweets(const MarkovIndex *index, unsigned int seed,
+    int num_tweets);
+
+/**
+ * Apply the --order layout to the model, printing the layout statistics
+ * before and after if --stats was given (see markov_index_bench for the
+ * walk timings).
+ */
+int finalize_index(MarkovIndex *index, const TweetOptions *options);
+
+#endif /* _TWEETS_LAYOUT_H */
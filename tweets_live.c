@@ -0,0 +1,154 @@
+#include "tweets_live.h"
+#include "markov_snapshot.h"
+#include "counter_rng.h"
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define LIVE_READERS_REPORT "Live readers: %ld tweets (%ld words) generated \
+by %d readers during training\n"
+#define LIVE_READER_THREAD_ERROR "Error: failed to start live reader\n"
+
+#define LIVE_READER_PAUSE_NS 100000 // between two tweets of a live reader
+#define LIVE_READER_IDLE_NS 1000000 // between polls before the first publish
+
+/**
+ * A thread generating tweets from the live snapshot of the chain while it
+ * trains, counting what it generated.
+ */
+typedef struct LiveReader {
+    MarkovSnapshot *snapshot;
+    atomic_bool *stop;
+    unsigned int seed;
+    int number;
+    long tweets;
+    long words;
+    pthread_t thread;
+} LiveReader;
+
+/**
+ * Generate tweets from the snapshot until told to stop. Readers pause
+ * between tweets, so they demonstrate concurrent reads without taking the
+ * trainer's cores, and sleep until the first publish gives them something
+ * to read.
+ */
+static void *live_reader(void *arg)
+{
+    LiveReader *reader = arg;
+    MarkovNode *tweet[MAX_TWEET_LENGTH];
+    int id = snapshot_register_reader(reader->snapshot);
+    CounterRng rng = counter_rng(reader->seed, reader->number);
+    while (id != -1 && !atomic_load(reader->stop))
+        {
+        int length = snapshot_generate(reader->snapshot, id, &rng,
+            MAX_TWEET_LENGTH, tweet);
+        if (length)
+            {
+            reader->tweets++;
+            reader->words += length;
+            }
+        struct timespec pause = {0, length ? LIVE_READER_PAUSE_NS
+                                           : LIVE_READER_IDLE_NS};
+        nanosleep(&pause, NULL);
+        }
+    return NULL;
+}
+
+/**
+ * Training of the chain behind a live snapshot, on top of another hook.
+ */
+typedef struct LiveTraining {
+    MarkovSnapshot *snapshot;
+    training_hook_t hook;
+    void *context;
+} LiveTraining;
+
+/**
+ * Report every update of the chain to its live snapshot, and publish it
+ * between batches of words, so live readers see the chain as of the end of
+ * a batch.
+ */
+static int update_snapshot(void *live_training, const TrainingStep *step)
+{
+    LiveTraining *live = live_training;
+    if (live->hook && live->hook(live->context, step) == EXIT_FAILURE)
+        {
+        return EXIT_FAILURE;
+        }
+    if (step->event == TRAINED_WORD)
+        {
+        if ((step->is_new &&
+             snapshot_note_node(live->snapshot, step->node) == EXIT_FAILURE)
+            || (step->prev_node && snapshot_note_transition(live->snapshot,
+                step->prev_node) == EXIT_FAILURE))
+            {
+            return EXIT_FAILURE;
+            }
+        }
+    if (step->event == TRAINED_BATCH && snapshot_publish_due(live->snapshot)
+        && snapshot_publish(live->snapshot) == EXIT_FAILURE)
+        {
+        fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+        return EXIT_FAILURE;
+        }
+    return EXIT_SUCCESS;
+}
+
+int train_with_live_readers(const TrainingCorpus *corpus, int words_to_read,
+    MarkovChain *markov_chain, training_hook_t hook, void *context,
+    int num_readers, unsigned int seed)
+{
+    MarkovSnapshot *snapshot = create_markov_snapshot(markov_chain);
+    LiveReader *readers = calloc(num_readers, sizeof(LiveReader));
+    if (!snapshot || !readers)
+        {
+        if (snapshot){fprintf(stderr, ALLOCATION_ERROR_MASSAGE);}
+        free_markov_snapshot(&snapshot);
+        free(readers);
+        return EXIT_FAILURE;
+        }
+    atomic_bool stop;
+    atomic_init(&stop, false);
+    int started = 0;
+    for (; started < num_readers; started++)
+        {
+        readers[started].snapshot = snapshot;
+        readers[started].stop = &stop;
+        readers[started].seed = seed;
+        readers[started].number = started;
+        if (pthread_create(&readers[started].thread, NULL, live_reader,
+            &readers[started]) != 0){break;}
+        }
+    int status = EXIT_FAILURE;
+    if (started == num_readers)
+        {
+        LiveTraining live = {snapshot, hook, context};
+        status = fill_database_from_files(markov_chain, corpus->files,
+            words_to_read, corpus->decay, update_snapshot, &live);
+        if (status == EXIT_SUCCESS &&
+            snapshot_publish(snapshot) == EXIT_FAILURE)
+            {
+            fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+            status = EXIT_FAILURE;
+            }
+        }
+    else
+        {
+        fprintf(stderr, LIVE_READER_THREAD_ERROR);
+        }
+    atomic_store(&stop, true);
+    long tweets = 0, words = 0;
+    for (int i = 0; i < started; i++)
+        {
+        pthread_join(readers[i].thread, NULL);
+        tweets += readers[i].tweets;
+        words += readers[i].words;
+        }
+    if (status == EXIT_SUCCESS)
+        {
+        fprintf(stderr, LIVE_READERS_REPORT, tweets, words, started);
+        }
+    free_markov_snapshot(&snapshot);
+    free(readers);
+    return status;
+}
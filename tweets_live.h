@@ -0,0 +1,15 @@
+#ifndef _TWEETS_LIVE_H
+#define _TWEETS_LIVE_H
+
+#include "tweets_generator.h"
+
+/**
+ * Train the chain while num_readers threads keep generating tweets from it,
+ * then report how much they generated. hook, if any, is told about every
+ * step of training, as by fill_database_from_files().
+ */
+int train_with_live_readers(const TrainingCorpus *corpus, int words_to_read,
+    MarkovChain *markov_chain, training_hook_t hook, void *context,
+    int num_readers, unsigned int seed);
+
+#endif /* _TWEETS_LIVE_H */
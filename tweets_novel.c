@@ -0,0 +1,94 @@
+#include "tweets_novel.h"
+#include "tweets_generator.h"
+
+#define NOVELTY_REPORT "Novelty: rejected %ld copies of the corpus and %ld \
+repeated tweets, skipped %ld tweets after %d attempts\n"
+
+#define MAX_NOVELTY_ATTEMPTS 100
+#define NOVELTY_BYTES_PER_WORD 6 // to size the filter from the corpus size
+
+NoveltyFilter *create_corpus_novelty_filter(const CorpusFiles *files,
+    int words_to_read, int ngram)
+{
+    long long expected = corpus_files_size(files) / NOVELTY_BYTES_PER_WORD;
+    if (words_to_read != DEFAULT_WORDS_TO_READ && words_to_read < expected)
+        {
+        expected = words_to_read;
+        }
+    return create_novelty_filter(expected, ngram, hash_string);
+}
+
+int learn_novelty(void *run, const TrainingStep *step)
+{
+    NoveltyRun *novelty = run;
+    if (step->event != TRAINED_WORD){return EXIT_SUCCESS;}
+    if (!step->prev_node){novelty_start(&novelty->sentence);}
+    novelty_learn(novelty->filter, &novelty->sentence, step->word,
+        step->is_last);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Generate a tweet like generate_random_sequence() does, but start over as
+ * soon as it copies --novel words of the corpus, or if it ends up a tweet of
+ * the corpus or of the batch, giving up after MAX_NOVELTY_ATTEMPTS attempts.
+ * @return length of the tweet, 0 if every attempt was rejected, -1 on
+ * allocation error
+ */
+static int generate_novel_tweet(MarkovChain *markov_chain, NoveltyRun *run,
+    MarkovNode **tweet)
+{
+    for (int attempt = 1; attempt <= MAX_NOVELTY_ATTEMPTS; attempt++)
+        {
+        NoveltyCursor cursor;
+        novelty_start(&cursor);
+        bool novel = true;
+        MarkovNode *node = get_first_random_node(markov_chain);
+        int length = 0;
+        while (node)
+            {
+            tweet[length++] = node;
+            novel = novelty_extend(run->filter, &cursor, node->data);
+            if (!novel || length == MAX_TWEET_LENGTH ||
+                (length > 1 && markov_chain->is_last(node->data)))
+                {
+                break;
+                }
+            node = get_next_random_node(node);
+            }
+        if (novel && novelty_is_copy(run->filter, &cursor)){novel = false;}
+        int inserted = novel ? sequence_set_insert(&run->seen, &cursor) : 0;
+        if (inserted == -1){return -1;}
+        if (inserted == 1){return length;}
+        if (novel){run->repeats++;}
+        else{run->copies++;}
+        }
+    run->skipped++;
+    return 0;
+}
+
+int print_novel_tweets(MarkovChain *markov_chain, NoveltyRun *run,
+    int num_tweets)
+{
+    MarkovNode *tweet[MAX_TWEET_LENGTH];
+    int printed = 0;
+    for (int i = 1; i <= num_tweets; i++)
+        {
+        int length = generate_novel_tweet(markov_chain, run, tweet);
+        if (length == -1)
+            {
+            fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+            return EXIT_FAILURE;
+            }
+        if (length == 0){continue;}
+        printf("Tweet %d:", ++printed);
+        for (int k = 0; k < length; k++)
+            {
+            markov_chain->print_func(tweet[k]->data);
+            }
+        printf("\n");
+        }
+    fprintf(stderr, NOVELTY_REPORT, run->copies, run->repeats, run->skipped,
+        MAX_NOVELTY_ATTEMPTS);
+    return EXIT_SUCCESS;
+}
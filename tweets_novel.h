@@ -0,0 +1,53 @@
+#ifndef _TWEETS_NOVEL_H
+#define _TWEETS_NOVEL_H
+
+#include "markov_chain.h"
+#include "corpus_pipeline.h"
+#include "novelty_filter.h"
+
+/**
+ * State of a batch of novel tweets.
+ */
+typedef struct NoveltyRun {
+    NoveltyFilter *filter;  // n-word windows and sentences of the corpus
+    SequenceSet seen;       // tweets of the batch
+    long copies;            // candidates rejected for copying the corpus
+    long repeats;           // candidates rejected for repeating a tweet
+    long skipped;           // tweets given up after MAX_NOVELTY_ATTEMPTS
+    NoveltyCursor sentence; // corpus sentence being learned
+} NoveltyRun;
+
+/**
+ * Create the filter a novelty run checks tweets against, sized for the
+ * words that will be read from the corpus.
+ * @param files corpus files
+ * @param words_to_read maximum number of words to learn, -1 for all
+ * @param ngram --novel window length
+ * @return the filter, NULL in case of allocation error
+ */
+NoveltyFilter *create_corpus_novelty_filter(const CorpusFiles *files,
+    int words_to_read, int ngram);
+
+/**
+ * Training hook recording the sentences learned in the run's filter.
+ * @param run NoveltyRun whose filter to fill
+ * @param step
+ * @return EXIT_SUCCESS
+ */
+int learn_novelty(void *run, const TrainingStep *step);
+
+/**
+ * Print num_tweets tweets like generate_random_sequence() would, but
+ * drawing each one again while it copies --novel words of the corpus, is a
+ * sentence of the corpus or repeats a tweet of the batch. A tweet still
+ * rejected after MAX_NOVELTY_ATTEMPTS attempts is skipped, so fewer tweets
+ * may be printed. Then report the rejections and skipped tweets on stderr.
+ * @param markov_chain trained chain
+ * @param run filter of the corpus the chain was trained on, empty set
+ * @param num_tweets
+ * @return EXIT_SUCCESS / EXIT_FAILURE in case of allocation error
+ */
+int print_novel_tweets(MarkovChain *markov_chain, NoveltyRun *run,
+    int num_tweets);
+
+#endif /* _TWEETS_NOVEL_H */
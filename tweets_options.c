@@ -0,0 +1,125 @@
+#include "tweets_options.h"
+#include "markov_score.h"
+#include "markov_snapshot.h"
+#include "novelty_filter.h"
+#include "markov_beam.h"
+#include "cli_options.h"
+#include <string.h>
+
+#define INVALID_ORDER -2
+#define DEFAULT_HMM_STATES 8
+#define DEFAULT_HMM_ITERATIONS 10
+#define RANGE_SEPARATOR ':'
+#define NOVEL_PARALLEL_ERROR "Usage: --novel cannot be used with --parallel\n"
+#define NOVEL_ORDER_ERROR "Usage: --novel cannot be used with --order\n"
+#define RANGE_TOKENS_ERROR "Usage: --range needs --tokens\n"
+#define FOLDS_TOKENS_ERROR "Usage: --folds needs --tokens\n"
+#define TOKENS_LIVE_READERS_ERROR \
+    "Usage: --tokens cannot be used with --live-readers\n"
+
+static int parse_order(const char *value)
+{
+    if (!value){return NO_REORDER;}
+    if (!strcmp(value, "frequency")){return ORDER_FREQUENCY;}
+    if (!strcmp(value, "bfs")){return ORDER_BFS;}
+    if (!strcmp(value, "rcm")){return ORDER_RCM;}
+    return INVALID_ORDER;
+}
+
+/**
+ * Parse a "<first>:<last>" (or "<first>:") range of sentences.
+ * @return EXIT_SUCCESS, EXIT_FAILURE if value is not such a range
+ */
+static int parse_range(const char *value, long long *first, long long *last)
+{
+    *first = 0;
+    *last = NO_RANGE_END;
+    if (!value){return EXIT_SUCCESS;}
+    char *end;
+    *first = strtoll(value, &end, DECIMAL_BASE);
+    if (end == value || *end != RANGE_SEPARATOR || *first < 0)
+        {
+        return EXIT_FAILURE;
+        }
+    if (!*++end){return EXIT_SUCCESS;}
+    const char *last_value = end;
+    *last = strtoll(last_value, &end, DECIMAL_BASE);
+    return (*end || *last < *first) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/**
+ * Check that the options given can be used together.
+ * @param options parsed options
+ * @param range value of --range, NULL if not given
+ * @return true, false if two of them conflict (error printed)
+ */
+static bool check_combinations(const TweetOptions *options, const char *range)
+{
+    const char *error = NULL;
+    if (options->novel != NO_NOVELTY && options->parallel)
+        {
+        error = NOVEL_PARALLEL_ERROR;
+        }
+    else if (options->novel != NO_NOVELTY && options->order != NO_REORDER)
+        {
+        error = NOVEL_ORDER_ERROR;
+        }
+    else if (!options->tokens_path && range){error = RANGE_TOKENS_ERROR;}
+    else if (!options->tokens_path && options->folds != NO_FOLDS)
+        {
+        error = FOLDS_TOKENS_ERROR;
+        }
+    else if (options->tokens_path && options->live_readers)
+        {
+        error = TOKENS_LIVE_READERS_ERROR;
+        }
+    if (error){fprintf(stderr, "%s", error);}
+    return !error;
+}
+
+bool parse_options(int *argc, char **argv, TweetOptions *options)
+{
+    options->score_path = take_option(argc, argv, "score");
+    options->hmm_path = take_option(argc, argv, "hmm");
+    options->complete_path = take_option(argc, argv, "complete");
+    options->tokens_path = take_option(argc, argv, "tokens");
+    char *range = take_option(argc, argv, "range");
+    char *novel = take_option(argc, argv, "novel");
+    options->stats = take_option(argc, argv, "stats") != NULL;
+    options->parallel = take_option(argc, argv, "parallel") != NULL;
+    options->order = parse_order(take_option(argc, argv, "order"));
+    if (parse_int_option(take_option(argc, argv, "threads"),
+            default_num_threads(), 1, &options->num_threads) == EXIT_FAILURE
+        || parse_double_option(take_option(argc, argv, "smoothing"),
+            DEFAULT_SMOOTHING, &options->smoothing) == EXIT_FAILURE
+        || parse_double_option(take_option(argc, argv, "half-life"),
+            NO_HALF_LIFE, &options->half_life) == EXIT_FAILURE
+        || options->half_life < 0
+        || parse_int_option(take_option(argc, argv, "live-readers"), 0, 0,
+            &options->live_readers) == EXIT_FAILURE
+        || options->live_readers > MAX_SNAPSHOT_READERS
+        || parse_int_option(take_option(argc, argv, "hmm-states"),
+            DEFAULT_HMM_STATES, 1, &options->hmm_states) == EXIT_FAILURE
+        || parse_int_option(take_option(argc, argv, "hmm-iterations"),
+            DEFAULT_HMM_ITERATIONS, 0, &options->hmm_iterations)
+            == EXIT_FAILURE
+        || parse_int_option((novel && *novel) ? novel : NULL,
+            novel ? DEFAULT_NOVELTY_NGRAM : NO_NOVELTY, 1, &options->novel)
+            == EXIT_FAILURE
+        || options->novel > MAX_NOVELTY_NGRAM
+        || parse_int_option(take_option(argc, argv, "top"), DEFAULT_TOP_K, 1,
+            &options->top_k) == EXIT_FAILURE
+        || parse_int_option(take_option(argc, argv, "beam"),
+            DEFAULT_BEAM_WIDTH, options->top_k, &options->beam_width)
+            == EXIT_FAILURE
+        || parse_range(range, &options->range_first, &options->range_last)
+            == EXIT_FAILURE
+        || parse_int_option(take_option(argc, argv, "folds"), NO_FOLDS, 2,
+            &options->folds) == EXIT_FAILURE
+        || options->smoothing <= 0 || options->order == INVALID_ORDER)
+        {
+        fprintf(stderr, OPTION_ERROR);
+        return false;
+        }
+    return check_combinations(options, range);
+}
@@ -0,0 +1,54 @@
+#ifndef _TWEETS_OPTIONS_H
+#define _TWEETS_OPTIONS_H
+
+#include "markov_index.h"
+#include <stdbool.h>
+
+#define DECIMAL_BASE 10
+#define NO_REORDER -1
+#define NO_NOVELTY 0
+#define NO_FOLDS 0
+#define NO_RANGE_END -1
+
+/**
+ * Optional "--name=value" arguments.
+ */
+typedef struct TweetOptions {
+    char *score_path; // --score: print the log probability of each line
+    int num_threads;  // --threads: worker threads, defaults to all cores
+    double smoothing; // --smoothing: pseudo count of unseen transitions
+    int order;        // --order: frequency/bfs/rcm layout of the model
+    bool stats;       // --stats: print model layout statistics
+    bool parallel;    // --parallel: generate with --threads threads, each
+                      // tweet seeded by (seed, tweet number)
+    double half_life; // --half-life: corpus lines after which a count
+                      // weighs half, recent lines count more
+    int live_readers; // --live-readers: threads generating while training
+    char *hmm_path;   // --hmm: train an HMM on a file, print its tags
+    int hmm_states;   // --hmm-states: hidden states of the HMM
+    int hmm_iterations; // --hmm-iterations: Baum-Welch iterations
+    int novel;        // --novel: skip tweets copying that many words of the
+                      // corpus, or repeating a tweet (0: keep all)
+    char *complete_path; // --complete: print the likeliest completions of
+                         // the last word of each line
+    int top_k;        // --top: completions per line
+    int beam_width;   // --beam: partial completions kept at each step
+    char *tokens_path; // --tokens: train from this token index, made from
+                       // the corpus if missing
+    long long range_first; // --range: first sentence of the index to use
+    long long range_last;  // and one past the last, NO_RANGE_END for all
+    int folds;        // --folds: cross validate over that many folds
+} TweetOptions;
+
+/**
+ * Take the options out of argv, leaving the positional arguments, and
+ * check their values and combinations.
+ * @param argc number of arguments, updated
+ * @param argv arguments, updated
+ * @param options results
+ * @return true, false if an option value is invalid or two options
+ * conflict (error printed, naming the conflicting options)
+ */
+bool parse_options(int *argc, char **argv, TweetOptions *options);
+
+#endif /* _TWEETS_OPTIONS_H */
@@ -0,0 +1,77 @@
+#include "tweets_score.h"
+#include "tweets_generator.h"
+#include "markov_score.h"
+
+#define SCORE_BLOCK_LINES 65536
+
+/**
+ * Read up to SCORE_BLOCK_LINES lines.
+ * @return number of lines read, -1 on allocation error
+ */
+static int read_lines(FILE *fp, char **lines)
+{
+    int num_lines = 0;
+    size_t capacity = 0;
+    while (num_lines < SCORE_BLOCK_LINES)
+        {
+        lines[num_lines] = NULL;
+        capacity = 0;
+        if (getline(&lines[num_lines], &capacity, fp) == -1)
+            {
+            free(lines[num_lines]);
+            return ferror(fp) ? -1 : num_lines;
+            }
+        num_lines++;
+        }
+    return num_lines;
+}
+
+int score_file(const MarkovIndex *index, const TweetOptions *options)
+{
+    FILE *fp = fopen(options->score_path, "r");
+    if (!fp){fprintf(stderr, FILE_PATH_ERROR); return EXIT_FAILURE;}
+    char **lines = malloc(SCORE_BLOCK_LINES * sizeof(char *));
+    LineScore *scores = malloc(SCORE_BLOCK_LINES * sizeof(LineScore));
+    ScorePool *pool = lines && scores
+                      ? create_score_pool(options->num_threads) : NULL;
+    if (!pool)
+        {
+        if (!lines || !scores){fprintf(stderr, ALLOCATION_ERROR_MASSAGE);}
+        free(lines);
+        free(scores);
+        fclose(fp);
+        return EXIT_FAILURE;
+        }
+    CorpusScore total = {0, 0};
+    long line_number = 0;
+    int status = EXIT_SUCCESS;
+    int num_lines;
+    while ((num_lines = read_lines(fp, lines)) > 0)
+        {
+        status = score_lines(pool, index, lines, num_lines,
+            options->smoothing, scores, &total);
+        for (int i = 0; i < num_lines; i++)
+            {
+            if (status == EXIT_SUCCESS)
+                {
+                printf("Line %ld: %f\n", ++line_number, scores[i].log_prob);
+                }
+            free(lines[i]);
+            }
+        if (status == EXIT_FAILURE){break;}
+        }
+    if (num_lines < 0)
+        {
+        fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+        status = EXIT_FAILURE;
+        }
+    if (status == EXIT_SUCCESS)
+        {
+        printf("Perplexity: %f\n", corpus_perplexity(&total));
+        }
+    free_score_pool(&pool);
+    free(lines);
+    free(scores);
+    fclose(fp);
+    return status;
+}
@@ -0,0 +1,13 @@
+#ifndef _TWEETS_SCORE_H
+#define _TWEETS_SCORE_H
+
+#include "tweets_options.h"
+
+/**
+ * Print the log probability of every line of the --score file under the
+ * trained chain, then the perplexity of the whole file. Lines are scored in
+ * blocks, each block in parallel.
+ */
+int score_file(const MarkovIndex *index, const TweetOptions *options);
+
+#endif /* _TWEETS_SCORE_H */
@@ -0,0 +1,99 @@
+#include "tweets_tokens.h"
+#include <unistd.h>
+
+#define TOKENS_STALE_NOTE "Note: token index %s does not match the corpus, \
+rebuilding it\n"
+
+/**
+ * Tokenize the corpus into a token index file, training a scratch chain
+ * like prototype along the way.
+ */
+static int build_token_index(const CorpusFiles *files,
+    const MarkovChain *prototype, const char *path, uint64_t fingerprint)
+{
+    MarkovChain *scratch = malloc(sizeof(MarkovChain));
+    LinkedList *database = calloc(1, sizeof(LinkedList));
+    TokenWriter *writer = create_token_writer(prototype->is_last);
+    if (!scratch || !database || !writer)
+        {
+        if (writer){fprintf(stderr, ALLOCATION_ERROR_MASSAGE);}
+        free(scratch);
+        free(database);
+        free_token_writer(&writer);
+        return EXIT_FAILURE;
+        }
+    *scratch = *prototype;
+    scratch->database = database;
+    int status = fill_database_from_files(scratch, files,
+        DEFAULT_WORDS_TO_READ, NULL, token_writer_hook, writer);
+    if (status == EXIT_SUCCESS)
+        {
+        status = save_corpus_tokens(writer, path, fingerprint);
+        }
+    free_token_writer(&writer);
+    free_markov_chain(&scratch);
+    return status;
+}
+
+CorpusTokens *open_token_index(const CorpusFiles *files,
+    const MarkovChain *prototype, const char *path)
+{
+    uint64_t fingerprint = corpus_files_fingerprint(files);
+    if (!corpus_tokens_match(path, fingerprint))
+        {
+        if (access(path, F_OK) == 0){fprintf(stderr, TOKENS_STALE_NOTE, path);}
+        if (build_token_index(files, prototype, path, fingerprint)
+            == EXIT_FAILURE){return NULL;}
+        }
+    return load_corpus_tokens(path);
+}
+
+TokenSelection select_sentences(const CorpusTokens *tokens,
+    const TweetOptions *options)
+{
+    TokenSelection selection = all_sentences(tokens);
+    if ((unsigned long long)options->range_first < selection.last)
+        {
+        selection.first = options->range_first;
+        }
+    else
+        {
+        selection.first = selection.last;
+        }
+    if (options->range_last != NO_RANGE_END &&
+        (unsigned long long)options->range_last < selection.last)
+        {
+        selection.last = options->range_last;
+        }
+    return selection;
+}
+
+int print_cross_validation(const MarkovChain *prototype,
+    const TrainingCorpus *corpus, const TweetOptions *options)
+{
+    CorpusScore *fold_scores = malloc(options->folds * sizeof(CorpusScore));
+    if (!fold_scores)
+        {
+        fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+        return EXIT_FAILURE;
+        }
+    int status = cross_validate(prototype, corpus->tokens,
+        &corpus->selection, options->folds, options->smoothing,
+        options->half_life, hash_string, options->num_threads, fold_scores);
+    CorpusScore total = {0, 0};
+    for (int fold = 0; status == EXIT_SUCCESS && fold < options->folds;
+         fold++)
+        {
+        printf("Fold %d: perplexity %f\n", fold + 1,
+            corpus_perplexity(&fold_scores[fold]));
+        total.log_prob += fold_scores[fold].log_prob;
+        total.num_transitions += fold_scores[fold].num_transitions;
+        }
+    if (status == EXIT_SUCCESS)
+        {
+        printf("Cross validation perplexity: %f\n",
+            corpus_perplexity(&total));
+        }
+    free(fold_scores);
+    return status;
+}
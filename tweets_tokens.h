@@ -0,0 +1,27 @@
+#ifndef _TWEETS_TOKENS_H
+#define _TWEETS_TOKENS_H
+
+#include "tweets_generator.h"
+#include "tweets_options.h"
+
+/**
+ * Load the --tokens index, first making it from the whole corpus if the
+ * file does not exist or was made from another version of the corpus.
+ */
+CorpusTokens *open_token_index(const CorpusFiles *files,
+    const MarkovChain *prototype, const char *path);
+
+/**
+ * @return the --range sentences of a token index, cut to its size
+ */
+TokenSelection select_sentences(const CorpusTokens *tokens,
+    const TweetOptions *options);
+
+/**
+ * Cross validate chains like prototype over the --folds folds of the
+ * --range sentences, then print the perplexity of each fold and of all.
+ */
+int print_cross_validation(const MarkovChain *prototype,
+    const TrainingCorpus *corpus, const TweetOptions *options);
+
+#endif /* _TWEETS_TOKENS_H */
@@ -0,0 +1,121 @@
+#include "word_table.h"
+#include "markov_chain.h" // For ALLOCATION_ERROR_MASSAGE
+#include <string.h>
+
+#define INITIAL_WORD_TABLE_CAPACITY 1024
+
+uint64_t hash_bytes(uint64_t hash, const void *data, size_t size)
+{
+    const unsigned char *bytes = data;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+uint64_t hash_string(const void *data)
+{
+    return hash_bytes(FNV_OFFSET_BASIS, data, strlen(data));
+}
+
+static uint32_t *word_slot(const WordTable *table, uint32_t *slots,
+    size_t capacity, const char *word)
+{
+    size_t i = hash_string(word) & (capacity - 1);
+    while (slots[i] != NOT_A_WORD &&
+           strcmp(table->words + table->offsets[slots[i]], word) != 0)
+    {
+        i = (i + 1) & (capacity - 1);
+    }
+    return &slots[i];
+}
+
+static int grow_slots(WordTable *table)
+{
+    size_t capacity = table->slots_capacity ? 2 * table->slots_capacity
+                                            : INITIAL_WORD_TABLE_CAPACITY;
+    uint32_t *slots = malloc(capacity * sizeof(uint32_t));
+    if (!slots){fprintf(stderr, ALLOCATION_ERROR_MASSAGE); return EXIT_FAILURE;}
+    memset(slots, 0xff, capacity * sizeof(uint32_t)); // NOT_A_WORD
+    for (uint32_t id = 0; id < table->num_words; id++)
+    {
+        *word_slot(table, slots, capacity, table->words + table->offsets[id]) =
+            id;
+    }
+    free(table->slots);
+    table->slots = slots;
+    table->slots_capacity = capacity;
+    return EXIT_SUCCESS;
+}
+
+/**
+ * Make room for needed items in a growing array.
+ * @return EXIT_SUCCESS / EXIT_FAILURE in case of allocation error
+ */
+static int reserve(void **array, size_t *capacity, size_t needed,
+    size_t item_size)
+{
+    if (needed <= *capacity){return EXIT_SUCCESS;}
+    size_t new_capacity = *capacity ? *capacity : INITIAL_WORD_TABLE_CAPACITY;
+    while (new_capacity < needed){new_capacity *= 2;}
+    void *new_array = realloc(*array, new_capacity * item_size);
+    if (!new_array)
+    {
+        fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+        return EXIT_FAILURE;
+    }
+    *array = new_array;
+    *capacity = new_capacity;
+    return EXIT_SUCCESS;
+}
+
+uint32_t word_table_intern(WordTable *table, const char *word, bool *is_new)
+{
+    if (is_new){*is_new = false;}
+    if (2 * ((size_t)table->num_words + 1) > table->slots_capacity &&
+        grow_slots(table) == EXIT_FAILURE){return NOT_A_WORD;}
+    uint32_t *slot = word_slot(table, table->slots, table->slots_capacity,
+                               word);
+    if (*slot != NOT_A_WORD){return *slot;}
+    size_t len = strlen(word) + 1;
+    if (table->num_words == NOT_A_WORD - 1)
+    {
+        fprintf(stderr, ALLOCATION_ERROR_MASSAGE);
+        return NOT_A_WORD;
+    }
+    if (reserve((void **)&table->words, &table->words_capacity,
+            table->words_size + len, 1) == EXIT_FAILURE ||
+        reserve((void **)&table->offsets, &table->offsets_capacity,
+            (size_t)table->num_words + 1, sizeof(uint64_t)) == EXIT_FAILURE)
+    {
+        return NOT_A_WORD;
+    }
+    memcpy(table->words + table->words_size, word, len);
+    table->offsets[table->num_words] = table->words_size;
+    table->words_size += len;
+    *slot = table->num_words++;
+    if (is_new){*is_new = true;}
+    return *slot;
+}
+
+uint32_t word_table_find(const WordTable *table, const char *word)
+{
+    if (!table->slots_capacity){return NOT_A_WORD;}
+    return *word_slot(table, table->slots, table->slots_capacity, word);
+}
+
+const char *word_table_word(const WordTable *table, uint32_t id)
+{
+    return table->words + table->offsets[id];
+}
+
+void free_word_table(WordTable *table)
+{
+    if (!table){return;}
+    free(table->words);
+    free(table->offsets);
+    free(table->slots);
+    memset(table, 0, sizeof(WordTable));
+}
@@ -0,0 +1,70 @@
+#ifndef _WORD_TABLE_H
+#define _WORD_TABLE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h> // For uint32_t, uint64_t
+#include <stdbool.h>
+
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+#define NOT_A_WORD UINT32_MAX // id of no word
+
+/**
+ * Interned words: every distinct word gets the next id, in order of first
+ * appearance, its text is kept once (NUL terminated, back to back) and it
+ * is found again through an open addressing index of its FNV-1a hash.
+ * An empty table is all zeros.
+ */
+typedef struct WordTable {
+    char *words;
+    size_t words_size;
+    size_t words_capacity;
+    uint64_t *offsets;     // id -> offset of the word in words
+    uint32_t num_words;
+    size_t offsets_capacity;
+    uint32_t *slots;       // id or NOT_A_WORD
+    size_t slots_capacity; // power of 2
+} WordTable;
+
+/**
+ * Add bytes to an FNV-1a hash.
+ * @param hash FNV_OFFSET_BASIS, or the hash of the previous bytes
+ * @param data
+ * @param size number of bytes
+ * @return the hash of the previous bytes followed by data
+ */
+uint64_t hash_bytes(uint64_t hash, const void *data, size_t size);
+
+/**
+ * @param data NUL terminated string
+ * @return its FNV-1a hash, the hash_func_t of chains of strings
+ */
+uint64_t hash_string(const void *data);
+
+/**
+ * Find the id of a word, giving it the next one if it is new.
+ * @param table
+ * @param word
+ * @param is_new set to whether the word was added, or NULL
+ * @return the id, NOT_A_WORD in case of allocation error (error printed)
+ */
+uint32_t word_table_intern(WordTable *table, const char *word, bool *is_new);
+
+/**
+ * @return the id of word, NOT_A_WORD if it is not in the table
+ */
+uint32_t word_table_find(const WordTable *table, const char *word);
+
+/**
+ * @return the word with the given id
+ */
+const char *word_table_word(const WordTable *table, uint32_t id);
+
+/**
+ * Free the memory held by a table, leaving it empty.
+ * @param table
+ */
+void free_word_table(WordTable *table);
+
+#endif /* _WORD_TABLE_H */